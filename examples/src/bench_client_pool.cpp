@@ -0,0 +1,130 @@
+#include <iostream>
+#include <chrono>
+
+#include <Garnet.h>
+
+using namespace Garnet;
+
+// ClientTCPPool benchmark: client threads send requests to an echo ServerTCP and wait for each reply, first connecting a new
+// ClientTCP for every request, then checking a ClientTCP out of a pool and returning it afterwards, and the requests/s are compared.
+// Usage: bench-client-pool [client threads] [requests per thread] [message size] [max pool size]
+
+ServerTCP* server = nullptr;
+
+void echo(const Buffer& buffer, int actualSize, Address clientAddr)
+{
+    server->send(buffer.getData(), actualSize, clientAddr);
+}
+
+// the request that a client is waiting on, reached through the client's user pointer
+struct Request
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    int received = 0;
+    int expected = 0;
+};
+
+void onReply(ClientTCP& client, const Buffer& buffer, int actualSize)
+{
+    Request* request = (Request*)client.getUserPtr();
+    if (request == nullptr) return;
+    std::lock_guard<std::mutex> lock(request->mtx);
+    request->received += actualSize;
+    if (request->received >= request->expected) request->cv.notify_one();
+}
+
+bool roundTrip(ClientTCP& client, std::vector<char>& message)
+{
+    Request request;
+    request.expected = (int)message.size();
+    client.setUserPtr(&request);
+    bool success;
+    client.send(message.data(), (int)message.size(), &success);
+    if (success)
+    {
+        std::unique_lock<std::mutex> lock(request.mtx);
+        success = request.cv.wait_for(lock, std::chrono::seconds(5), [&]() { return request.received >= request.expected; });
+    }
+    client.setUserPtr(nullptr);
+    return success;
+}
+
+void setupClient(ClientTCP& client)
+{
+    client.setClientReceiveCallback(onReply);
+}
+
+void run(bool pooled, int nThreads, int nRequests, int messageSize, int maxPoolSize)
+{
+    Address serverAddr("127.0.0.1", 55557);
+    ServerTCP echoServer(serverAddr);
+    server = &echoServer;
+    echoServer.setBufferSize(messageSize);
+    echoServer.setReceiveCallback(echo);
+    echoServer.open(1024);
+
+    ClientTCPPool pool(0, maxPoolSize);
+    pool.setClientSetup(setupClient);
+
+    std::atomic<int> nFailed{ 0 };
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nThreads; i++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            std::vector<char> message(messageSize, 'g');
+            for (int j = 0; j < nRequests; j++)
+            {
+                if (pooled)
+                {
+                    bool success;
+                    ClientTCP* client = pool.checkout(serverAddr, 5000, &success);
+                    if (!success)
+                    {
+                        nFailed++;
+                        continue;
+                    }
+                    success = roundTrip(*client, message);
+                    pool.checkin(client, success);
+                    if (!success) nFailed++;
+                }
+                else
+                {
+                    ClientTCP client('c');
+                    setupClient(client);
+                    bool success;
+                    client.connect(serverAddr, 5000, &success);
+                    if (!success || !roundTrip(client, message)) nFailed++;
+                    if (success) client.disconnect();
+                }
+            }
+        }));
+    }
+    for (std::thread& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int nOpen = pool.getNumOpen(serverAddr);
+    echoServer.close();
+
+    int nSucceeded = nThreads * nRequests - nFailed;
+    std::cout << (pooled ? "pooled" : "connect per request") << ": " << (int)(nSucceeded / seconds) << " requests/s";
+    if (pooled) std::cout << " over " << nOpen << " connections";
+    if (nFailed > 0) std::cout << " (" << nFailed << " failed)";
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv)
+{
+    int nThreads = argc > 1 ? atoi(argv[1]) : 8;
+    int nRequests = argc > 2 ? atoi(argv[2]) : 1000;
+    int messageSize = argc > 3 ? atoi(argv[3]) : 64;
+    int maxPoolSize = argc > 4 ? atoi(argv[4]) : 8;
+
+    Garnet::Init(true);
+    std::cout << nThreads << " threads, " << nRequests << " requests each, " << messageSize << " byte messages\n";
+    run(false, nThreads, nRequests, messageSize, maxPoolSize);
+    run(true, nThreads, nRequests, messageSize, maxPoolSize);
+    Garnet::Terminate();
+    return 0;
+}
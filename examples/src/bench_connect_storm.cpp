@@ -0,0 +1,61 @@
+#include <iostream>
+#include <chrono>
+
+#include <Garnet.h>
+
+using namespace Garnet;
+
+// Connect-storm benchmark: many client threads repeatedly connect to and disconnect from a ServerTCP,
+// and the accept rate is measured for the given number of accept shards.
+// Usage: bench-connect-storm [shards] [client threads] [connections per thread]
+
+std::atomic<int> nAccepted(0);
+
+void clientConnected(Address clientAddr)
+{
+    nAccepted++;
+}
+
+int main(int argc, char** argv)
+{
+    int nShards = argc > 1 ? atoi(argv[1]) : 1;
+    int nThreads = argc > 2 ? atoi(argv[2]) : 8;
+    int nConnsPerThread = argc > 3 ? atoi(argv[3]) : 2000;
+
+    Garnet::Init(true);
+    ServerTCP server(Address("127.0.0.1", 55555));
+    server.setIOModel(IOModel::Reactor);
+    server.setNumAcceptShards(nShards);
+    server.setClientConnectCallback(clientConnected);
+    server.open(4096);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < nThreads; i++)
+    {
+        clients.push_back(std::thread([nConnsPerThread]()
+        {
+            for (int j = 0; j < nConnsPerThread; j++)
+            {
+                Socket socket(Protocol::TCP);
+                socket.connect(Address("127.0.0.1", 55555));
+                socket.close();
+            }
+        }));
+    }
+    for (std::thread& client : clients) client.join();
+
+    int nTotal = nThreads * nConnsPerThread;
+    while (nAccepted < nTotal && std::chrono::steady_clock::now() - start < std::chrono::seconds(30))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << nShards << " shard(s): accepted " << nAccepted << " / " << nTotal << " connections in " << seconds << " s ("
+              << (int)(nAccepted / seconds) << " accepts/s)\n";
+
+    server.close();
+    Garnet::Terminate();
+    return 0;
+}
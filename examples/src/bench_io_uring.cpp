@@ -0,0 +1,116 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include <Garnet.h>
+
+#ifdef GNET_OS_UNIX
+    #include <sys/resource.h>
+#endif
+
+using namespace Garnet;
+
+// io_uring benchmark: client threads play ping-pong with an echo ServerTCP, first with the thread-per-client model (a blocking
+// Socket::receive() per client), then with the io_uring model, and the round-trip latency, throughput and CPU cost are compared.
+// The context switches per message stand in for the blocking system calls; for exact counts, run a single model under `strace -c -f`.
+// Usage: bench-io-uring [client threads] [round trips per client] [message size] [io threads]
+
+ServerTCP* server = nullptr;
+
+void echo(const Buffer& buffer, int actualSize, Address clientAddr)
+{
+    server->send(buffer.getData(), actualSize, clientAddr);
+}
+
+struct Usage
+{
+    double cpuSeconds = 0;
+    long contextSwitches = 0;
+};
+
+Usage getUsage()
+{
+    Usage usage;
+#ifdef GNET_OS_UNIX
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    usage.cpuSeconds = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    usage.contextSwitches = ru.ru_nvcsw + ru.ru_nivcsw;
+#endif
+    return usage;
+}
+
+void run(IOModel model, const char* name, int nClients, int nRoundTrips, int messageSize, int nIOThreads)
+{
+    ServerTCP echoServer(Address("127.0.0.1", 55556));
+    server = &echoServer;
+    echoServer.setIOModel(model, nIOThreads);
+    echoServer.setBufferSize(messageSize);
+    echoServer.setReceiveCallback(echo);
+    echoServer.open(1024);
+    if (echoServer.getIOModel() != model)
+    {
+        std::cout << name << ": not available (" << GetLastError() << ")\n";
+        echoServer.close();
+        return;
+    }
+
+    std::vector<std::vector<double>> latencies(nClients);
+    std::vector<std::thread> clients;
+    Usage before = getUsage();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nClients; i++)
+    {
+        clients.push_back(std::thread([&, i]()
+        {
+            Socket socket(Protocol::TCP);
+            socket.connect(Address("127.0.0.1", 55556));
+            std::vector<char> message(messageSize, 'g');
+            std::vector<char> reply(messageSize);
+            for (int j = 0; j < nRoundTrips; j++)
+            {
+                auto sent = std::chrono::steady_clock::now();
+                socket.send(message.data(), messageSize);
+                int received = 0;
+                while (received < messageSize)
+                {
+                    bool success;
+                    int nBytes = socket.receive(reply.data() + received, messageSize - received, &success);
+                    if (!success || nBytes <= 0) break;
+                    received += nBytes;
+                }
+                latencies[i].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+            }
+            socket.close();
+        }));
+    }
+    for (std::thread& client : clients) client.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Usage after = getUsage();
+    echoServer.close();
+
+    std::vector<double> all;
+    for (std::vector<double>& clientLatencies : latencies) all.insert(all.end(), clientLatencies.begin(), clientLatencies.end());
+    std::sort(all.begin(), all.end());
+    double nMessages = (double)all.size();
+    if (all.empty()) return;
+
+    std::cout << name << ": " << (int)(nMessages / seconds) << " round trips/s, latency p50 " << all[all.size() / 2] << " us, p99 "
+              << all[all.size() * 99 / 100] << " us, " << (after.cpuSeconds - before.cpuSeconds) * 1e6 / nMessages << " us CPU and "
+              << (after.contextSwitches - before.contextSwitches) / nMessages << " context switches per round trip\n";
+}
+
+int main(int argc, char** argv)
+{
+    int nClients = argc > 1 ? atoi(argv[1]) : 32;
+    int nRoundTrips = argc > 2 ? atoi(argv[2]) : 2000;
+    int messageSize = argc > 3 ? atoi(argv[3]) : 64;
+    int nIOThreads = argc > 4 ? atoi(argv[4]) : 1;
+
+    Garnet::Init(true);
+    std::cout << nClients << " clients, " << nRoundTrips << " round trips each, " << messageSize << " byte messages\n";
+    run(IOModel::ThreadPerClient, "thread per client", nClients, nRoundTrips, messageSize, nIOThreads);
+    run(IOModel::IOUring, "io_uring", nClients, nRoundTrips, messageSize, nIOThreads);
+    Garnet::Terminate();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include <Garnet.h>
+
+using namespace Garnet;
+
+// Socket profile benchmark: for the system defaults and each named profile, a ClientTCP first plays ping-pong with a ServerTCP,
+// sending every request as a small header and a body in two sends (where Nagle's algorithm and delayed ACKs hold the body back),
+// then streams data one way to the server, and the round-trip latency and throughput are compared.
+// Usage: bench-socket-profiles [round trips] [message size] [megabytes streamed]
+
+ServerTCP* server = nullptr;
+int messageSize = 0;
+long long expectedBytes = 0;
+std::atomic<long long> serverReceived{ 0 };
+std::vector<char> reply;
+
+std::mutex doneMtx;
+std::condition_variable doneCv;
+long long clientReceived = 0;
+
+// ping-pong: answer every complete request with a reply of the same size
+void onRequest(const Buffer& buffer, int actualSize, Address clientAddr)
+{
+    long long total = serverReceived += actualSize;
+    if (total / messageSize != (total - actualSize) / messageSize) server->send(reply.data(), messageSize, clientAddr);
+}
+
+// streaming: only count, and signal once everything has arrived
+void onStream(const Buffer& buffer, int actualSize, Address clientAddr)
+{
+    if ((serverReceived += actualSize) < expectedBytes) return;
+    std::lock_guard<std::mutex> lock(doneMtx);
+    doneCv.notify_one();
+}
+
+void onReply(ClientTCP& client, const Buffer& buffer, int actualSize)
+{
+    std::lock_guard<std::mutex> lock(doneMtx);
+    clientReceived += actualSize;
+    doneCv.notify_one();
+}
+
+void run(const char* name, const SocketOptions& options, int nRoundTrips, int megabytes)
+{
+    Address serverAddr("127.0.0.1", 55558);
+
+    // latency
+    std::vector<double> latencies;
+    {
+        ServerTCP pingServer(serverAddr);
+        server = &pingServer;
+        serverReceived = 0;
+        pingServer.setSocketOptions(options);
+        pingServer.setReceiveCallback(onRequest);
+        pingServer.open();
+
+        ClientTCP client('c');
+        client.setSocketOptions(options);
+        client.setClientReceiveCallback(onReply);
+        client.connect(serverAddr);
+        clientReceived = 0;
+
+        std::vector<char> message(messageSize, 'g');
+        int headerSize = std::min(8, messageSize);
+        for (int i = 0; i < nRoundTrips; i++)
+        {
+            auto sent = std::chrono::steady_clock::now();
+            client.send(message.data(), headerSize);
+            if (messageSize > headerSize) client.send(message.data() + headerSize, messageSize - headerSize);
+
+            std::unique_lock<std::mutex> lock(doneMtx);
+            if (!doneCv.wait_for(lock, std::chrono::seconds(5), [&]() { return clientReceived >= (long long)(i + 1) * messageSize; })) break;
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+        }
+        client.disconnect();
+        pingServer.close();
+    }
+
+    // throughput
+    double seconds = 0;
+    int receiveBufferSize = 0, sendBufferSize = 0;
+    {
+        ServerTCP streamServer(serverAddr);
+        server = &streamServer;
+        serverReceived = 0;
+        expectedBytes = (long long)megabytes * 1024 * 1024;
+        streamServer.setSocketOptions(options);
+        streamServer.setBufferSize(64 * 1024);
+        streamServer.setReceiveCallback(onStream);
+        streamServer.open();
+
+        Socket socket(Protocol::TCP);
+        socket.setOptions(options);
+        socket.connect(serverAddr);
+        receiveBufferSize = socket.getReceiveBufferSize();
+        sendBufferSize = socket.getSendBufferSize();
+
+        std::vector<char> chunk(64 * 1024, 'g');
+        auto start = std::chrono::steady_clock::now();
+        for (long long sent = 0; sent < expectedBytes;)
+        {
+            bool success;
+            int nBytes = socket.send(chunk.data(), (int)std::min<long long>(chunk.size(), expectedBytes - sent), &success);
+            if (!success) break;
+            sent += nBytes;
+        }
+        std::unique_lock<std::mutex> lock(doneMtx);
+        doneCv.wait_for(lock, std::chrono::seconds(30), [&]() { return serverReceived >= expectedBytes; });
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        lock.unlock();
+        socket.close();
+        streamServer.close();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << name << ": ";
+    if (latencies.empty()) std::cout << "no round trips";
+    else std::cout << "latency p50 " << latencies[latencies.size() / 2] << " us, p99 " << latencies[latencies.size() * 99 / 100] << " us";
+    std::cout << ", throughput " << (serverReceived / (1024.0 * 1024.0)) / seconds << " MB/s (SO_RCVBUF " << receiveBufferSize
+              << ", SO_SNDBUF " << sendBufferSize << ")\n";
+}
+
+int main(int argc, char** argv)
+{
+    int nRoundTrips = argc > 1 ? atoi(argv[1]) : 200;
+    messageSize = argc > 2 ? atoi(argv[2]) : 256;
+    int megabytes = argc > 3 ? atoi(argv[3]) : 512;
+    reply.resize(messageSize, 'g');
+
+    Garnet::Init(true);
+    std::cout << nRoundTrips << " round trips of " << messageSize << " bytes, " << megabytes << " MB streamed\n";
+    run("system defaults", SocketOptions(), nRoundTrips, megabytes);
+    run("low-latency", SocketOptions::lowLatency(), nRoundTrips, megabytes);
+    run("bulk-throughput", SocketOptions::bulkThroughput(), nRoundTrips, megabytes);
+    Garnet::Terminate();
+    return 0;
+}
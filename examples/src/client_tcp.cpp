@@ -11,10 +11,7 @@ int main()
     Garnet::Init(true);
     Socket clientSocket(Protocol::TCP);
     std::cout << "Connecting to server...\n";
-    clientSocket.connect(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    clientSocket.connect(Address("127.0.0.1", 55555));
 
     std::cout << "CHAT STARTED ----- enter '!quit' to exit\n\n";
     char buffer[256];
@@ -4,16 +4,15 @@
 
 using namespace Garnet;
 
-void receive(void* data, int size, int actualSize)
+void receive(const Buffer& buffer, int actualSize)
 {
-    if (strcmp((char*)data, "Server: !quit") == 0)
+    const char* data = (const char*)buffer.getData();
+    if (strcmp(data, "Server: !quit") == 0)
     {
         std::cout << "Server disconnected.\n";
-        delete data;
         exit(0);
     }
-    std::cout << std::string((char*)data, actualSize) << "\n";
-    delete data;
+    std::cout << std::string(data, actualSize) << "\n";
 }
 
 int main()
@@ -22,10 +21,7 @@ int main()
 
     Garnet::Init(true);
     ClientTCP client('c');
-    client.connect(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    client.connect(Address("127.0.0.1", 55555));
     SetUserPtr(&client);
     client.setReceiveCallback(receive);
 
@@ -12,7 +12,7 @@ int main()
     Socket clientSocket(Protocol::UDP);
     float start = time(nullptr);
 
-    Address serverAddr{ .host = "127.0.0.1", .port = 55555 };
+    Address serverAddr("127.0.0.1", 55555);
 
     std::cout << "CHAT STARTED ----- enter '!quit' to exit\n\n";
     char buffer[256];
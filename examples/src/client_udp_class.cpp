@@ -4,16 +4,15 @@
 
 using namespace Garnet;
 
-void receive(void* buffer, int bufferSize, int actualSize, Address serverAddr)
+void receive(const Buffer& buffer, int actualSize, Address serverAddr)
 {
-    if (strcmp((char*)buffer, "Server: !quit") == 0)
+    const char* data = (const char*)buffer.getData();
+    if (strcmp(data, "Server: !quit") == 0)
     {
         std::cout << "Server disconnected.\n";
-        delete buffer;
         exit(0);
     }
-    std::cout << std::string((char*)buffer, actualSize) << "\n";
-    delete buffer;
+    std::cout << std::string(data, actualSize) << "\n";
 }
 
 int main()
@@ -30,7 +29,7 @@ int main()
     {
         std::cin.getline(buffer, sizeof(buffer));
 
-        client.send(buffer, sizeof(buffer), Address{ .host = "127.0.0.1", .port = 55555 } );
+        client.send(buffer, sizeof(buffer), Address("127.0.0.1", 55555));
         if (strcmp(buffer, "!quit") == 0) break;
     }
 
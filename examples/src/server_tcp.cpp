@@ -10,14 +10,11 @@ int main()
 
     Garnet::Init(true);
     Socket serverSocket(Protocol::TCP);
-    serverSocket.bind(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    serverSocket.bind(Address("127.0.0.1", 55555));
     serverSocket.listen(5);
     std::cout << "Listening for connection...\n";
     Socket acceptSocket = serverSocket.accept();
-    std::cout << "Connected with client (IP: " << acceptSocket.getAddress().host << ", port " << acceptSocket.getAddress().port << ")\n\n";
+    std::cout << "Connected with client (IP: " << acceptSocket.getAddress().getHost() << ", port " << acceptSocket.getAddress().port << ")\n\n";
 
     std::cout << "CHAT STARTED ----- enter '!quit' to exit\n\n";
     char buffer[256];
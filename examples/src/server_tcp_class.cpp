@@ -4,41 +4,29 @@
 
 using namespace Garnet;
 
-void receive(void* data, int size, int actualSize, Address clientAddr)
+void receive(const Buffer& buffer, int actualSize, Address clientAddr)
 {
-    std::string msg = "Client (" + clientAddr.host + ":" + std::to_string(clientAddr.port) + "): " + std::string((char*)data, actualSize);
+    const char* data = (const char*)buffer.getData();
+    std::string msg = "Client (" + clientAddr.getHost() + ":" + std::to_string(clientAddr.port) + "): " + std::string(data, actualSize);
     std::cout << msg << "\n";
     ServerTCP& server = *((ServerTCP*)GetUserPtr());
-    for (const Address& addr : server.getClientAddresses())
-    {
-        if (clientAddr == addr) continue;
-        server.send((void*)msg.c_str(), strlen(msg.c_str()), addr);
-    }
-    delete data;
+    server.broadcast((void*)msg.c_str(), strlen(msg.c_str()), clientAddr);
 }
 
 void clientConnected(Address clientAddr)
 {
-    std::string msg = "Client (" + clientAddr.host + ":" + std::to_string(clientAddr.port) + ") connected.";
+    std::string msg = "Client (" + clientAddr.getHost() + ":" + std::to_string(clientAddr.port) + ") connected.";
     std::cout << msg << "\n";
     ServerTCP& server = *((ServerTCP*)GetUserPtr());
-    for (const Address& addr : server.getClientAddresses())
-    {
-        if (clientAddr == addr) continue;
-        server.send((void*)msg.c_str(), strlen(msg.c_str()), addr);
-    }
+    server.broadcast((void*)msg.c_str(), strlen(msg.c_str()), clientAddr);
 }
 
 void clientDisconnected(Address clientAddr)
 {
-    std::string msg = "Client (" + clientAddr.host + ":" + std::to_string(clientAddr.port) + ") disconnected.";
+    std::string msg = "Client (" + clientAddr.getHost() + ":" + std::to_string(clientAddr.port) + ") disconnected.";
     std::cout << msg << "\n";
     ServerTCP& server = *((ServerTCP*)GetUserPtr());
-    for (const Address& addr : server.getClientAddresses())
-    {
-        if (clientAddr == addr) continue;
-        server.send((void*)msg.c_str(), strlen(msg.c_str()), addr);
-    }
+    server.broadcast((void*)msg.c_str(), strlen(msg.c_str()), clientAddr);
 }
 
 int main()
@@ -46,10 +34,7 @@ int main()
     std::cout << "SERVER\n\n";
 
     Garnet::Init(true);
-    ServerTCP server(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    ServerTCP server(Address("127.0.0.1", 55555));
     SetUserPtr(&server);
 
     server.setReceiveCallback(receive);
@@ -62,10 +47,7 @@ int main()
     {
         std::cin.getline(buffer + 8, sizeof(buffer) - 8);
 
-        for (const Address& addr : server.getClientAddresses())
-        {
-            server.send(buffer, sizeof(buffer), addr);
-        }
+        server.broadcast(buffer, sizeof(buffer));
 
         if (strcmp(buffer, "Server: !quit") == 0) break;
     }
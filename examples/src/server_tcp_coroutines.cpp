@@ -0,0 +1,69 @@
+#include <iostream>
+
+#include <Garnet.h>
+
+using namespace Garnet;
+
+// Echo server written with coroutines: every client is served by its own task with straight-line code,
+// and all of them run on the one thread of an EventLoop. Connect with client-tcp, or e.g. `nc 127.0.0.1 55555`.
+
+#ifdef GNET_COROUTINES
+
+Task<> serve(Socket client)
+{
+    std::cout << "Connected with client (IP: " << client.getAddress().getHost() << ", port " << client.getAddress().port << ")\n";
+
+    char buffer[256];
+    while (true)
+    {
+        bool success;
+        int nBytes = co_await client.asyncReceive(buffer, sizeof(buffer), &success);
+        if (!success || nBytes <= 0) break;
+
+        co_await client.asyncSend(buffer, nBytes, &success);
+        if (!success) break;
+    }
+
+    std::cout << "Client disconnected (IP: " << client.getAddress().getHost() << ", port " << client.getAddress().port << ")\n";
+    client.close();
+}
+
+Task<> acceptClients(EventLoop& loop, Socket& serverSocket)
+{
+    while (true)
+    {
+        bool success;
+        Socket client = co_await serverSocket.asyncAccept(&success);
+        if (!success) break;
+        loop.spawn(serve(client));
+    }
+}
+
+int main()
+{
+    std::cout << "SERVER\n\n";
+
+    Garnet::Init(true);
+    Socket serverSocket(Protocol::TCP);
+    serverSocket.bind(Address("127.0.0.1", 55555));
+    serverSocket.listen(128);
+    std::cout << "Echoing on port 55555, press Ctrl+C to exit\n\n";
+
+    EventLoop loop;
+    loop.spawn(acceptClients(loop, serverSocket));
+    loop.run();
+
+    serverSocket.close();
+    Garnet::Terminate();
+    return 0;
+}
+
+#else
+
+int main()
+{
+    std::cout << "This example needs C++20 coroutines.\n";
+    return 0;
+}
+
+#endif
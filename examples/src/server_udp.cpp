@@ -10,10 +10,7 @@ int main()
 
     Garnet::Init(true);
     Socket serverSocket(Protocol::UDP);
-    serverSocket.bind(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    serverSocket.bind(Address("127.0.0.1", 55555));
 
     std::cout << "CHAT STARTED ----- enter '!quit' to exit\n\n";
     char buffer[256];
@@ -30,7 +27,7 @@ int main()
                 std::cout << "Client left the chat.\n";
                 break;
             }
-            else std::cout << "Client (" << clientAddr.host << ":" << clientAddr.port << "): " << buffer << "\n";
+            else std::cout << "Client (" << clientAddr.getHost() << ":" << clientAddr.port << "): " << buffer << "\n";
         }
         else continue;
 
@@ -6,22 +6,22 @@ using namespace Garnet;
 
 std::vector<Address> clientAddresses = {};
 
-void receive(void* buffer, int bufferSize, int actualSize, Address clientAddr)
+void receive(const Buffer& buffer, int actualSize, Address clientAddr)
 {
+    const char* data = (const char*)buffer.getData();
     if (std::find(clientAddresses.begin(), clientAddresses.end(), clientAddr) == clientAddresses.end())
     {
         clientAddresses.push_back(clientAddr);
     }
 
-    if (strcmp((const char*)buffer, "!quit") == 0)
+    if (strcmp(data, "!quit") == 0)
     {
-        std::cout << "Client (" << clientAddr.host << ":" << clientAddr.port << ") left the chat.\n";
+        std::cout << "Client (" << clientAddr.getHost() << ":" << clientAddr.port << ") left the chat.\n";
         clientAddresses.erase(std::remove(clientAddresses.begin(), clientAddresses.end(), clientAddr), clientAddresses.end());
-        delete buffer;
         return;
     }
 
-    std::string msg = "Client (" + clientAddr.host + ":" + std::to_string(clientAddr.port) + "): " + std::string((const char*)buffer, actualSize);
+    std::string msg = "Client (" + clientAddr.getHost() + ":" + std::to_string(clientAddr.port) + "): " + std::string(data, actualSize);
     std::cout << msg << "\n";
     ServerUDP& server = *((ServerUDP*)GetUserPtr());
     for (const Address& addr : clientAddresses)
@@ -29,8 +29,6 @@ void receive(void* buffer, int bufferSize, int actualSize, Address clientAddr)
         if (clientAddr == addr) continue;
         server.send((void*)msg.c_str(), strlen(msg.c_str()), addr);
     }
-
-    delete buffer;
 }
 
 int main()
@@ -38,10 +36,7 @@ int main()
     std::cout << "SERVER\n\n";
 
     Garnet::Init(true);
-    ServerUDP server(Address{
-        .host = "127.0.0.1",
-        .port = 55555
-    });
+    ServerUDP server(Address("127.0.0.1", 55555));
     SetUserPtr(&server);
 
     server.setReceiveCallback(receive);
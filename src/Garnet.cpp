@@ -2,6 +2,16 @@
 
 #include <iostream>
 #include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <new>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <queue>
 
 #ifdef GNET_OS_WINDOWS
     bool wsaInitialized = false;
@@ -14,6 +24,7 @@
 
 std::string err;
 bool printErrors = false;
+static thread_local bool muteAcceptErrors = false; // set by the server accepting threads, where failed accepts are expected on close and are neither recorded nor printed
 void* userPtr = nullptr;
 
 // b = backend
@@ -24,8 +35,9 @@ void* userPtr = nullptr;
     SOCKADDR_IN addr_gtob(Garnet::Address addr)
     {
         SOCKADDR_IN bAddr;
+        memset(&bAddr, 0, sizeof(bAddr));
         bAddr.sin_family = AF_INET;
-        inet_pton(AF_INET, addr.host.c_str(), &bAddr.sin_addr.s_addr);
+        memcpy(&bAddr.sin_addr.s_addr, addr.getBytes(), 4);
         bAddr.sin_port = htons(addr.port);
         return bAddr;
     }
@@ -33,9 +45,7 @@ void* userPtr = nullptr;
     Garnet::Address addr_btog(SOCKADDR_IN addr)
     {
         Garnet::Address gAddr;
-        char buf[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &addr.sin_addr.s_addr, buf, sizeof(buf));
-        gAddr.host = std::string(buf);
+        gAddr.setBytes(&addr.sin_addr.s_addr, false);
         gAddr.port = ntohs(addr.sin_port); 
         return gAddr;
     }
@@ -47,7 +57,7 @@ void* userPtr = nullptr;
         sockaddr_in bAddr;
         memset(&bAddr, 0, sizeof(bAddr)); // Ensure struct is zeroed out
         bAddr.sin_family = AF_INET;
-        inet_pton(AF_INET, addr.host.c_str(), &bAddr.sin_addr.s_addr);
+        memcpy(&bAddr.sin_addr.s_addr, addr.getBytes(), 4);
         bAddr.sin_port = htons(addr.port);
         return bAddr;
     }
@@ -55,24 +65,108 @@ void* userPtr = nullptr;
     Garnet::Address addr_btog(sockaddr_in addr) 
     {
         Garnet::Address gAddr;
-        char buf[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &addr.sin_addr.s_addr, buf, sizeof(buf));
-        gAddr.host = std::string(buf);
+        gAddr.setBytes(&addr.sin_addr.s_addr, false);
         gAddr.port = ntohs(addr.sin_port);
         return gAddr;
     }
 
 #endif
 
-void Garnet::Address::operator=(const Address& other)
+Garnet::Address::Address()
 {
-    host = other.host;
-    port = other.port;
+    port = 0;
+    memset(m_ip, 0, sizeof(m_ip));
+    m_family = 0;
+}
+
+Garnet::Address::Address(const std::string& host, ushort _port, bool* success)
+{
+    port = _port;
+    memset(m_ip, 0, sizeof(m_ip));
+    m_family = 0;
+    setHost(host, success);
+}
+
+std::string Garnet::Address::getHost() const
+{
+    if (m_family == 0) return "";
+
+    char buf[INET6_ADDRSTRLEN];
+    if (inet_ntop(m_family == 6 ? AF_INET6 : AF_INET, m_ip, buf, sizeof(buf)) == nullptr) return "";
+    return std::string(buf);
+}
+
+void Garnet::Address::setHost(const std::string& host, bool* success)
+{
+    memset(m_ip, 0, sizeof(m_ip));
+    m_family = 0;
+
+    if (host.empty())
+    {
+        if (success != nullptr) *success = true;
+        return;
+    }
+
+    if (inet_pton(AF_INET, host.c_str(), m_ip) == 1) m_family = 4;
+    else if (inet_pton(AF_INET6, host.c_str(), m_ip) == 1) m_family = 6;
+    else
+    {
+        bool resolved;
+        std::vector<Address> addresses = Resolver::getDefault().resolve(host, &resolved);
+        if (!resolved)
+        {
+            if (success != nullptr) *success = false;
+            return;
+        }
+        memcpy(m_ip, addresses[0].getBytes(), 4);
+        m_family = 4;
+    }
+
+    if (success != nullptr) *success = true;
+}
+
+const unsigned char* Garnet::Address::getBytes() const
+{
+    return m_ip;
+}
+
+void Garnet::Address::setBytes(const void* ip, bool ipv6)
+{
+    memset(m_ip, 0, sizeof(m_ip));
+    memcpy(m_ip, ip, ipv6 ? 16 : 4);
+    m_family = ipv6 ? 6 : 4;
+}
+
+bool Garnet::Address::isEmpty() const
+{
+    return m_family == 0;
+}
+
+bool Garnet::Address::isIPv6() const
+{
+    return m_family == 6;
+}
+
+size_t Garnet::Address::getHash() const
+{
+    uint64_t lo, hi;
+    memcpy(&lo, m_ip, 8);
+    memcpy(&hi, m_ip + 8, 8);
+    uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ULL)) ^ ((uint64_t)port << 48 | (uint64_t)m_family << 40);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (size_t)h;
 }
 
 bool Garnet::Address::operator==(const Address& other) const
 {
-    return (host == other.host && port == other.port);
+    return port == other.port && m_family == other.m_family && memcmp(m_ip, other.m_ip, sizeof(m_ip)) == 0;
+}
+
+bool Garnet::Address::operator!=(const Address& other) const
+{
+    return !(*this == other);
 }
 
 int Garnet::GetVersionMajor()
@@ -148,6 +242,12 @@ const std::string& Garnet::GetLastError()
     return err;
 }
 
+void Garnet::SetLastError(const std::string& message)
+{
+    err = message;
+    if (printErrors) std::cout << err << "\n";
+}
+
 void Garnet::SetUserPtr(void* ptr)
 {
     userPtr = ptr;
@@ -160,41 +260,462 @@ void* Garnet::GetUserPtr()
 
 std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
 {
-    struct addrinfo hints, *res;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;  // Use IPv4
-    hints.ai_socktype = SOCK_STREAM;  // Use TCP
+    std::vector<Address> addresses = Resolver::getDefault().resolve(hostname, success);
+    return addresses.empty() ? "" : addresses[0].getHost();
+}
+
+// converts an address to a backend address, failing if it has no host (which only means 'any' when binding) or cannot be reached from an IPv4 socket
+static bool resolveAddress(const Garnet::Address& addr, sockaddr_in* bAddr)
+{
+    if (addr.isEmpty() || addr.isIPv6()) return false;
+    *bAddr = addr_gtob(addr);
+    return true;
+}
+
+// why resolveAddress() failed for an address, for error messages
+static std::string getUnresolvedReason(const Garnet::Address& addr)
+{
+    if (addr.isEmpty()) return "the address has no host";
+    return "IPv6 addresses cannot be reached from IPv4 sockets";
+}
+
+// joins a thread, unless it is the calling one (closing from inside a callback), which is detached to finish on its own
+static void joinThread(std::thread& thread)
+{
+    if (!thread.joinable()) return;
+    if (thread.get_id() == std::this_thread::get_id()) thread.detach();
+    else thread.join();
+}
 
-    if (getaddrinfo(hostname.c_str(), nullptr, &hints, &res) != 0)
+#ifdef GNET_OS_UNIX
+
+    // a stream peer that has gone away should make send() fail, not raise a SIGPIPE that kills the process
+#ifdef MSG_NOSIGNAL
+    const int streamSendFlags = MSG_NOSIGNAL;
+#else
+    const int streamSendFlags = 0;
+#endif
+
+#ifdef GNET_OS_LINUX
+    // blocks SIGPIPE on the calling thread for as long as it lives, for sendfile(), which cannot take MSG_NOSIGNAL;
+    // a SIGPIPE raised meanwhile is consumed, so that a client going away mid-transfer only fails the call
+    class SigPipeGuard
     {
-        err = "Failed to resolve hostname: '" + hostname + "'";
-        if (printErrors) std::cout << err << "\n";
-        if (success != nullptr) *success = false;
-        return "";
+    public:
+        SigPipeGuard()
+        {
+            sigemptyset(&m_sigPipe);
+            sigaddset(&m_sigPipe, SIGPIPE);
+            sigset_t pending;
+            sigpending(&pending);
+            m_wasPending = sigismember(&pending, SIGPIPE) == 1;
+            pthread_sigmask(SIG_BLOCK, &m_sigPipe, &m_oldMask);
+        }
+
+        ~SigPipeGuard()
+        {
+            // one that was pending before is not ours to consume
+            if (!m_wasPending)
+            {
+                sigset_t pending;
+                sigpending(&pending);
+                if (sigismember(&pending, SIGPIPE) == 1)
+                {
+                    timespec noWait{};
+                    sigtimedwait(&m_sigPipe, nullptr, &noWait);
+                }
+            }
+            pthread_sigmask(SIG_SETMASK, &m_oldMask, nullptr);
+        }
+
+    private:
+        sigset_t m_sigPipe;
+        sigset_t m_oldMask;
+        bool m_wasPending;
+    };
+#endif
+
+    // sockets on platforms without MSG_NOSIGNAL (macOS, the BSDs) opt out of SIGPIPE once, when they are created or accepted
+    static void suppressSigPipe(int socket)
+    {
+    #ifdef SO_NOSIGPIPE
+        int opt = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
+    #else
+        (void)socket;
+    #endif
+    }
+
+    // converts spans to iovecs, on the stack unless there are a lot of them
+    class IOVecs
+    {
+    public:
+        IOVecs(const Garnet::Span* spans, int count)
+        {
+            m_iovs = count <= maxStack ? m_stack : (m_heap = std::vector<iovec>(count)).data();
+            for (int i = 0; i < count; i++)
+            {
+                m_iovs[i].iov_base = spans[i].data;
+                m_iovs[i].iov_len = spans[i].size;
+            }
+        }
+
+        iovec* get()
+        {
+            return m_iovs;
+        }
+
+    private:
+        static const int maxStack = 16;
+        iovec m_stack[maxStack];
+        std::vector<iovec> m_heap;
+        iovec* m_iovs;
+    };
+
+#endif
+
+#ifdef GNET_OS_LINUX
+
+    // payloads below this are copied even by sendZeroCopy(), as pinning pages and handling the notification costs more than the copy
+    const int zeroCopyMinSize = 10 * 1024;
+
+    // zero-copy bookkeeping for one socket, kept by descriptor since Socket is a copyable handle
+    struct ZeroCopyState
+    {
+        std::mutex sendMtx;             // serializes sends, so that kernel notification ids are consumed in token order
+        std::mutex mtx;                 // guards the fields below
+        uint32_t nextId = 0;            // the kernel's notification id for the next MSG_ZEROCOPY send that transmits anything
+        uint32_t doneId = 0;            // every notification id below this has completed
+        unsigned int nextToken = 0;
+        std::deque<std::pair<unsigned int, uint32_t>> pending;  // tokens with the last notification id they wait on
+
+        // completed id ranges [first, end) beyond doneId: notifications can arrive out of order (e.g. after a retransmit),
+        // and a later range says nothing about the ids before it
+        std::vector<std::pair<uint32_t, uint32_t>> completed;
+
+        void complete(uint32_t first, uint32_t end)
+        {
+            completed.push_back({ first, end });
+
+            // advance doneId over every range that now joins up with it; the ids wrap around, so compare them relative to doneId
+            bool advanced = true;
+            while (advanced)
+            {
+                advanced = false;
+                for (size_t i = 0; i < completed.size();)
+                {
+                    if ((int32_t)(completed[i].first - doneId) > 0)
+                    {
+                        i++;
+                        continue;
+                    }
+                    if ((int32_t)(completed[i].second - doneId) > 0)
+                    {
+                        doneId = completed[i].second;
+                        advanced = true;
+                    }
+                    completed.erase(completed.begin() + i);
+                }
+            }
+        }
+    };
+
+    static std::mutex zeroCopyStatesMtx;
+    static std::unordered_map<int, std::shared_ptr<ZeroCopyState>> zeroCopyStates;
+
+    static std::shared_ptr<ZeroCopyState> findZeroCopyState(int fd)
+    {
+        std::lock_guard<std::mutex> lock(zeroCopyStatesMtx);
+        auto it = zeroCopyStates.find(fd);
+        if (it == zeroCopyStates.end()) return nullptr;
+        return it->second;
+    }
+
+    // like a blocking recv(), except that it also returns (with wouldBlock set) when only zero-copy completions are ready,
+    // since a blocking recv() never wakes for the error queue
+    static int recvOrZeroCopyCompletion(int fd, void* buffer, int bufferSize, bool* wouldBlock)
+    {
+        *wouldBlock = false;
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, -1) == -1)
+        {
+            *wouldBlock = errno == EINTR;
+            return -1;
+        }
+
+        int nBytes = ::recv(fd, buffer, bufferSize, MSG_DONTWAIT);
+        if (nBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) *wouldBlock = true;
+        return nBytes;
     }
 
-    char ipStr[INET_ADDRSTRLEN];
-    if (inet_ntop(AF_INET, &(((struct sockaddr_in*)res->ai_addr)->sin_addr), ipStr, sizeof(ipStr)) == nullptr)
+#endif
+
+Garnet::Endpoint::Endpoint()
+{
+    memset(&m_bAddr, 0, sizeof(m_bAddr));
+    m_bAddr.sin_family = AF_INET;
+    m_valid = false;
+}
+
+Garnet::Endpoint::Endpoint(Address addr, bool* success)
+{
+    m_addr = addr;
+    m_valid = resolveAddress(addr, &m_bAddr);
+    if (!m_valid)
     {
-        freeaddrinfo(res);
-        err = "Failed to convert address to string";
+        err = "Failed to create endpoint: " + getUnresolvedReason(addr);
         if (printErrors) std::cout << err << "\n";
-        if (success != nullptr) *success = false;
-        return "";
     }
+    if (success != nullptr) *success = m_valid;
+}
 
-    std::string ipAddr(ipStr);
-    freeaddrinfo(res);
-    if (success != nullptr) *success = true;
-    return ipAddr;
+const Garnet::Address& Garnet::Endpoint::getAddress() const
+{
+    return m_addr;
+}
+
+bool Garnet::Endpoint::isValid() const
+{
+    return m_valid;
+}
+
+struct alignas(16) Garnet::Buffer::Block
+{
+    std::atomic<int> refs;
+    int sizeClass;  // index into the pool's free lists, or -1 if the block is too big to be pooled
+    Pool* owner;    // the pool the block was acquired from, which it goes back to wherever it is released
+    Block* next;
+};
+
+// every thread allocates from its own pool; a block released on another thread is pushed onto its owner's return list,
+// which the owner only takes from as a whole once its own free list runs dry, so blocks don't drift from producer threads to consumer threads
+struct Garnet::Buffer::Pool
+{
+    static const int minClassSize = 64;     // size class i holds blocks of minClassSize << i bytes
+    static const int nClasses = 15;         // up to 1 MB
+    static const int maxFreePerClass = 64;
+
+    Block* freeLists[nClasses] = {};
+    int nFree[nClasses] = {};
+    std::atomic<Block*> returned{ nullptr };
+
+    // a pool outlives its thread, since blocks still out in other threads are returned to it; the next new thread takes it over
+    static Pool* adopt()
+    {
+        std::lock_guard<std::mutex> lock(getRetiredMtx());
+        std::vector<Pool*>& retired = getRetired();
+        if (retired.empty()) return new Pool();
+
+        Pool* pool = retired.back();
+        retired.pop_back();
+        return pool;
+    }
+
+    static void retire(Pool* pool)
+    {
+        std::lock_guard<std::mutex> lock(getRetiredMtx());
+        getRetired().push_back(pool);
+    }
+
+    Block* acquire(int size)
+    {
+        int sizeClass = 0;
+        while (sizeClass < nClasses && (minClassSize << sizeClass) < size) sizeClass++;
+
+        if (sizeClass < nClasses && freeLists[sizeClass] == nullptr && returned.load(std::memory_order_relaxed) != nullptr) takeReturned();
+
+        Block* block;
+        if (sizeClass < nClasses && freeLists[sizeClass] != nullptr)
+        {
+            block = freeLists[sizeClass];
+            freeLists[sizeClass] = block->next;
+            nFree[sizeClass]--;
+        }
+        else
+        {
+            int capacity = sizeClass < nClasses ? (minClassSize << sizeClass) : size;
+            block = new (::operator new(sizeof(Block) + capacity)) Block();
+            block->sizeClass = sizeClass < nClasses ? sizeClass : -1;
+            block->owner = this;
+        }
+
+        block->refs.store(1, std::memory_order_relaxed);
+        block->next = nullptr;
+        return block;
+    }
+
+    // must be called on the releasing thread's own pool
+    void release(Block* block)
+    {
+        if (block->sizeClass >= 0 && block->owner != this)
+        {
+            Pool* owner = block->owner;
+            Block* head = owner->returned.load(std::memory_order_relaxed);
+            do block->next = head;
+            while (!owner->returned.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+            return;
+        }
+
+        keep(block);
+    }
+
+private:
+    // never destroyed, since the main thread retires its pool during static destruction, and blocks held by static objects are released after that
+    static std::vector<Pool*>& getRetired()
+    {
+        static std::vector<Pool*>* retired = new std::vector<Pool*>();
+        return *retired;
+    }
+
+    static std::mutex& getRetiredMtx()
+    {
+        static std::mutex mtx;
+        return mtx;
+    }
+
+    void keep(Block* block)
+    {
+        if (block->sizeClass >= 0 && nFree[block->sizeClass] < maxFreePerClass)
+        {
+            block->next = freeLists[block->sizeClass];
+            freeLists[block->sizeClass] = block;
+            nFree[block->sizeClass]++;
+            return;
+        }
+
+        block->~Block();
+        ::operator delete(block);
+    }
+
+    void takeReturned()
+    {
+        Block* block = returned.exchange(nullptr, std::memory_order_acquire);
+        while (block != nullptr)
+        {
+            Block* next = block->next;
+            keep(block);
+            block = next;
+        }
+    }
+};
+
+Garnet::Buffer::Pool& Garnet::Buffer::getPool()
+{
+    struct Holder
+    {
+        Pool* pool = Pool::adopt();
+        ~Holder() { Pool::retire(pool); }
+    };
+    thread_local Holder holder;
+    return *holder.pool;
+}
+
+Garnet::Buffer::Buffer()
+{
+    m_block = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+Garnet::Buffer::Buffer(int size)
+{
+    m_block = getPool().acquire(size);
+    m_data = (char*)(m_block + 1);
+    m_size = size;
+}
+
+Garnet::Buffer::Buffer(const Buffer& other)
+{
+    m_block = other.m_block;
+    m_data = other.m_data;
+    m_size = other.m_size;
+    if (m_block != nullptr) m_block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+Garnet::Buffer::Buffer(Buffer&& other) noexcept
+{
+    m_block = other.m_block;
+    m_data = other.m_data;
+    m_size = other.m_size;
+    other.m_block = nullptr;
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+Garnet::Buffer& Garnet::Buffer::operator=(const Buffer& other)
+{
+    if (this == &other) return *this;
+    if (other.m_block != nullptr) other.m_block->refs.fetch_add(1, std::memory_order_relaxed);
+    release();
+    m_block = other.m_block;
+    m_data = other.m_data;
+    m_size = other.m_size;
+    return *this;
+}
+
+Garnet::Buffer& Garnet::Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this == &other) return *this;
+    release();
+    m_block = other.m_block;
+    m_data = other.m_data;
+    m_size = other.m_size;
+    other.m_block = nullptr;
+    other.m_data = nullptr;
+    other.m_size = 0;
+    return *this;
+}
+
+Garnet::Buffer::~Buffer()
+{
+    release();
+}
+
+void* Garnet::Buffer::getData() const
+{
+    return m_data;
+}
+
+int Garnet::Buffer::getSize() const
+{
+    return m_size;
+}
+
+bool Garnet::Buffer::isValid() const
+{
+    return m_block != nullptr;
+}
+
+Garnet::Buffer Garnet::Buffer::slice(int offset, int size) const
+{
+    Buffer part;
+    if (m_block == nullptr || offset < 0 || size < 0 || offset + size > m_size) return part;
+
+    m_block->refs.fetch_add(1, std::memory_order_relaxed);
+    part.m_block = m_block;
+    part.m_data = m_data + offset;
+    part.m_size = size;
+    return part;
+}
+
+void Garnet::Buffer::release()
+{
+    if (m_block != nullptr && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        getPool().release(m_block);
+    }
+    m_block = nullptr;
+    m_data = nullptr;
+    m_size = 0;
 }
 
 #ifdef GNET_OS_WINDOWS
 
     Garnet::Socket::Socket()
     {
-        m_addr.host = "";
-        m_addr.port = 0;
+        m_addr = Address();
         m_proto = Protocol::Null;
         m_bSocket = INVALID_SOCKET;
         m_bAddr.sin_family = AF_INET;
@@ -204,8 +725,7 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
 
     Garnet::Socket::Socket(Protocol proto, bool* success)
     {
-        m_addr.host = "";
-        m_addr.port = 0;
+        m_addr = Address();
         m_proto = proto;
         m_bSocket = INVALID_SOCKET;
         m_bAddr.sin_family = AF_INET;
@@ -293,8 +813,12 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         acceptSocket = ::accept(m_bSocket, (SOCKADDR*)&retval.m_bAddr, &retval.m_bAddrSize);
         if (acceptSocket == INVALID_SOCKET)
         {
-            err = "Socket accept failed. WSA error code: " + std::to_string(WSAGetLastError());
-            if (printErrors) std::cout << err << "\n";
+            // the server's accepting threads fail here together on close, and must not all write the shared error at once
+            if (!muteAcceptErrors)
+            {
+                err = "Socket accept failed. WSA error code: " + std::to_string(WSAGetLastError());
+                if (printErrors) std::cout << err << "\n";
+            }
             if (success != nullptr) *success = false;
             return retval;
         }
@@ -311,22 +835,14 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
     void Garnet::Socket::connect(Address addr, bool* success)
     {
         SOCKADDR_IN bAddr;
-        struct addrinfo hints, *res;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        if (getaddrinfo(addr.host.c_str(), std::to_string(addr.port).c_str(), &hints, &res) != 0)
+        if (!resolveAddress(addr, &bAddr))
         {
-            err = "Socket connect failed: failed to resolve host";
+            err = "Socket connect failed: " + getUnresolvedReason(addr);
             if (printErrors) std::cout << err << "\n";
             if (success != nullptr) *success = false;
             return;
         }
 
-        bAddr = *(SOCKADDR_IN*)res->ai_addr;
-        freeaddrinfo(res);
-
         if (::connect(m_bSocket, (SOCKADDR*)&bAddr, sizeof(bAddr)) == SOCKET_ERROR)
         {
             err = "Socket connect failed. WSA error code: " + std::to_string(WSAGetLastError());
@@ -352,51 +868,312 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         return nBytes;
     }
 
-    int Garnet::Socket::sendTo(void* data, int size, Address to, bool* success)
+    long long Garnet::Socket::sendFile(const std::string& path, long long offset, long long length, bool* success)
     {
-        SOCKADDR_IN bTo;
-        struct addrinfo hints, *res;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_DGRAM;
-
-        if (getaddrinfo(to.host.c_str(), std::to_string(to.port).c_str(), &hints, &res) != 0)
+        int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+        if (fd == -1)
         {
-            err = "sendTo failed: failed to resolve host";
+            err = "sendFile failed: could not open '" + path + "'";
             if (printErrors) std::cout << err << "\n";
             if (success != nullptr) *success = false;
-            return SOCKET_ERROR;
+            return -1;
         }
 
-        bTo = *(SOCKADDR_IN*)res->ai_addr;
-        freeaddrinfo(res);
-
-        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (SOCKADDR*)&bTo, sizeof(bTo));
-        if (success != nullptr) *success = nBytes != SOCKET_ERROR;
-        return nBytes;
+        long long sent = sendFile(fd, offset, length, success);
+        _close(fd);
+        return sent;
     }
 
-    int Garnet::Socket::receiveFrom(void* buffer, int bufferSize, Address* from, bool* success)
+    long long Garnet::Socket::sendFile(int fileDescriptor, long long offset, long long length, bool* success)
     {
-        SOCKADDR_IN bFrom;
-        int bFromSize = sizeof(bFrom);
-        int nBytes = ::recvfrom(m_bSocket, (char*)buffer, bufferSize, 0, (SOCKADDR*)&bFrom, &bFromSize);
-        if (success != nullptr) *success = nBytes != SOCKET_ERROR;
-        if (from != nullptr && nBytes != SOCKET_ERROR) *from = addr_btog(bFrom);
-        return nBytes;
+        HANDLE file = (HANDLE)_get_osfhandle(fileDescriptor);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+        {
+            err = "sendFile failed: invalid file descriptor";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        if (length < 0) length = fileSize.QuadPart - offset;
+        if (offset < 0 || length < 0 || offset + length > fileSize.QuadPart)
+        {
+            err = "sendFile failed: range is outside of the file";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        long long sent = 0;
+        while (sent < length)
+        {
+            // TransmitFile takes a 32-bit length, so send huge ranges in chunks
+            DWORD chunk = (DWORD)std::min<long long>(length - sent, 1 << 30);
+            LARGE_INTEGER pos;
+            pos.QuadPart = offset + sent;
+            if (!SetFilePointerEx(file, pos, nullptr, FILE_BEGIN)) break;
+            if (!TransmitFile(m_bSocket, file, chunk, 0, nullptr, nullptr, 0)) break;
+            sent += chunk;
+        }
+
+        if (success != nullptr) *success = sent == length;
+        return sent > 0 || length == 0 ? sent : -1;
     }
 
-    void Garnet::Socket::close()
+    int Garnet::Socket::sendv(const Span* spans, int count, bool* success)
+    {
+        std::vector<WSABUF> bufs(count);
+        for (int i = 0; i < count; i++)
+        {
+            bufs[i].buf = (char*)spans[i].data;
+            bufs[i].len = spans[i].size;
+        }
+
+        DWORD nBytes = 0;
+        if (WSASend(m_bSocket, bufs.data(), count, &nBytes, 0, nullptr, nullptr) == SOCKET_ERROR)
+        {
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        if (success != nullptr) *success = true;
+        return (int)nBytes;
+    }
+
+    int Garnet::Socket::receivev(const Span* spans, int count, bool* success)
+    {
+        std::vector<WSABUF> bufs(count);
+        for (int i = 0; i < count; i++)
+        {
+            bufs[i].buf = (char*)spans[i].data;
+            bufs[i].len = spans[i].size;
+        }
+
+        DWORD nBytes = 0, flags = 0;
+        if (WSARecv(m_bSocket, bufs.data(), count, &nBytes, &flags, nullptr, nullptr) == SOCKET_ERROR)
+        {
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        if (success != nullptr) *success = true;
+        return (int)nBytes;
+    }
+
+    int Garnet::Socket::sendTo(void* data, int size, Address to, bool* success)
+    {
+        SOCKADDR_IN bTo;
+        if (!resolveAddress(to, &bTo))
+        {
+            err = "sendTo failed: " + getUnresolvedReason(to);
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (SOCKADDR*)&bTo, sizeof(bTo));
+        if (success != nullptr) *success = nBytes != SOCKET_ERROR;
+        return nBytes;
+    }
+
+    int Garnet::Socket::sendTo(void* data, int size, const Endpoint& to, bool* success)
+    {
+        if (!to.isValid())
+        {
+            err = "sendTo failed: the endpoint is not valid";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (SOCKADDR*)&to.m_bAddr, sizeof(to.m_bAddr));
+        if (success != nullptr) *success = nBytes != SOCKET_ERROR;
+        return nBytes;
+    }
+
+    int Garnet::Socket::sendTo(const Span* spans, int count, Address to, bool* success)
+    {
+        SOCKADDR_IN bTo;
+        if (!resolveAddress(to, &bTo))
+        {
+            err = "sendTo failed: " + getUnresolvedReason(to);
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        std::vector<WSABUF> bufs(count);
+        for (int i = 0; i < count; i++)
+        {
+            bufs[i].buf = (char*)spans[i].data;
+            bufs[i].len = spans[i].size;
+        }
+
+        DWORD nBytes = 0;
+        if (WSASendTo(m_bSocket, bufs.data(), count, &nBytes, 0, (SOCKADDR*)&bTo, sizeof(bTo), nullptr, nullptr) == SOCKET_ERROR)
+        {
+            if (success != nullptr) *success = false;
+            return SOCKET_ERROR;
+        }
+
+        if (success != nullptr) *success = true;
+        return (int)nBytes;
+    }
+
+    int Garnet::Socket::receiveFrom(void* buffer, int bufferSize, Address* from, bool* success)
+    {
+        SOCKADDR_IN bFrom;
+        int bFromSize = sizeof(bFrom);
+        int nBytes = ::recvfrom(m_bSocket, (char*)buffer, bufferSize, 0, (SOCKADDR*)&bFrom, &bFromSize);
+        if (success != nullptr) *success = nBytes != SOCKET_ERROR;
+        if (from != nullptr && nBytes != SOCKET_ERROR) *from = addr_btog(bFrom);
+        return nBytes;
+    }
+
+    void Garnet::Socket::setBlocking(bool blocking, bool* success)
+    {
+        u_long mode = blocking ? 0 : 1;
+        if (ioctlsocket(m_bSocket, FIONBIO, &mode) == SOCKET_ERROR)
+        {
+            err = "Failed to set socket blocking mode. WSA error code: " + std::to_string(WSAGetLastError());
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        if (success != nullptr) *success = true;
+    }
+
+    void Garnet::Socket::shutdown(bool* success)
+    {
+        if (::shutdown(m_bSocket, SD_BOTH) == SOCKET_ERROR)
+        {
+            err = "Socket shutdown failed. WSA error code: " + std::to_string(WSAGetLastError());
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        if (success != nullptr) *success = true;
+    }
+
+    void Garnet::Socket::close()
     {
         closesocket(m_bSocket);
         m_open = false;
     }
 
+    void Garnet::Socket::interrupt()
+    {
+        // Winsock only aborts a blocking call when its socket is closed, so close it here and leave close() nothing to do
+        closesocket(m_bSocket);
+        m_bSocket = INVALID_SOCKET;
+    }
+
+    // Winsock has no MSG_DONTWAIT, so these check for readiness first; a ready socket's call then returns without waiting
+    static bool isReady(SOCKET socket, short events)
+    {
+        WSAPOLLFD pfd{};
+        pfd.fd = socket;
+        pfd.events = events;
+        return WSAPoll(&pfd, 1, 0) != 0;
+    }
+
+    int Garnet::Socket::tryReceive(void* buffer, int bufferSize, bool* wouldBlock)
+    {
+        *wouldBlock = !isReady(m_bSocket, POLLRDNORM);
+        if (*wouldBlock) return -1;
+
+        int nBytes = ::recv(m_bSocket, (char*)buffer, bufferSize, 0);
+        if (nBytes == SOCKET_ERROR)
+        {
+            err = "Socket receive failed. WSA error code: " + std::to_string(WSAGetLastError());
+            if (printErrors) std::cout << err << "\n";
+            return -1;
+        }
+        return nBytes;
+    }
+
+    int Garnet::Socket::trySend(const void* data, int size, bool* wouldBlock)
+    {
+        *wouldBlock = !isReady(m_bSocket, POLLWRNORM);
+        if (*wouldBlock) return -1;
+
+        int nBytes = ::send(m_bSocket, (const char*)data, size, 0);
+        if (nBytes == SOCKET_ERROR)
+        {
+            err = "Socket send failed. WSA error code: " + std::to_string(WSAGetLastError());
+            if (printErrors) std::cout << err << "\n";
+            return -1;
+        }
+        return nBytes;
+    }
+
+    Garnet::Socket Garnet::Socket::tryAccept(bool* wouldBlock, bool* success)
+    {
+        *wouldBlock = !isReady(m_bSocket, POLLRDNORM);
+        if (*wouldBlock)
+        {
+            *success = false;
+            return Socket();
+        }
+        return accept(success);
+    }
+
+    bool Garnet::Socket::beginConnect(Address addr, bool* wouldBlock)
+    {
+        *wouldBlock = false;
+        SOCKADDR_IN bAddr;
+        if (!resolveAddress(addr, &bAddr))
+        {
+            err = "Socket connect failed: " + getUnresolvedReason(addr);
+            if (printErrors) std::cout << err << "\n";
+            return false;
+        }
+
+        bool success;
+        setBlocking(false, &success);
+        if (!success) return false;
+
+        if (::connect(m_bSocket, (SOCKADDR*)&bAddr, sizeof(bAddr)) == SOCKET_ERROR)
+        {
+            int error = WSAGetLastError();
+            if (error == WSAEWOULDBLOCK)
+            {
+                *wouldBlock = true;
+                return false;
+            }
+
+            setBlocking(true);
+            err = "Socket connect failed. WSA error code: " + std::to_string(error);
+            if (printErrors) std::cout << err << "\n";
+            return false;
+        }
+
+        setBlocking(true);
+        return true;
+    }
+
+    bool Garnet::Socket::endConnect()
+    {
+        int error = 0;
+        int errorSize = sizeof(error);
+        if (getsockopt(m_bSocket, SOL_SOCKET, SO_ERROR, (char*)&error, &errorSize) == SOCKET_ERROR) error = WSAGetLastError();
+        setBlocking(true);
+        if (error != 0)
+        {
+            err = "Socket connect failed. WSA error code: " + std::to_string(error);
+            if (printErrors) std::cout << err << "\n";
+            return false;
+        }
+        return true;
+    }
+
 #elif defined(GNET_OS_UNIX)
     Garnet::Socket::Socket()
     {
-        m_addr.host = "";
-        m_addr.port = 0;
+        m_addr = Address();
         m_proto = Protocol::Null;
         m_bSocket = -1;
         m_bAddr.sin_family = AF_INET;
@@ -406,8 +1183,7 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
 
     Garnet::Socket::Socket(Protocol proto, bool* success)
     {
-        m_addr.host = "";
-        m_addr.port = 0;
+        m_addr = Address();
         m_proto = proto;
         m_bSocket = -1;
         m_bAddr.sin_family = AF_INET;
@@ -449,6 +1225,7 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
             err = "Socket creation incomplete: failed to set SO_REUSEADDR (not critical)";
             if (printErrors) std::cout << err << "\n";
         }
+        suppressSigPipe(m_bSocket);
 
         m_open = true;
         if (success != nullptr) *success = true;
@@ -495,8 +1272,12 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         acceptSocket = ::accept(m_bSocket, (sockaddr*)&retval.m_bAddr, &retval.m_bAddrSize);
         if (acceptSocket == -1)
         {
-            err = "Socket accept failed. Error: " + std::string(strerror(errno));
-            if (printErrors) std::cout << err << "\n";
+            // the server's accepting threads fail here together on close, and must not all write the shared error at once
+            if (!muteAcceptErrors)
+            {
+                err = "Socket accept failed. Error: " + std::string(strerror(errno));
+                if (printErrors) std::cout << err << "\n";
+            }
             if (success != nullptr) *success = false;
             return retval;
         }
@@ -504,6 +1285,7 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         retval.m_bSocket = acceptSocket;
         retval.m_addr = addr_btog(retval.m_bAddr);
         retval.m_proto = m_proto;
+        suppressSigPipe(acceptSocket);
 
         if (success != nullptr) *success = true;
 
@@ -513,22 +1295,14 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
     void Garnet::Socket::connect(Address addr, bool* success)
     {
         sockaddr_in bAddr;
-        struct addrinfo hints, *res;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        if (getaddrinfo(addr.host.c_str(), std::to_string(addr.port).c_str(), &hints, &res) != 0)
+        if (!resolveAddress(addr, &bAddr))
         {
-            err = "Socket connect failed: failed to resolve host";
+            err = "Socket connect failed: " + getUnresolvedReason(addr);
             if (printErrors) std::cout << err << "\n";
             if (success != nullptr) *success = false;
             return;
         }
 
-        bAddr = *(sockaddr_in*)res->ai_addr;
-        freeaddrinfo(res);
-
         if (::connect(m_bSocket, (sockaddr*)&bAddr, sizeof(bAddr)) == -1)
         {
             err = "Socket connect failed. Error: " + std::string(strerror(errno));
@@ -542,7 +1316,7 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
 
     int Garnet::Socket::send(void* data, int size, bool* success)
     {
-        int nBytes = ::send(m_bSocket, (char*)data, size, 0);
+        int nBytes = ::send(m_bSocket, (char*)data, size, streamSendFlags);
         if (success != nullptr) *success = nBytes != -1;
         return nBytes;
     }
@@ -554,26 +1328,180 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         return nBytes;
     }
 
+    long long Garnet::Socket::sendFile(const std::string& path, long long offset, long long length, bool* success)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            err = "sendFile failed: could not open '" + path + "'. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        long long sent = sendFile(fd, offset, length, success);
+        ::close(fd);
+        return sent;
+    }
+
+    long long Garnet::Socket::sendFile(int fileDescriptor, long long offset, long long length, bool* success)
+    {
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat) != 0)
+        {
+            err = "sendFile failed: invalid file descriptor. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        if (length < 0) length = fileStat.st_size - offset;
+        if (offset < 0 || length < 0 || offset + length > fileStat.st_size)
+        {
+            err = "sendFile failed: range is outside of the file";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        long long sent = 0;
+    #ifdef GNET_OS_LINUX
+        SigPipeGuard sigPipeGuard;
+        off_t pos = offset;
+        while (sent < length)
+        {
+            ssize_t nBytes = ::sendfile(m_bSocket, fileDescriptor, &pos, length - sent);
+            if (nBytes > 0)
+            {
+                sent += nBytes;
+                continue;
+            }
+            if (nBytes == 0) break; // the file was truncated underneath us
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) break;
+
+            pollfd pfd{};
+            pfd.fd = m_bSocket;
+            pfd.events = POLLOUT;
+            if (poll(&pfd, 1, -1) == -1 && errno != EINTR) break;
+        }
+    #else
+        // sendfile() differs between the BSDs, so bounce through a small buffer instead
+        char buf[64 * 1024];
+        bool failed = false;
+        while (sent < length && !failed)
+        {
+            ssize_t nRead = ::pread(fileDescriptor, buf, (size_t)std::min<long long>(sizeof(buf), length - sent), offset + sent);
+            if (nRead == -1 && errno == EINTR) continue;
+            if (nRead <= 0) break;
+
+            ssize_t bufSent = 0;
+            while (bufSent < nRead)
+            {
+                ssize_t nBytes = ::send(m_bSocket, buf + bufSent, nRead - bufSent, streamSendFlags);
+                if (nBytes >= 0)
+                {
+                    bufSent += nBytes;
+                    continue;
+                }
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    failed = true;
+                    break;
+                }
+
+                pollfd pfd{};
+                pfd.fd = m_bSocket;
+                pfd.events = POLLOUT;
+                if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+                {
+                    failed = true;
+                    break;
+                }
+            }
+            sent += bufSent;
+        }
+    #endif
+
+        if (success != nullptr) *success = sent == length;
+        return sent > 0 || length == 0 ? sent : -1;
+    }
+
+    int Garnet::Socket::sendv(const Span* spans, int count, bool* success)
+    {
+        IOVecs iovs(spans, count);
+        msghdr msg{};
+        msg.msg_iov = iovs.get();
+        msg.msg_iovlen = count;
+
+        int nBytes = ::sendmsg(m_bSocket, &msg, streamSendFlags);
+        if (success != nullptr) *success = nBytes != -1;
+        return nBytes;
+    }
+
+    int Garnet::Socket::receivev(const Span* spans, int count, bool* success)
+    {
+        IOVecs iovs(spans, count);
+        msghdr msg{};
+        msg.msg_iov = iovs.get();
+        msg.msg_iovlen = count;
+
+        int nBytes = ::recvmsg(m_bSocket, &msg, 0);
+        if (success != nullptr) *success = nBytes != -1;
+        return nBytes;
+    }
+
     int Garnet::Socket::sendTo(void* data, int size, Address to, bool* success)
     {
         sockaddr_in bTo;
-        struct addrinfo hints, *res;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_DGRAM;
+        if (!resolveAddress(to, &bTo))
+        {
+            err = "sendTo failed: " + getUnresolvedReason(to);
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
 
-        if (getaddrinfo(to.host.c_str(), std::to_string(to.port).c_str(), &hints, &res) != 0)
+        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (sockaddr*)&bTo, sizeof(bTo));
+        if (success != nullptr) *success = nBytes != -1;
+        return nBytes;
+    }
+
+    int Garnet::Socket::sendTo(void* data, int size, const Endpoint& to, bool* success)
+    {
+        if (!to.isValid())
         {
-            err = "sendTo failed: failed to resolve host";
+            err = "sendTo failed: the endpoint is not valid";
             if (printErrors) std::cout << err << "\n";
             if (success != nullptr) *success = false;
             return -1;
         }
 
-        bTo = *(sockaddr_in*)res->ai_addr;
-        freeaddrinfo(res);
+        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (sockaddr*)&to.m_bAddr, sizeof(to.m_bAddr));
+        if (success != nullptr) *success = nBytes != -1;
+        return nBytes;
+    }
 
-        int nBytes = ::sendto(m_bSocket, (char*)data, size, 0, (sockaddr*)&bTo, sizeof(bTo));
+    int Garnet::Socket::sendTo(const Span* spans, int count, Address to, bool* success)
+    {
+        sockaddr_in bTo;
+        if (!resolveAddress(to, &bTo))
+        {
+            err = "sendTo failed: " + getUnresolvedReason(to);
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return -1;
+        }
+
+        IOVecs iovs(spans, count);
+        msghdr msg{};
+        msg.msg_name = &bTo;
+        msg.msg_namelen = sizeof(bTo);
+        msg.msg_iov = iovs.get();
+        msg.msg_iovlen = count;
+
+        int nBytes = ::sendmsg(m_bSocket, &msg, 0);
         if (success != nullptr) *success = nBytes != -1;
         return nBytes;
     }
@@ -588,15 +1516,163 @@ std::string Garnet::HostnameToIP(const std::string& hostname, bool* success)
         return nBytes;
     }
 
-    void Garnet::Socket::close()
+    void Garnet::Socket::setBlocking(bool blocking, bool* success)
     {
-        ::close(m_bSocket);
-        m_open = false;
+        int flags = fcntl(m_bSocket, F_GETFL, 0);
+        if (flags == -1 || fcntl(m_bSocket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) == -1)
+        {
+            err = "Failed to set socket blocking mode. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        if (success != nullptr) *success = true;
     }
-    
-#endif
 
-const Garnet::Address& Garnet::Socket::getAddress() const
+    void Garnet::Socket::shutdown(bool* success)
+    {
+        if (::shutdown(m_bSocket, SHUT_RDWR) == -1)
+        {
+            err = "Socket shutdown failed. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        if (success != nullptr) *success = true;
+    }
+
+    void Garnet::Socket::close()
+    {
+    #ifdef GNET_OS_LINUX
+        zeroCopyStatesMtx.lock();
+        zeroCopyStates.erase(m_bSocket);
+        zeroCopyStatesMtx.unlock();
+    #endif
+        ::close(m_bSocket);
+        m_open = false;
+    }
+
+    void Garnet::Socket::interrupt()
+    {
+        // on Linux this wakes accept() and receives on any socket, even listening or unconnected UDP ones where it reports ENOTCONN
+        int result = ::shutdown(m_bSocket, SHUT_RDWR);
+    #ifndef GNET_OS_LINUX
+        if (result == 0 || errno != ENOTCONN) return;
+
+        // elsewhere, those have to be woken by a connection or an empty datagram of our own
+        sockaddr_in self;
+        socklen_t selfSize = sizeof(self);
+        if (getsockname(m_bSocket, (sockaddr*)&self, &selfSize) == -1) return;
+        if (self.sin_addr.s_addr == htonl(INADDR_ANY)) self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int waker = ::socket(AF_INET, m_proto == Protocol::TCP ? SOCK_STREAM : SOCK_DGRAM, 0);
+        if (waker == -1) return;
+        if (m_proto == Protocol::TCP) ::connect(waker, (sockaddr*)&self, selfSize);
+        else ::sendto(waker, "", 0, 0, (sockaddr*)&self, selfSize);
+        ::close(waker);
+    #else
+        (void)result;
+    #endif
+    }
+
+    int Garnet::Socket::tryReceive(void* buffer, int bufferSize, bool* wouldBlock)
+    {
+        int nBytes;
+        do nBytes = ::recv(m_bSocket, (char*)buffer, bufferSize, MSG_DONTWAIT);
+        while (nBytes == -1 && errno == EINTR);
+
+        *wouldBlock = nBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        if (nBytes == -1 && !*wouldBlock)
+        {
+            err = "Socket receive failed. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+        }
+        return nBytes;
+    }
+
+    int Garnet::Socket::trySend(const void* data, int size, bool* wouldBlock)
+    {
+        int nBytes;
+        do nBytes = ::send(m_bSocket, (const char*)data, size, streamSendFlags | MSG_DONTWAIT);
+        while (nBytes == -1 && errno == EINTR);
+
+        *wouldBlock = nBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        if (nBytes == -1 && !*wouldBlock)
+        {
+            err = "Socket send failed. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+        }
+        return nBytes;
+    }
+
+    Garnet::Socket Garnet::Socket::tryAccept(bool* wouldBlock, bool* success)
+    {
+        // accept() has no per-call non-blocking flag, so only call it once a connection is pending
+        pollfd pfd{};
+        pfd.fd = m_bSocket;
+        pfd.events = POLLIN;
+        *wouldBlock = poll(&pfd, 1, 0) == 0;
+        if (*wouldBlock)
+        {
+            *success = false;
+            return Socket();
+        }
+        return accept(success);
+    }
+
+    bool Garnet::Socket::beginConnect(Address addr, bool* wouldBlock)
+    {
+        *wouldBlock = false;
+        sockaddr_in bAddr;
+        if (!resolveAddress(addr, &bAddr))
+        {
+            err = "Socket connect failed: " + getUnresolvedReason(addr);
+            if (printErrors) std::cout << err << "\n";
+            return false;
+        }
+
+        bool success;
+        setBlocking(false, &success);
+        if (!success) return false;
+
+        if (::connect(m_bSocket, (sockaddr*)&bAddr, sizeof(bAddr)) == -1)
+        {
+            if (errno == EINPROGRESS || errno == EINTR)
+            {
+                *wouldBlock = true;
+                return false;
+            }
+
+            err = "Socket connect failed. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            setBlocking(true);
+            return false;
+        }
+
+        setBlocking(true);
+        return true;
+    }
+
+    bool Garnet::Socket::endConnect()
+    {
+        int error = 0;
+        socklen_t errorSize = sizeof(error);
+        if (getsockopt(m_bSocket, SOL_SOCKET, SO_ERROR, &error, &errorSize) == -1) error = errno;
+        setBlocking(true);
+        if (error != 0)
+        {
+            err = "Socket connect failed. Error: " + std::string(strerror(error));
+            if (printErrors) std::cout << err << "\n";
+            return false;
+        }
+        return true;
+    }
+
+#endif
+
+const Garnet::Address& Garnet::Socket::getAddress() const
 {
     return m_addr;
 }
@@ -611,395 +1687,5791 @@ bool Garnet::Socket::isOpen() const
     return m_open;
 }
 
-Garnet::ServerTCP::ServerTCP()
+int Garnet::Socket::sendToSegmented(void* data, int size, int segmentSize, Address to, bool* success)
 {
-    m_addr.host = "";
-    m_addr.port = 0;
-    m_bufSize = 256;
-    m_nClients = 0;
-    m_open = false;
-    m_pReceiveCallback = nullptr;
-    m_pClientConnectCallback = nullptr;
-    m_pClientDisconnectCallback = nullptr;
+    if (segmentSize <= 0)
+    {
+        err = "sendToSegmented failed: segment size must be positive";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+#ifdef GNET_OS_LINUX
+    sockaddr_in bTo;
+    if (!resolveAddress(to, &bTo))
+    {
+        err = "sendToSegmented failed: " + getUnresolvedReason(to);
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+    // a single GSO send carries at most 64 segments and must fit in one 64 KB UDP datagram
+    const int maxSegments = 64;
+    const int maxPayload = 65000;
+    int chunkSize = std::max(1, std::min(maxSegments, maxPayload / segmentSize)) * segmentSize;
+
+    int sent = 0;
+    while (sent < size)
+    {
+        int chunk = std::min(size - sent, chunkSize);
+
+        iovec iov;
+        iov.iov_base = (char*)data + sent;
+        iov.iov_len = chunk;
+
+        msghdr msg{};
+        msg.msg_name = &bTo;
+        msg.msg_namelen = sizeof(bTo);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+        if (chunk > segmentSize)
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gsoSize = segmentSize;
+            memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+        }
+
+        int nBytes = sendmsg(m_bSocket, &msg, 0);
+        if (nBytes == -1 && errno == EINTR) continue;
+        if (nBytes == -1 && chunk > segmentSize && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+        {
+            // no GSO for this route / device, so send this chunk's datagrams one by one
+            int offset = 0;
+            while (offset < chunk)
+            {
+                int len = std::min(segmentSize, chunk - offset);
+                if (::sendto(m_bSocket, (char*)data + sent + offset, len, 0, (sockaddr*)&bTo, sizeof(bTo)) == -1) break;
+                offset += len;
+            }
+            sent += offset;
+            if (offset < chunk) break;
+            continue;
+        }
+        if (nBytes == -1) break;
+        sent += nBytes;
+    }
+
+    if (success != nullptr) *success = sent == size;
+    return (sent == 0 && size > 0) ? -1 : sent;
+#else
+    int sent = 0;
+    while (sent < size)
+    {
+        bool sendSuccess;
+        int len = std::min(segmentSize, size - sent);
+        sendTo((char*)data + sent, len, to, &sendSuccess);
+        if (!sendSuccess) break;
+        sent += len;
+    }
+
+    if (success != nullptr) *success = sent == size;
+    return (sent == 0 && size > 0) ? -1 : sent;
+#endif
 }
 
-Garnet::ServerTCP::ServerTCP(Address addr, bool* success)
+int Garnet::Socket::receiveFromCoalesced(void* buffer, int bufferSize, Address* from, int* segmentSize, bool* success)
 {
-    m_addr = addr;
-    bool successA, successB;
-    m_socket = Socket(Protocol::TCP, &successA);
-    m_socket.bind(addr, &successB);
-    m_bufSize = 256;
-    m_nClients = 0;
-    m_open = false;
-    m_pReceiveCallback = nullptr;
-    m_pClientConnectCallback = nullptr;
-    m_pClientDisconnectCallback = nullptr;
+    if (segmentSize != nullptr) *segmentSize = 0;
+
+#ifdef GNET_OS_LINUX
+    sockaddr_in bFrom;
+    iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = bufferSize;
+
+    msghdr msg{};
+    msg.msg_name = &bFrom;
+    msg.msg_namelen = sizeof(bFrom);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int nBytes = recvmsg(m_bSocket, &msg, 0);
+    if (success != nullptr) *success = nBytes != -1;
+    if (nBytes == -1) return -1;
+
+    if (from != nullptr) *from = addr_btog(bFrom);
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO && segmentSize != nullptr)
+        {
+            memcpy(segmentSize, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    return nBytes;
+#else
+    return receiveFrom(buffer, bufferSize, from, success);
+#endif
+}
 
-    if (success != nullptr) *success = successA && successB; 
+void Garnet::Socket::setGRO(bool enabled, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    int opt = enabled ? 1 : 0;
+    if (setsockopt(m_bSocket, SOL_UDP, UDP_GRO, &opt, sizeof(opt)) == -1)
+    {
+        err = "Failed to set UDP_GRO. Error: " + std::string(strerror(errno));
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (success != nullptr) *success = true;
+#else
+    err = "Failed to set UDP_GRO: not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+#endif
 }
 
-void Garnet::ServerTCP::open(int backlog, bool* success)
+int Garnet::Socket::sendBatch(const Datagram* datagrams, int count, bool* success)
 {
-    if (m_open)
+#ifdef GNET_OS_LINUX
+    const int maxBatch = 64;
+    mmsghdr msgs[maxBatch];
+    iovec iovs[maxBatch];
+    sockaddr_in bTos[maxBatch];
+
+    int nSent = 0;
+    bool failed = false;
+    while (nSent < count && !failed)
     {
-        err = "Failed to open ServerTCP: already open";
+        int n = std::min(count - nSent, maxBatch);
+        memset(msgs, 0, sizeof(mmsghdr) * n);
+        for (int i = 0; i < n; i++)
+        {
+            const Datagram& datagram = datagrams[nSent + i];
+            if (!resolveAddress(datagram.address, &bTos[i]))
+            {
+                // send what comes before the unreachable address, then stop
+                err = "sendBatch failed: " + getUnresolvedReason(datagram.address);
+                if (printErrors) std::cout << err << "\n";
+                n = i;
+                failed = true;
+                break;
+            }
+            iovs[i].iov_base = datagram.data;
+            iovs[i].iov_len = datagram.size;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &bTos[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(bTos[i]);
+        }
+        if (n == 0) break;
+
+        int nBatch = sendmmsg(m_bSocket, msgs, n, 0);
+        if (nBatch == -1)
+        {
+            if (errno == EINTR) continue;
+            failed = true;
+            break;
+        }
+        nSent += nBatch;
+    }
+
+    if (success != nullptr) *success = nSent == count;
+    return (nSent == 0 && count > 0) ? -1 : nSent;
+#else
+    int nSent = 0;
+    for (int i = 0; i < count; i++)
+    {
+        bool sendSuccess;
+        sendTo(datagrams[i].data, datagrams[i].size, datagrams[i].address, &sendSuccess);
+        if (!sendSuccess) break;
+        nSent++;
+    }
+
+    if (success != nullptr) *success = nSent == count;
+    return (nSent == 0 && count > 0) ? -1 : nSent;
+#endif
+}
+
+int Garnet::Socket::receiveBatch(Datagram* datagrams, int count, int bufferSize, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    const int maxBatch = 64;
+    mmsghdr msgs[maxBatch];
+    iovec iovs[maxBatch];
+    sockaddr_in bFroms[maxBatch];
+
+    // larger counts take several recvmmsg() calls: only the first one waits, the rest just take what is already queued
+    int nReceived = 0;
+    while (nReceived < count)
+    {
+        Datagram* chunk = datagrams + nReceived;
+        int chunkCount = std::min(count - nReceived, maxBatch);
+        memset(msgs, 0, sizeof(mmsghdr) * chunkCount);
+        for (int i = 0; i < chunkCount; i++)
+        {
+            chunk[i].buffer = Buffer(bufferSize);
+            iovs[i].iov_base = chunk[i].buffer.getData();
+            iovs[i].iov_len = bufferSize;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &bFroms[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(bFroms[i]);
+        }
+
+        int nChunk = recvmmsg(m_bSocket, msgs, chunkCount, nReceived == 0 ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+        if (nChunk == -1) nChunk = 0;
+        for (int i = 0; i < nChunk; i++)
+        {
+            chunk[i].data = chunk[i].buffer.getData();
+            chunk[i].size = msgs[i].msg_len;
+            chunk[i].address = addr_btog(bFroms[i]);
+        }
+
+        nReceived += nChunk;
+        if (nChunk < chunkCount) break;
+    }
+
+    for (int i = nReceived; i < count; i++)
+    {
+        datagrams[i].buffer.release();
+        datagrams[i].data = nullptr;
+        datagrams[i].size = 0;
+    }
+
+    if (success != nullptr) *success = nReceived > 0;
+    return nReceived > 0 ? nReceived : -1;
+#else
+    if (count < 1)
+    {
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+    // no batched receive on this platform, so receive a single datagram
+    bool recvSuccess;
+    datagrams[0].buffer = Buffer(bufferSize);
+    int nBytes = receiveFrom(datagrams[0].buffer.getData(), bufferSize, &datagrams[0].address, &recvSuccess);
+    if (!recvSuccess)
+    {
+        datagrams[0].buffer.release();
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+    datagrams[0].data = datagrams[0].buffer.getData();
+    datagrams[0].size = nBytes;
+    if (success != nullptr) *success = true;
+    return 1;
+#endif
+}
+
+void Garnet::Socket::setReusePort(bool enabled, bool* success)
+{
+#ifdef SO_REUSEPORT
+    int opt = enabled ? 1 : 0;
+    if (setsockopt(m_bSocket, SOL_SOCKET, SO_REUSEPORT, (char*)&opt, sizeof(opt)) != 0)
+    {
+        err = "Failed to set SO_REUSEPORT. Error: " + std::string(strerror(errno));
         if (printErrors) std::cout << err << "\n";
         if (success != nullptr) *success = false;
         return;
     }
 
-    m_open = true;
-    bool successA;
-    m_socket.listen(backlog, &successA);
-    if (success != nullptr) *success = successA;
-    if (successA)
+    if (success != nullptr) *success = true;
+#else
+    err = "Failed to set SO_REUSEPORT: not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+#endif
+}
+
+void Garnet::Socket::setZeroCopy(bool enabled, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    int opt = enabled ? 1 : 0;
+    if (setsockopt(m_bSocket, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) != 0)
+    {
+        err = "Failed to set SO_ZEROCOPY. Error: " + std::string(strerror(errno));
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    zeroCopyStatesMtx.lock();
+    if (!enabled) zeroCopyStates.erase(m_bSocket);
+    else if (zeroCopyStates.find(m_bSocket) == zeroCopyStates.end()) zeroCopyStates[m_bSocket] = std::make_shared<ZeroCopyState>();
+    zeroCopyStatesMtx.unlock();
+
+    if (success != nullptr) *success = true;
+#else
+    err = "Failed to set SO_ZEROCOPY: not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+#endif
+}
+
+int Garnet::Socket::sendZeroCopy(void* data, int size, unsigned int* token, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    std::shared_ptr<ZeroCopyState> state = findZeroCopyState(m_bSocket);
+    if (state == nullptr)
+    {
+        err = "sendZeroCopy failed: zero copy is not enabled on this socket";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> sendLock(state->sendMtx);
+    bool zeroCopy = size >= zeroCopyMinSize;
+    uint32_t nIds = 0;
+    int sent = 0;
+    while (sent < size)
+    {
+        int nBytes = ::send(m_bSocket, (char*)data + sent, size - sent, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+        if (nBytes > 0)
+        {
+            // the kernel only uses up a notification id when the call transmits something
+            if (zeroCopy) nIds++;
+            sent += nBytes;
+            continue;
+        }
+
+        if (nBytes == -1 && errno == EINTR) continue;
+        if (nBytes == -1 && errno == ENOBUFS && zeroCopy)
+        {
+            // out of optmem for pinned pages, so copy the rest instead
+            zeroCopy = false;
+            continue;
+        }
+        if (nBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            pollfd pfd{};
+            pfd.fd = m_bSocket;
+            pfd.events = POLLOUT;
+            if (poll(&pfd, 1, -1) != -1 || errno == EINTR) continue;
+        }
+        break;
+    }
+
+    // a send that used no ids completes once every earlier one has, which keeps tokens completing in order
+    state->mtx.lock();
+    state->nextId += nIds;
+    unsigned int sendToken = state->nextToken++;
+    state->pending.push_back({ sendToken, state->nextId - 1 });
+    state->mtx.unlock();
+
+    if (token != nullptr) *token = sendToken;
+    if (success != nullptr) *success = sent == size;
+    return sent > 0 ? sent : -1;
+#else
+    err = "sendZeroCopy failed: not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+    return -1;
+#endif
+}
+
+int Garnet::Socket::getZeroCopyCompletions(unsigned int* tokens, int maxTokens, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    std::shared_ptr<ZeroCopyState> state = findZeroCopyState(m_bSocket);
+    if (state == nullptr)
+    {
+        err = "getZeroCopyCompletions failed: zero copy is not enabled on this socket";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mtx);
+    while (true)
+    {
+        char control[128];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(m_bSocket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        // each notification covers the inclusive id range [ee_info, ee_data]
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) continue;
+
+            sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+            if (ee.ee_errno != 0 || ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            state->complete(ee.ee_info, ee.ee_data + 1);
+        }
+    }
+
+    int nTokens = 0;
+    while (nTokens < maxTokens && !state->pending.empty() && (int32_t)(state->pending.front().second - state->doneId) < 0)
+    {
+        tokens[nTokens++] = state->pending.front().first;
+        state->pending.pop_front();
+    }
+
+    if (success != nullptr) *success = true;
+    return nTokens;
+#else
+    err = "getZeroCopyCompletions failed: not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+    return -1;
+#endif
+}
+
+#ifdef GNET_OS_WINDOWS
+    typedef SOCKET SocketHandle;
+    typedef WSAPOLLFD SocketPollFd;
+    const short pollReadable = POLLRDNORM;
+    const short pollWritable = POLLWRNORM;
+#elif defined(GNET_OS_UNIX)
+    typedef int SocketHandle;
+    typedef pollfd SocketPollFd;
+    const short pollReadable = POLLIN;
+    const short pollWritable = POLLOUT;
+#endif
+
+static int pollSockets(SocketPollFd* pollFds, size_t count, int timeoutMs)
+{
+#ifdef GNET_OS_WINDOWS
+    return WSAPoll(pollFds, (ULONG)count, timeoutMs);
+#else
+    return poll(pollFds, count, timeoutMs);
+#endif
+}
+
+// the milliseconds left until a deadline, for poll(); -1 (wait forever) if there is no deadline
+static int getRemainingMs(std::chrono::steady_clock::time_point deadline, bool hasDeadline)
+{
+    if (!hasDeadline) return -1;
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    return remaining < 0 ? 0 : (int)std::min<long long>(remaining, 1 << 30);
+}
+
+int Garnet::Socket::finishConnects(Socket* const* sockets, int count, bool* pending, bool* connected, int timeoutMs)
+{
+    std::vector<SocketPollFd> pollFds;
+    std::vector<int> indices;
+    for (int i = 0; i < count; i++)
+    {
+        if (!pending[i]) continue;
+        SocketPollFd pfd{};
+        pfd.fd = sockets[i]->m_bSocket;
+        pfd.events = pollWritable;
+        pollFds.push_back(pfd);
+        indices.push_back(i);
+    }
+    if (pollFds.empty() || pollSockets(pollFds.data(), pollFds.size(), timeoutMs) <= 0) return 0;
+
+    // a refused or unreachable connect shows up as an error or hang-up, which endConnect() reads from SO_ERROR
+    int nFinished = 0;
+    for (size_t i = 0; i < pollFds.size(); i++)
+    {
+        if (pollFds[i].revents == 0) continue;
+        pending[indices[i]] = false;
+        connected[indices[i]] = sockets[indices[i]]->endConnect();
+        nFinished++;
+    }
+    return nFinished;
+}
+
+void Garnet::Socket::connect(Address addr, int timeoutMs, bool* success)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    bool pending;
+    bool connected = beginConnect(addr, &pending);
+    Socket* self = this;
+    while (pending)
+    {
+        int remaining = getRemainingMs(deadline, timeoutMs >= 0);
+        if (remaining == 0)
+        {
+            setBlocking(true);
+            err = "Socket connect failed: timed out after " + std::to_string(timeoutMs) + " ms";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+        finishConnects(&self, 1, &pending, &connected, remaining);
+    }
+
+    if (success != nullptr) *success = connected;
+}
+
+// sets an integer socket option, reporting a failure under the option's name like the other setters
+static bool setIntOption(SocketHandle socket, int level, int name, int value, const char* optionName)
+{
+    if (setsockopt(socket, level, name, (char*)&value, sizeof(value)) == 0) return true;
+
+#ifdef GNET_OS_WINDOWS
+    err = "Failed to set " + std::string(optionName) + ". WSA error code: " + std::to_string(WSAGetLastError());
+#else
+    err = "Failed to set " + std::string(optionName) + ". Error: " + std::string(strerror(errno));
+#endif
+    if (printErrors) std::cout << err << "\n";
+    return false;
+}
+
+static int getIntOption(SocketHandle socket, int level, int name, const char* optionName, bool* success)
+{
+    int value = 0;
+#ifdef GNET_OS_WINDOWS
+    int valueSize = sizeof(value);
+#else
+    socklen_t valueSize = sizeof(value);
+#endif
+    if (getsockopt(socket, level, name, (char*)&value, &valueSize) == 0)
+    {
+        if (success != nullptr) *success = true;
+        return value;
+    }
+
+#ifdef GNET_OS_WINDOWS
+    err = "Failed to get " + std::string(optionName) + ". WSA error code: " + std::to_string(WSAGetLastError());
+#else
+    err = "Failed to get " + std::string(optionName) + ". Error: " + std::string(strerror(errno));
+#endif
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+    return -1;
+}
+
+// only reached on platforms missing one of the options, so it is unused on Linux
+[[maybe_unused]] static void reportUnsupportedOption(const char* optionName, bool* success)
+{
+    err = "Failed to set " + std::string(optionName) + ": not supported on this platform";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+}
+
+Garnet::SocketOptions Garnet::SocketOptions::lowLatency()
+{
+    SocketOptions options;
+    options.noDelay = 1;
+    options.priority = 6; // the highest priority that does not need CAP_NET_ADMIN
+    options.typeOfService = 0x10; // IPTOS_LOWDELAY
+    return options;
+}
+
+Garnet::SocketOptions Garnet::SocketOptions::bulkThroughput()
+{
+    SocketOptions options;
+    options.noDelay = 0;
+    options.receiveBufferSize = 4 * 1024 * 1024;
+    options.sendBufferSize = 4 * 1024 * 1024;
+    options.typeOfService = 0x08; // IPTOS_THROUGHPUT
+    return options;
+}
+
+void Garnet::Socket::setNoDelay(bool enabled, bool* success)
+{
+    bool set = setIntOption(m_bSocket, IPPROTO_TCP, TCP_NODELAY, enabled ? 1 : 0, "TCP_NODELAY");
+    if (success != nullptr) *success = set;
+}
+
+void Garnet::Socket::setCork(bool enabled, bool* success)
+{
+#ifdef TCP_CORK
+    bool set = setIntOption(m_bSocket, IPPROTO_TCP, TCP_CORK, enabled ? 1 : 0, "TCP_CORK");
+    if (success != nullptr) *success = set;
+#elif defined(TCP_NOPUSH)
+    bool set = setIntOption(m_bSocket, IPPROTO_TCP, TCP_NOPUSH, enabled ? 1 : 0, "TCP_NOPUSH");
+    if (success != nullptr) *success = set;
+#else
+    reportUnsupportedOption("TCP_CORK", success);
+#endif
+}
+
+void Garnet::Socket::setQuickAck(bool enabled, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    bool set = setIntOption(m_bSocket, IPPROTO_TCP, TCP_QUICKACK, enabled ? 1 : 0, "TCP_QUICKACK");
+    if (success != nullptr) *success = set;
+#else
+    reportUnsupportedOption("TCP_QUICKACK", success);
+#endif
+}
+
+void Garnet::Socket::setReceiveBufferSize(int size, bool* success)
+{
+    bool set = setIntOption(m_bSocket, SOL_SOCKET, SO_RCVBUF, size, "SO_RCVBUF");
+    if (success != nullptr) *success = set;
+}
+
+int Garnet::Socket::getReceiveBufferSize(bool* success) const
+{
+    return getIntOption(m_bSocket, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", success);
+}
+
+void Garnet::Socket::setSendBufferSize(int size, bool* success)
+{
+    bool set = setIntOption(m_bSocket, SOL_SOCKET, SO_SNDBUF, size, "SO_SNDBUF");
+    if (success != nullptr) *success = set;
+}
+
+int Garnet::Socket::getSendBufferSize(bool* success) const
+{
+    return getIntOption(m_bSocket, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", success);
+}
+
+void Garnet::Socket::setPriority(int priority, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    bool set = setIntOption(m_bSocket, SOL_SOCKET, SO_PRIORITY, priority, "SO_PRIORITY");
+    if (success != nullptr) *success = set;
+#else
+    reportUnsupportedOption("SO_PRIORITY", success);
+#endif
+}
+
+void Garnet::Socket::setTypeOfService(int typeOfService, bool* success)
+{
+    bool set = setIntOption(m_bSocket, IPPROTO_IP, IP_TOS, typeOfService, "IP_TOS");
+    if (success != nullptr) *success = set;
+}
+
+void Garnet::Socket::setOptions(const SocketOptions& options, bool* success)
+{
+    bool tcp = m_proto == Protocol::TCP;
+    bool allSet = true;
+    bool set;
+    if (tcp && options.noDelay >= 0)
+    {
+        setNoDelay(options.noDelay != 0, &set);
+        allSet = allSet && set;
+    }
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+    if (tcp && options.cork >= 0)
+    {
+        setCork(options.cork != 0, &set);
+        allSet = allSet && set;
+    }
+#endif
+#ifdef GNET_OS_LINUX
+    if (tcp && options.quickAck >= 0)
+    {
+        setQuickAck(options.quickAck != 0, &set);
+        allSet = allSet && set;
+    }
+#endif
+    if (options.receiveBufferSize >= 0)
+    {
+        setReceiveBufferSize(options.receiveBufferSize, &set);
+        allSet = allSet && set;
+    }
+    if (options.sendBufferSize >= 0)
+    {
+        setSendBufferSize(options.sendBufferSize, &set);
+        allSet = allSet && set;
+    }
+#ifdef GNET_OS_LINUX
+    if (options.priority >= 0)
+    {
+        setPriority(options.priority, &set);
+        allSet = allSet && set;
+    }
+#endif
+    if (options.typeOfService >= 0)
+    {
+        setTypeOfService(options.typeOfService, &set);
+        allSet = allSet && set;
+    }
+    if (success != nullptr) *success = allSet;
+}
+
+void Garnet::Socket::setBusyPoll(int microseconds, bool* success)
+{
+#if defined(GNET_OS_LINUX) && defined(SO_BUSY_POLL)
+    bool set = setIntOption(m_bSocket, SOL_SOCKET, SO_BUSY_POLL, std::max(microseconds, 0), "SO_BUSY_POLL");
+#ifdef SO_PREFER_BUSY_POLL
+    // older kernels reject it, which only costs the preference, not busy polling itself
+    int prefer = microseconds > 0 ? 1 : 0;
+    setsockopt(m_bSocket, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+#endif
+    if (success != nullptr) *success = set;
+#else
+    reportUnsupportedOption("SO_BUSY_POLL", success);
+#endif
+}
+
+double Garnet::BusyPollStats::getHitRate() const
+{
+    return nSpins > 0 ? (double)nHits / nSpins : 0.0;
+}
+
+static Garnet::BusyPollStats getBusyPollStats(const Garnet::BusyPoll& busyPoll)
+{
+    Garnet::BusyPollStats stats;
+    stats.nSpins = busyPoll.nSpins;
+    stats.nHits = busyPoll.nHits;
+    stats.spinMicroseconds = busyPoll.spinNanoseconds / 1000;
+    return stats;
+}
+
+// busy-poll receiving: calls ready(), a non-blocking check, until it finds something or the spin budget is spent, and counts the outcome;
+// on a miss, the caller goes on to its blocking call and pays for the wakeup that spinning tries to avoid
+template<typename F>
+static bool spinUntil(Garnet::BusyPoll& busyPoll, F ready)
+{
+    int spinUs = busyPoll.spinMicroseconds;
+    if (spinUs <= 0) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::microseconds(spinUs);
+    bool hit;
+    do hit = ready();
+    while (!hit && std::chrono::steady_clock::now() < end);
+
+    busyPoll.nSpins++;
+    if (hit) busyPoll.nHits++;
+    busyPoll.spinNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return hit;
+}
+
+// spins until the socket has something for the blocking receive after it: data, the end of the stream or an error
+static bool spinUntilReadable(Garnet::BusyPoll& busyPoll, SocketHandle socket)
+{
+    return spinUntil(busyPoll, [socket]()
+    {
+    #ifdef GNET_OS_WINDOWS
+        WSAPOLLFD pfd{};
+        pfd.fd = socket;
+        pfd.events = POLLRDNORM;
+        return WSAPoll(&pfd, 1, 0) != 0;
+    #else
+        // peeking leaves the data for the real receive, and goes through the kernel's busy poll of the device queue on the way
+        char peek;
+        return recv(socket, &peek, 1, MSG_PEEK | MSG_DONTWAIT) != -1 || (errno != EAGAIN && errno != EWOULDBLOCK);
+    #endif
+    });
+}
+
+static thread_local Garnet::EventLoop* currentLoop = nullptr;
+
+struct Garnet::EventLoop::State
+{
+    // the callbacks waiting for one socket, which are dropped once called
+    struct Waiters
+    {
+        std::function<void()> onReadable;
+        std::function<void()> onWritable;
+        bool registered = false; // whether the socket is in the epoll set
+    };
+    std::unordered_map<SocketHandle, Waiters> waiters;
+
+#ifdef GNET_OS_LINUX
+    int epoll = -1;
+    int wake = -1; // an eventfd
+#else
+    SocketHandle wake; // a UDP socket connected to itself, since Winsock can only poll sockets
+    std::vector<SocketPollFd> pollFds;
+#endif
+
+    std::mutex postedMtx;
+    std::vector<std::function<void()>> posted;
+    std::atomic<bool> wakePending{false}; // so that a burst of post() calls only wakes the loop once
+    std::atomic<bool> stopped{false};
+
+    std::unordered_map<void*, void (*)(void*)> tasks; // spawned tasks that have not finished, with how to destroy their frames
+
+    void signal()
+    {
+        if (wakePending.exchange(true)) return;
+    #ifdef GNET_OS_LINUX
+        uint64_t one = 1;
+        (void)!::write(wake, &one, sizeof(one));
+    #else
+        ::send(wake, "", 1, 0);
+    #endif
+    }
+
+    void drainWake()
+    {
+    #ifdef GNET_OS_LINUX
+        uint64_t count;
+        (void)!::read(wake, &count, sizeof(count));
+    #else
+        char byte;
+        while (::recv(wake, &byte, 1, 0) > 0) {}
+    #endif
+        wakePending = false;
+    }
+
+    // moves the callbacks a socket is ready for into `due`, then updates what the socket is waited for
+    void collect(SocketHandle handle, bool readable, bool writable, std::vector<std::function<void()>>& due)
+    {
+        auto it = waiters.find(handle);
+        if (it == waiters.end()) return;
+        if (readable && it->second.onReadable) due.push_back(std::move(it->second.onReadable));
+        if (writable && it->second.onWritable) due.push_back(std::move(it->second.onWritable));
+        if (readable) it->second.onReadable = nullptr;
+        if (writable) it->second.onWritable = nullptr;
+        update(it);
+    }
+
+    // brings the poller in line with the waiting callbacks of a socket, forgetting the socket once nothing waits for it
+    bool update(std::unordered_map<SocketHandle, Waiters>::iterator it)
+    {
+        Waiters& w = it->second;
+    #ifdef GNET_OS_LINUX
+        if (!w.onReadable && !w.onWritable)
+        {
+            if (w.registered) epoll_ctl(epoll, EPOLL_CTL_DEL, it->first, nullptr);
+            waiters.erase(it);
+            return true;
+        }
+
+        epoll_event event{};
+        event.events = (w.onReadable ? (uint32_t)(EPOLLIN | EPOLLRDHUP) : 0) | (w.onWritable ? (uint32_t)EPOLLOUT : 0);
+        event.data.fd = it->first;
+        if (epoll_ctl(epoll, w.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, it->first, &event) == -1) return false;
+        w.registered = true;
+    #else
+        if (!w.onReadable && !w.onWritable) waiters.erase(it);
+    #endif
+        return true;
+    }
+};
+
+Garnet::EventLoop::EventLoop(bool* success)
+{
+    m_state = new State();
+#ifdef GNET_OS_LINUX
+    m_state->epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_state->wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_state->wake;
+    if (m_state->epoll == -1 || m_state->wake == -1 || epoll_ctl(m_state->epoll, EPOLL_CTL_ADD, m_state->wake, &event) == -1)
+    {
+        err = "EventLoop creation failed. Error: " + std::string(strerror(errno));
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#else
+    // bind to an ephemeral loopback port and connect to it, so that send() and recv() on the one socket wake the loop
+    bool successA;
+    Socket wake(Protocol::UDP, &successA);
+    if (successA) wake.bind(Address("127.0.0.1", 0), &successA);
+    if (successA)
+    {
+        wake.m_bAddrSize = sizeof(wake.m_bAddr);
+        successA = getsockname(wake.m_bSocket, (sockaddr*)&wake.m_bAddr, &wake.m_bAddrSize) == 0 &&
+                   ::connect(wake.m_bSocket, (sockaddr*)&wake.m_bAddr, wake.m_bAddrSize) == 0;
+        if (successA) wake.setBlocking(false, &successA);
+    }
+    m_state->wake = wake.m_bSocket;
+    if (!successA)
+    {
+        err = "EventLoop creation failed: could not set up its wake socket";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#endif
+
+    if (success != nullptr) *success = true;
+}
+
+Garnet::EventLoop::~EventLoop()
+{
+    // the waiting callbacks and posted functions only point into the frames of suspended tasks, so drop them first;
+    // destroying a spawned task's frame then destroys the frames of the tasks it awaits with it
+    m_state->waiters.clear();
+    m_state->posted.clear();
+    while (!m_state->tasks.empty())
+    {
+        std::unordered_map<void*, void (*)(void*)> tasks;
+        tasks.swap(m_state->tasks);
+        for (auto& task : tasks) task.second(task.first);
+    }
+
+#ifdef GNET_OS_LINUX
+    if (m_state->epoll != -1) ::close(m_state->epoll);
+    if (m_state->wake != -1) ::close(m_state->wake);
+#elif defined(GNET_OS_WINDOWS)
+    closesocket(m_state->wake);
+#else
+    ::close(m_state->wake);
+#endif
+    delete m_state;
+}
+
+void Garnet::EventLoop::run()
+{
+    EventLoop* previous = currentLoop;
+    currentLoop = this;
+
+    std::vector<std::function<void()>> due;
+#ifdef GNET_OS_LINUX
+    epoll_event events[64];
+#endif
+    while (!m_state->stopped)
+    {
+        bool woken = false;
+    #ifdef GNET_OS_LINUX
+        int nEvents = epoll_wait(m_state->epoll, events, 64, -1);
+        for (int i = 0; i < nEvents; i++)
+        {
+            if (events[i].data.fd == m_state->wake)
+            {
+                woken = true;
+                continue;
+            }
+
+            // errors and hang-ups count as ready both ways, so that the retried operation sees them
+            uint32_t e = events[i].events;
+            bool failed = (e & (EPOLLERR | EPOLLHUP)) != 0;
+            m_state->collect(events[i].data.fd, failed || (e & (EPOLLIN | EPOLLRDHUP)), failed || (e & EPOLLOUT), due);
+        }
+    #else
+        std::vector<SocketPollFd>& pollFds = m_state->pollFds;
+        pollFds.clear();
+        SocketPollFd wakeFd{};
+        wakeFd.fd = m_state->wake;
+        wakeFd.events = pollReadable;
+        pollFds.push_back(wakeFd);
+        for (auto& entry : m_state->waiters)
+        {
+            SocketPollFd pfd{};
+            pfd.fd = entry.first;
+            pfd.events = (entry.second.onReadable ? pollReadable : 0) | (entry.second.onWritable ? pollWritable : 0);
+            pollFds.push_back(pfd);
+        }
+
+        int nReady = pollSockets(pollFds.data(), pollFds.size(), -1);
+        for (size_t i = 0; nReady > 0 && i < pollFds.size(); i++)
+        {
+            short e = pollFds[i].revents;
+            if (e == 0) continue;
+            if (i == 0)
+            {
+                woken = true;
+                continue;
+            }
+
+            bool failed = (e & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            m_state->collect(pollFds[i].fd, failed || (e & pollReadable), failed || (e & pollWritable), due);
+        }
+    #endif
+
+        if (woken)
+        {
+            m_state->drainWake();
+            std::lock_guard<std::mutex> lock(m_state->postedMtx);
+            for (std::function<void()>& function : m_state->posted) due.push_back(std::move(function));
+            m_state->posted.clear();
+        }
+
+        for (std::function<void()>& callback : due) callback();
+        due.clear();
+    }
+
+    m_state->stopped = false;
+    currentLoop = previous;
+}
+
+void Garnet::EventLoop::stop()
+{
+    m_state->stopped = true;
+    m_state->signal();
+}
+
+void Garnet::EventLoop::post(std::function<void()> function)
+{
+    m_state->postedMtx.lock();
+    m_state->posted.push_back(std::move(function));
+    m_state->postedMtx.unlock();
+    m_state->signal();
+}
+
+void Garnet::EventLoop::waitReadable(const Socket& socket, std::function<void()> callback, bool* success)
+{
+    wait(socket, false, std::move(callback), success);
+}
+
+void Garnet::EventLoop::waitWritable(const Socket& socket, std::function<void()> callback, bool* success)
+{
+    wait(socket, true, std::move(callback), success);
+}
+
+void Garnet::EventLoop::wait(const Socket& socket, bool writable, std::function<void()> callback, bool* success)
+{
+    auto it = m_state->waiters.find(socket.m_bSocket);
+    if (it == m_state->waiters.end()) it = m_state->waiters.emplace(socket.m_bSocket, State::Waiters()).first;
+
+    std::function<void()>& slot = writable ? it->second.onWritable : it->second.onReadable;
+    if (slot)
+    {
+        err = std::string("EventLoop wait failed: something is already waiting for the socket to be ") + (writable ? "writable" : "readable");
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    slot = std::move(callback);
+    if (!m_state->update(it))
+    {
+        err = "EventLoop wait failed. Error: " + std::string(strerror(errno));
+        if (printErrors) std::cout << err << "\n";
+        slot = nullptr;
+        m_state->update(it);
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (success != nullptr) *success = true;
+}
+
+Garnet::EventLoop* Garnet::EventLoop::getCurrent()
+{
+    return currentLoop;
+}
+
+void Garnet::EventLoop::addTask(void* frame, void (*destroy)(void* frame))
+{
+    m_state->tasks[frame] = destroy;
+}
+
+void Garnet::EventLoop::removeTask(void* frame)
+{
+    m_state->tasks.erase(frame);
+}
+
+// reassembles length-prefixed messages (a 4-byte big-endian size, then the payload) from a TCP byte stream
+class MessageFramer
+{
+public:
+    // sets up the next read: straight into the unfilled rest of a message being reassembled, otherwise into a fresh pooled buffer
+    void* prepareRead(int bufSize, int* size)
+    {
+        m_readIntoMessage = m_message.isValid();
+        if (m_readIntoMessage)
+        {
+            *size = m_message.getSize() - m_messageFill;
+            return (char*)m_message.getData() + m_messageFill;
+        }
+
+        m_read = Garnet::Buffer(bufSize);
+        *size = bufSize;
+        return m_read.getData();
+    }
+
+    // processes the bytes just read, calling onMessage for every complete message; returns false if one is larger than maxSize
+    template<typename F>
+    bool commit(int nBytes, int maxSize, F onMessage)
+    {
+        if (m_readIntoMessage)
+        {
+            m_messageFill += nBytes;
+            if (m_messageFill == m_message.getSize())
+            {
+                Garnet::Buffer message = std::move(m_message);
+                m_message = Garnet::Buffer();
+                m_messageFill = 0;
+                onMessage(message);
+            }
+            return true;
+        }
+
+        const unsigned char* data = (const unsigned char*)m_read.getData();
+        int pos = 0;
+        while (pos < nBytes)
+        {
+            if (m_headerFill < 4)
+            {
+                int n = std::min(4 - m_headerFill, nBytes - pos);
+                memcpy(m_header + m_headerFill, data + pos, n);
+                m_headerFill += n;
+                pos += n;
+                if (m_headerFill < 4) break;
+
+                uint32_t size = (uint32_t)m_header[0] << 24 | (uint32_t)m_header[1] << 16 | (uint32_t)m_header[2] << 8 | (uint32_t)m_header[3];
+                if (size > (uint32_t)maxSize) return false;
+                m_messageSize = (int)size;
+            }
+
+            int available = nBytes - pos;
+            m_headerFill = 0;
+            if (available >= m_messageSize)
+            {
+                // the whole message is in this read, so hand out a slice of it
+                onMessage(m_messageSize == 0 ? Garnet::Buffer() : m_read.slice(pos, m_messageSize));
+                pos += m_messageSize;
+                continue;
+            }
+
+            // the message continues in later reads, so give it a buffer of its own to be completed in
+            m_message = Garnet::Buffer(m_messageSize);
+            memcpy(m_message.getData(), data + pos, available);
+            m_messageFill = available;
+            pos = nBytes;
+        }
+
+        m_read.release();
+        return true;
+    }
+
+private:
+    Garnet::Buffer m_read;
+    bool m_readIntoMessage = false;
+
+    unsigned char m_header[4];
+    int m_headerFill = 0;
+    int m_messageSize = 0;
+
+    Garnet::Buffer m_message;
+    int m_messageFill = 0;
+};
+
+// puts a length-prefix header span in front of the spans when framing, so that they go out as one message
+class FramedSpans
+{
+public:
+    FramedSpans(const Garnet::Span* spans, int count, bool framed)
+    {
+        if (!framed)
+        {
+            m_spans = spans;
+            m_count = count;
+            return;
+        }
+
+        Garnet::Span* framedSpans = count < maxStack ? m_stack : (m_heap = std::vector<Garnet::Span>(count + 1)).data();
+        uint32_t size = 0;
+        for (int i = 0; i < count; i++)
+        {
+            framedSpans[i + 1] = spans[i];
+            size += spans[i].size;
+        }
+        m_header[0] = (unsigned char)(size >> 24);
+        m_header[1] = (unsigned char)(size >> 16);
+        m_header[2] = (unsigned char)(size >> 8);
+        m_header[3] = (unsigned char)size;
+        framedSpans[0].data = m_header;
+        framedSpans[0].size = 4;
+
+        m_spans = framedSpans;
+        m_count = count + 1;
+    }
+
+    const Garnet::Span* get() const
+    {
+        return m_spans;
+    }
+
+    int getCount() const
+    {
+        return m_count;
+    }
+
+private:
+    static const int maxStack = 16;
+    unsigned char m_header[4];
+    Garnet::Span m_stack[maxStack];
+    std::vector<Garnet::Span> m_heap;
+    const Garnet::Span* m_spans;
+    int m_count;
+};
+
+// epoch-based reclamation for data that readers walk without locks: a retired object is only freed
+// once every thread that was inside a read section when it was retired has left that section
+class EpochDomain
+{
+public:
+    static EpochDomain& get()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    void enter()
+    {
+        Slot* slot = getSlot();
+        if (slot->depth++ == 0) slot->epoch.store(m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    void leave()
+    {
+        Slot* slot = getSlot();
+        if (--slot->depth == 0) slot->epoch.store(0, std::memory_order_release);
+    }
+
+    // frees the object once no reader can still see it; call after unpublishing it
+    void retire(std::function<void()> deleter)
+    {
+        std::lock_guard<std::mutex> lock(m_retiredMtx);
+        m_retired.push_back({ m_epoch.fetch_add(1, std::memory_order_seq_cst), std::move(deleter) });
+        reclaim();
+    }
+
+    // frees whatever no reader can still see, e.g. once the threads that were reading have been joined,
+    // since otherwise the last retired objects wait for the next retire()
+    void collect()
+    {
+        std::lock_guard<std::mutex> lock(m_retiredMtx);
+        reclaim();
+    }
+
+private:
+    // must be called with m_retiredMtx held
+    void reclaim()
+    {
+        uint64_t oldestActive = UINT64_MAX;
+        for (Slot* slot = m_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+        {
+            uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) oldestActive = std::min(oldestActive, epoch);
+        }
+
+        auto it = m_retired.begin();
+        while (it != m_retired.end())
+        {
+            if (it->first < oldestActive)
+            {
+                it->second();
+                it = m_retired.erase(it);
+            }
+            else it++;
+        }
+    }
+
+    struct Slot
+    {
+        std::atomic<uint64_t> epoch{ 0 };  // the epoch the thread entered its read section in, 0 outside one
+        std::atomic<bool> used{ false };
+        int depth = 0;                      // read sections nest, e.g. a callback that iterates clients while being iterated for
+        Slot* next = nullptr;
+    };
+
+    // claims a slot for the calling thread on first use and gives it back when the thread exits
+    struct SlotHolder
+    {
+        Slot* slot;
+
+        SlotHolder()
+        {
+            EpochDomain& domain = EpochDomain::get();
+            for (slot = domain.m_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+            {
+                bool expected = false;
+                if (slot->used.compare_exchange_strong(expected, true)) return;
+            }
+
+            slot = new Slot();
+            slot->used = true;
+            slot->next = domain.m_slots.load(std::memory_order_relaxed);
+            while (!domain.m_slots.compare_exchange_weak(slot->next, slot));
+        }
+
+        ~SlotHolder()
+        {
+            slot->used.store(false, std::memory_order_release);
+        }
+    };
+
+    static Slot* getSlot()
+    {
+        thread_local SlotHolder holder;
+        return holder.slot;
+    }
+
+    std::atomic<uint64_t> m_epoch{ 1 };
+    std::atomic<Slot*> m_slots{ nullptr };
+    std::mutex m_retiredMtx;
+    std::list<std::pair<uint64_t, std::function<void()>>> m_retired;
+};
+
+// keeps the calling thread inside an epoch read section for its lifetime
+class EpochGuard
+{
+public:
+    EpochGuard()
+    {
+        EpochDomain::get().enter();
+    }
+
+    ~EpochGuard()
+    {
+        EpochDomain::get().leave();
+    }
+};
+
+// a fixed set of threads running posted tasks; every worker has its own queue, and one that runs dry steals from the others
+class Garnet::WorkerPool
+{
+public:
+    explicit WorkerPool(int nThreads)
+    {
+        for (int i = 0; i < nThreads; i++) m_queues.push_back(new Queue());
+        for (int i = 0; i < nThreads; i++) m_threads.push_back(std::thread(&WorkerPool::run, this, i));
+    }
+
+    // runs whatever is still queued (including tasks those tasks post), then joins the workers
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMtx);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) joinThread(thread);
+        for (Queue* queue : m_queues) delete queue;
+    }
+
+    // deletes a pool, unless called from one of its own workers (closing from inside a callback), which then deletes it once the queued tasks have run
+    static void release(WorkerPool* pool)
+    {
+        if (pool == nullptr) return;
+        if (currentPool != pool)
+        {
+            delete pool;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pool->m_sleepMtx);
+            pool->m_releasedBy = currentIndex;
+            pool->m_stopping = true;
+        }
+        pool->m_wake.notify_all();
+    }
+
+    void post(std::function<void()> task)
+    {
+        // a worker keeps what it posts itself (e.g. a strand rescheduling) local, everyone else spreads round-robin
+        int index = currentPool == this ? currentIndex : (int)(m_next++ % m_queues.size());
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mtx);
+            m_queues[index]->tasks.push_back(std::move(task));
+        }
+        m_nQueued++;
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMtx);
+        }
+        m_wake.notify_one();
+    }
+
+    int getNumThreads() const
+    {
+        return (int)m_threads.size();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<Queue*> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<unsigned int> m_next{ 0 };
+    std::atomic<int> m_nQueued{ 0 };
+
+    std::mutex m_sleepMtx;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    int m_releasedBy = -1;  // the worker that released the pool and so deletes it on its way out
+
+    static thread_local WorkerPool* currentPool;
+    static thread_local int currentIndex;
+
+    // the owner takes from the front of its queue, thieves from the back, so the two rarely meet
+    bool take(int index, std::function<void()>& task)
+    {
+        for (int i = 0; i < (int)m_queues.size(); i++)
+        {
+            Queue* queue = m_queues[(index + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue->mtx);
+            if (queue->tasks.empty()) continue;
+
+            if (i == 0)
+            {
+                task = std::move(queue->tasks.front());
+                queue->tasks.pop_front();
+            }
+            else
+            {
+                task = std::move(queue->tasks.back());
+                queue->tasks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void run(int index)
+    {
+        currentPool = this;
+        currentIndex = index;
+        bool deleteOnExit = false;
+        while (true)
+        {
+            std::function<void()> task;
+            if (take(index, task))
+            {
+                m_nQueued--;
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMtx);
+            m_wake.wait(lock, [this]() { return m_nQueued > 0 || m_stopping; });
+            if (m_stopping && m_nQueued == 0)
+            {
+                deleteOnExit = m_releasedBy == index;
+                break;
+            }
+        }
+        currentPool = nullptr;
+
+        // the other workers are joined there, and this one detached, since it is the caller
+        if (deleteOnExit) delete this;
+    }
+};
+
+thread_local Garnet::WorkerPool* Garnet::WorkerPool::currentPool = nullptr;
+thread_local int Garnet::WorkerPool::currentIndex = 0;
+
+// runs the tasks posted to it on a WorkerPool one at a time and in order, so that one client's callbacks never overlap or get reordered
+class Garnet::Strand : public std::enable_shared_from_this<Strand>
+{
+public:
+    explicit Strand(WorkerPool* pool) : m_pool(pool) {}
+
+    void post(std::function<void()> task)
+    {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_tasks.push_back(std::move(task));
+        if (m_scheduled) return; // the drain already running will get to it
+        m_scheduled = true;
+        lock.unlock();
+
+        std::shared_ptr<Strand> self = shared_from_this();
+        m_pool->post([self]() { self->drain(); });
+    }
+
+private:
+    WorkerPool* m_pool;
+    std::mutex m_mtx;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_scheduled = false;
+
+    void drain()
+    {
+        // give the worker back after a while, so that one busy client cannot starve the rest
+        const int maxTasks = 64;
+        for (int i = 0; i < maxTasks; i++)
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (m_tasks.empty())
+                {
+                    m_scheduled = false;
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+
+        std::shared_ptr<Strand> self = shared_from_this();
+        m_pool->post([self]() { self->drain(); });
+    }
+};
+
+struct Garnet::Resolver::State
+{
+    typedef std::function<void(const std::vector<Address>& addresses, bool success)> Callback;
+
+    struct CachedHost
+    {
+        std::vector<Address> addresses; // empty for a failed lookup
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    // a lookup in flight, which everyone asking for the same name meanwhile waits for instead of starting their own
+    struct Lookup
+    {
+        std::vector<Callback> callbacks;
+        std::vector<Address> addresses;
+        bool done = false;
+    };
+
+    std::mutex mtx;
+    std::condition_variable lookupDone;
+    std::unordered_map<std::string, CachedHost> cache;
+    std::unordered_map<std::string, std::shared_ptr<Lookup>> lookups;
+    std::unordered_map<std::string, std::vector<Address>> hosts;
+
+    Address nameServer;
+    int timeoutMs = 1000;
+    int defaultTTL = 60;
+    int negativeTTL = 5;
+
+    WorkerPool* pool = nullptr; // started by the first asynchronous lookup
+
+    // runs a lookup with the current settings, then caches it and hands it to everyone waiting; returns the addresses found.
+    // callbacks always run on the background threads, so one that joined a lookup started by resolve() is posted there
+    std::vector<Address> run(const std::string& name, std::shared_ptr<Lookup> lookup, bool inBackground);
+};
+
+// hostnames are case-insensitive, so they are cached and looked up in lowercase
+static std::string normalizeHostname(const std::string& hostname)
+{
+    std::string name = hostname;
+    for (char& c : name) if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    if (!name.empty() && name.back() == '.') name.pop_back();
+    return name;
+}
+
+Garnet::Resolver::Resolver()
+{
+    m_state = new State();
+}
+
+Garnet::Resolver::~Resolver()
+{
+    delete m_state->pool;
+    delete m_state;
+}
+
+Garnet::Resolver& Garnet::Resolver::getDefault()
+{
+    static Resolver resolver;
+    return resolver;
+}
+
+std::vector<Garnet::Address> Garnet::Resolver::State::run(const std::string& name, std::shared_ptr<Lookup> lookup, bool inBackground)
+{
+    mtx.lock();
+    Address nameServer = this->nameServer;
+    int timeoutMs = this->timeoutMs;
+    int defaultTTL = this->defaultTTL;
+    int negativeTTL = this->negativeTTL;
+    mtx.unlock();
+
+    std::vector<Address> addresses;
+    int ttl = negativeTTL;
+    if (!nameServer.isEmpty()) Resolver::queryNameServer(name, nameServer, timeoutMs, negativeTTL, &addresses, &ttl);
+    else
+    {
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM; // one entry per address rather than one per socket type
+        if (getaddrinfo(name.c_str(), nullptr, &hints, &res) == 0)
+        {
+            for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next)
+            {
+                Address address;
+                address.setBytes(&((sockaddr_in*)ai->ai_addr)->sin_addr, false);
+                addresses.push_back(address);
+            }
+            freeaddrinfo(res);
+        }
+        if (!addresses.empty()) ttl = defaultTTL;
+    }
+
+    const size_t maxCached = 4096;
+    std::vector<Callback> callbacks;
+    mtx.lock();
+    if (ttl > 0)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (cache.size() >= maxCached)
+        {
+            for (auto it = cache.begin(); it != cache.end();)
+            {
+                if (it->second.expiry <= now) it = cache.erase(it);
+                else ++it;
+            }
+            if (cache.size() >= maxCached) cache.clear();
+        }
+        cache[name] = CachedHost{ addresses, now + std::chrono::seconds(ttl) };
+    }
+    lookups.erase(name);
+    lookup->addresses = addresses;
+    lookup->done = true;
+    callbacks.swap(lookup->callbacks);
+    WorkerPool* pool = this->pool; // started by resolveAsync() before it added any callback
+    mtx.unlock();
+    lookupDone.notify_all();
+
+    if (!inBackground && !callbacks.empty())
+    {
+        pool->post([callbacks, addresses]() { for (const Callback& callback : callbacks) callback(addresses, !addresses.empty()); });
+        return addresses;
+    }
+
+    for (Callback& callback : callbacks) callback(addresses, !addresses.empty());
+    return addresses;
+}
+
+std::vector<Garnet::Address> Garnet::Resolver::resolve(const std::string& hostname, bool* success)
+{
+    unsigned char numeric[4];
+    if (inet_pton(AF_INET, hostname.c_str(), numeric) == 1)
+    {
+        if (success != nullptr) *success = true;
+        return std::vector<Address>{ Address(hostname, 0) };
+    }
+
+    std::string name = normalizeHostname(hostname);
+    std::vector<Address> addresses;
+    {
+        std::unique_lock<std::mutex> lock(m_state->mtx);
+        auto host = m_state->hosts.find(name);
+        auto cached = m_state->cache.find(name);
+        if (host != m_state->hosts.end()) addresses = host->second;
+        else if (cached != m_state->cache.end() && cached->second.expiry > std::chrono::steady_clock::now()) addresses = cached->second.addresses;
+        else
+        {
+            auto inFlight = m_state->lookups.find(name);
+            if (inFlight != m_state->lookups.end())
+            {
+                std::shared_ptr<State::Lookup> lookup = inFlight->second;
+                m_state->lookupDone.wait(lock, [&]() { return lookup->done; });
+                addresses = lookup->addresses;
+            }
+            else
+            {
+                std::shared_ptr<State::Lookup> lookup = std::make_shared<State::Lookup>();
+                m_state->lookups[name] = lookup;
+                lock.unlock();
+                addresses = m_state->run(name, lookup, false);
+            }
+        }
+    }
+
+    if (addresses.empty())
+    {
+        err = "Failed to resolve hostname: '" + hostname + "'";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return addresses;
+    }
+
+    if (success != nullptr) *success = true;
+    return addresses;
+}
+
+void Garnet::Resolver::resolveAsync(const std::string& hostname, std::function<void(const std::vector<Address>& addresses, bool success)> callback)
+{
+    unsigned char numeric[4];
+    if (inet_pton(AF_INET, hostname.c_str(), numeric) == 1)
+    {
+        callback(std::vector<Address>{ Address(hostname, 0) }, true);
+        return;
+    }
+
+    std::string name = normalizeHostname(hostname);
+    std::unique_lock<std::mutex> lock(m_state->mtx);
+    auto host = m_state->hosts.find(name);
+    auto cached = m_state->cache.find(name);
+    if (host != m_state->hosts.end() || (cached != m_state->cache.end() && cached->second.expiry > std::chrono::steady_clock::now()))
+    {
+        std::vector<Address> addresses = host != m_state->hosts.end() ? host->second : cached->second.addresses;
+        lock.unlock();
+        callback(addresses, !addresses.empty());
+        return;
+    }
+
+    // a few threads, so that one slow name does not hold up the lookups of all the others; they also run the callbacks
+    // of lookups that a blocking resolve() started, so they are needed even when joining one
+    const int nLookupThreads = 4;
+    if (m_state->pool == nullptr) m_state->pool = new WorkerPool(nLookupThreads);
+    WorkerPool* pool = m_state->pool;
+
+    auto inFlight = m_state->lookups.find(name);
+    if (inFlight != m_state->lookups.end())
+    {
+        inFlight->second->callbacks.push_back(std::move(callback));
+        return;
+    }
+
+    std::shared_ptr<State::Lookup> lookup = std::make_shared<State::Lookup>();
+    lookup->callbacks.push_back(std::move(callback));
+    m_state->lookups[name] = lookup;
+    lock.unlock();
+
+    State* state = m_state;
+    pool->post([state, name, lookup]() { state->run(name, lookup, true); });
+}
+
+void Garnet::Resolver::setNameServer(Address nameServer, int timeoutMs, bool* success)
+{
+    // an empty address goes back to the system resolver
+    sockaddr_in bNameServer;
+    if (!nameServer.isEmpty() && !resolveAddress(nameServer, &bNameServer))
+    {
+        err = "Failed to set name server: " + getUnresolvedReason(nameServer);
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    m_state->nameServer = nameServer;
+    m_state->timeoutMs = timeoutMs;
+    m_state->cache.clear();
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::Resolver::setHostsFile(const std::string& path, bool* success)
+{
+    std::unordered_map<std::string, std::vector<Address>> hosts;
+    if (!path.empty())
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            err = "Failed to read hosts file '" + path + "'";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) line.erase(comment);
+
+            std::istringstream fields(line);
+            std::string ip, name;
+            unsigned char bytes[4];
+            if (!(fields >> ip) || inet_pton(AF_INET, ip.c_str(), bytes) != 1) continue; // IPv6 entries can't be connected to
+            Address address;
+            address.setBytes(bytes, false);
+            while (fields >> name) hosts[normalizeHostname(name)].push_back(address);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    m_state->hosts.swap(hosts);
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::Resolver::setDefaultTTL(int seconds)
+{
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    m_state->defaultTTL = seconds;
+}
+
+void Garnet::Resolver::setNegativeTTL(int seconds)
+{
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    m_state->negativeTTL = seconds;
+}
+
+void Garnet::Resolver::clearCache()
+{
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    m_state->cache.clear();
+}
+
+// skips a possibly compressed name in a DNS message, returning the offset after it, or 0 if it runs off the end
+static size_t skipDnsName(const unsigned char* msg, size_t size, size_t pos)
+{
+    while (pos < size)
+    {
+        unsigned char len = msg[pos];
+        if (len == 0) return pos + 1;
+        if ((len & 0xC0) == 0xC0) return pos + 2 <= size ? pos + 2 : 0; // a pointer ends the name
+        pos += 1 + len;
+    }
+    return 0;
+}
+
+static unsigned int readDnsInt(const unsigned char* p, int nBytes)
+{
+    unsigned int value = 0;
+    for (int i = 0; i < nBytes; i++) value = (value << 8) | p[i];
+    return value;
+}
+
+bool Garnet::Resolver::queryNameServer(const std::string& hostname, Address nameServer, int timeoutMs, int negativeTTL, std::vector<Address>* addresses, int* ttl)
+{
+    *ttl = negativeTTL;
+    thread_local std::mt19937 random(std::random_device{}());
+    unsigned short id = (unsigned short)random();
+
+    // the header (one question, recursion desired), then the name as length-prefixed labels, then type A, class IN
+    std::vector<unsigned char> query = { (unsigned char)(id >> 8), (unsigned char)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0 };
+    size_t start = 0;
+    while (start < hostname.size())
+    {
+        size_t end = hostname.find('.', start);
+        if (end == std::string::npos) end = hostname.size();
+        if (end == start || end - start > 63) return false;
+        query.push_back((unsigned char)(end - start));
+        query.insert(query.end(), hostname.begin() + start, hostname.begin() + end);
+        start = end + 1;
+    }
+    query.insert(query.end(), { 0, 0, 1, 0, 1 });
+    if (query.size() > 12 + 255 + 4) return false;
+
+    Socket socket(Protocol::UDP);
+    unsigned char response[1232]; // the largest answer that arrives unfragmented (the EDNS default), more than plain DNS's 512 bytes
+    int nBytes = -1;
+    for (int attempt = 0; attempt < 2 && nBytes == -1; attempt++)
+    {
+        bool sent;
+        socket.sendTo(query.data(), (int)query.size(), nameServer, &sent);
+        if (!sent) break;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (nBytes == -1)
+        {
+            int remaining = getRemainingMs(deadline, true);
+            SocketPollFd pfd{};
+            pfd.fd = socket.m_bSocket;
+            pfd.events = pollReadable;
+            if (remaining == 0 || pollSockets(&pfd, 1, remaining) <= 0) break;
+
+            // ignore anything that is not the answer to this query, like a late answer to the previous attempt
+            Address from;
+            bool received;
+            int n = socket.receiveFrom(response, sizeof(response), &from, &received);
+            if (received && from == nameServer && n >= 12 && readDnsInt(response, 2) == id && (response[2] & 0x80)) nBytes = n;
+        }
+    }
+    socket.close();
+    if (nBytes == -1) return false;
+
+    int rcode = response[3] & 0x0F;
+    int nQuestions = readDnsInt(response + 4, 2);
+    int nAnswers = readDnsInt(response + 6, 2);
+    int nAuthorities = readDnsInt(response + 8, 2);
+    size_t pos = 12;
+    for (int i = 0; i < nQuestions && pos != 0; i++)
+    {
+        pos = skipDnsName(response, nBytes, pos);
+        if (pos != 0) pos = pos + 4 <= (size_t)nBytes ? pos + 4 : 0;
+    }
+
+    // a recursive server puts the whole CNAME chain in the answers, so every A record there belongs to the name
+    unsigned int minTTL = UINT32_MAX;
+    for (int i = 0; i < nAnswers + nAuthorities && pos != 0; i++)
+    {
+        pos = skipDnsName(response, nBytes, pos);
+        if (pos == 0 || pos + 10 > (size_t)nBytes) break;
+        unsigned int type = readDnsInt(response + pos, 2);
+        unsigned int rclass = readDnsInt(response + pos + 2, 2);
+        unsigned int recordTTL = readDnsInt(response + pos + 4, 4);
+        size_t dataSize = readDnsInt(response + pos + 8, 2);
+        size_t data = pos + 10;
+        pos = data + dataSize <= (size_t)nBytes ? data + dataSize : 0;
+        if (pos == 0 || rclass != 1) break;
+
+        if (i < nAnswers && type == 1 && dataSize == 4)
+        {
+            Address address;
+            address.setBytes(response + data, false);
+            addresses->push_back(address);
+            minTTL = std::min(minTTL, recordTTL);
+        }
+        else if (i < nAnswers && type == 5) minTTL = std::min(minTTL, recordTTL);
+        else if (i >= nAnswers && type == 6 && addresses->empty())
+        {
+            // a negative answer may be cached for the smaller of the SOA record's TTL and its MINIMUM field (RFC 2308)
+            size_t names = skipDnsName(response, nBytes, data);
+            if (names != 0) names = skipDnsName(response, nBytes, names);
+            if (names != 0 && names + 20 <= pos) *ttl = (int)std::min<unsigned int>(std::min(recordTTL, readDnsInt(response + names + 16, 4)), 1 << 30);
+        }
+    }
+
+    if (rcode != 0 || addresses->empty())
+    {
+        addresses->clear();
+        return false;
+    }
+    *ttl = (int)std::min<unsigned int>(minTTL, 1 << 30);
+    return true;
+}
+
+#ifdef GNET_IO_URING
+
+// an io_uring driven through the raw system calls, so that there is no dependency on liburing, with a ring of provided receive buffers
+// and an eventfd to wake it with; everything but wake() must be called from the one thread that owns the ring
+class Garnet::IOUring
+{
+public:
+    IOUring() = default;
+    IOUring(const IOUring&) = delete;
+    IOUring& operator=(const IOUring&) = delete;
+
+    // closing the ring cancels whatever is still in flight, but the owner should have waited that out already (see getNumInFlight())
+    ~IOUring()
+    {
+        if (m_fd != -1) ::close(m_fd);
+        if (m_wakeFd != -1) ::close(m_wakeFd);
+        if (m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+        if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) munmap(m_cqRing, m_cqRingSize);
+        if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqesSize);
+        if (m_bufRing != MAP_FAILED) munmap(m_bufRing, m_bufRingSize);
+    }
+
+    // sets up a ring with room for `entries` submissions and `nBuffers` (a power of 2) provided buffers of `bufferSize` bytes; sets err on failure
+    bool init(unsigned int entries, int nBuffers, int bufferSize)
+    {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+        m_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (m_fd == -1) return fail("failed to set up io_uring");
+
+        // everything the servers submit, with the flags they use, is there from Linux 6.0 on, which is also when IORING_OP_SEND_ZC appeared
+        std::vector<char> probeData(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = (io_uring_probe*)probeData.data();
+        if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, 256) == -1) return fail("failed to probe io_uring");
+        if (probe->last_op < IORING_OP_SEND_ZC || !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED))
+        {
+            err = "io_uring needs Linux 6.0 or later for multishot receives";
+            return false;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqRing == MAP_FAILED) return fail("failed to map the io_uring submission queue");
+        if (params.features & IORING_FEAT_SINGLE_MMAP) m_cqRing = m_sqRing;
+        else m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) return fail("failed to map the io_uring completion queue");
+        m_sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_sqes == MAP_FAILED) return fail("failed to map the io_uring submission entries");
+
+        char* sq = (char*)m_sqRing;
+        char* cq = (char*)m_cqRing;
+        m_sqHead = (unsigned int*)(sq + params.sq_off.head);
+        m_sqTail = (unsigned int*)(sq + params.sq_off.tail);
+        m_sqMask = *(unsigned int*)(sq + params.sq_off.ring_mask);
+        m_sqEntries = params.sq_entries;
+        m_cqHead = (unsigned int*)(cq + params.cq_off.head);
+        m_cqTail = (unsigned int*)(cq + params.cq_off.tail);
+        m_cqMask = *(unsigned int*)(cq + params.cq_off.ring_mask);
+        m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        m_tail = *m_sqTail;
+
+        // submission entries are always used in ring order, so the indirection array can stay the identity
+        unsigned int* sqArray = (unsigned int*)(sq + params.sq_off.array);
+        for (unsigned int i = 0; i < m_sqEntries; i++) sqArray[i] = i;
+
+        // blocking, so that a read of it waits in the ring instead of completing with EAGAIN
+        m_wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (m_wakeFd == -1) return fail("failed to create the io_uring wake eventfd");
+
+        m_bufRingSize = nBuffers * sizeof(io_uring_buf);
+        m_bufRing = mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m_bufRing == MAP_FAILED) return fail("failed to allocate the io_uring buffer ring");
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = (uint64_t)(uintptr_t)m_bufRing;
+        reg.ring_entries = nBuffers;
+        reg.bgid = 0;
+        if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) return fail("failed to register the io_uring buffer ring");
+
+        m_nBuffers = nBuffers;
+        m_bufferSize = bufferSize;
+        m_buffers.resize((size_t)nBuffers * bufferSize);
+        for (int i = 0; i < nBuffers; i++) provideBuffer(i);
+        publishBuffers();
+        return true;
+    }
+
+    // makes the owning thread's wait return; may be called from any thread
+    void wake()
+    {
+        uint64_t one = 1;
+        write(m_wakeFd, &one, sizeof(one));
+    }
+
+    // each prepare call queues one operation for the next submit(), or returns false if the submission queue is full even after submitting
+
+    bool prepareWake(uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_READ, m_wakeFd, userData);
+        if (sqe == nullptr) return false;
+        sqe->addr = (uint64_t)(uintptr_t)&m_wakeCount;
+        sqe->len = sizeof(m_wakeCount);
+        return true;
+    }
+
+    bool prepareAccept(int fd, uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_ACCEPT, fd, userData);
+        if (sqe == nullptr) return false;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        return true;
+    }
+
+    bool prepareReceive(int fd, uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_RECV, fd, userData);
+        if (sqe == nullptr) return false;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        return true;
+    }
+
+    // every datagram lands in a provided buffer behind an io_uring_recvmsg_out and as much room for its name and control data as `msg` asks for
+    bool prepareReceiveMessage(int fd, msghdr* msg, uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_RECVMSG, fd, userData);
+        if (sqe == nullptr) return false;
+        sqe->addr = (uint64_t)(uintptr_t)msg;
+        sqe->len = 1;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        return true;
+    }
+
+    // `msg` and what it points to must stay alive until the send completes
+    bool prepareSendMessage(int fd, const msghdr* msg, uint64_t userData, int flags = MSG_NOSIGNAL)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_SENDMSG, fd, userData);
+        if (sqe == nullptr) return false;
+        sqe->addr = (uint64_t)(uintptr_t)msg;
+        sqe->len = 1;
+        sqe->msg_flags = flags;
+        return true;
+    }
+
+    // completes every time one of `events` is signalled on the descriptor, until cancelled
+    bool preparePoll(int fd, unsigned int events, uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_POLL_ADD, fd, userData);
+        if (sqe == nullptr) return false;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = events;
+        return true;
+    }
+
+    // cancels every operation on the descriptor (or every operation at all, for -1); the cancellation itself completes with user data 0
+    bool prepareCancel(int fd)
+    {
+        io_uring_sqe* sqe = getSqe(IORING_OP_ASYNC_CANCEL, fd, 0);
+        if (sqe == nullptr) return false;
+        sqe->cancel_flags = fd == -1 ? IORING_ASYNC_CANCEL_ANY : IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        return true;
+    }
+
+    // submits everything prepared and waits until at least `waitFor` completions are ready; returns false on an error other than an interruption
+    bool submit(unsigned int waitFor)
+    {
+        __atomic_store_n(m_sqTail, m_tail, __ATOMIC_RELEASE);
+        unsigned int toSubmit = m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if (toSubmit == 0 && waitFor == 0) return true;
+
+        if (syscall(__NR_io_uring_enter, m_fd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0) == -1)
+        {
+            return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+        }
+        return true;
+    }
+
+    // calls onCompletion for every completion that is ready, which may prepare more operations
+    template<typename F>
+    void forEachCompletion(F onCompletion)
+    {
+        unsigned int head = *m_cqHead;
+        while (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+        {
+            io_uring_cqe cqe = m_cqes[head & m_cqMask];
+            __atomic_store_n(m_cqHead, ++head, __ATOMIC_RELEASE);
+            if (!(cqe.flags & IORING_CQE_F_MORE)) m_nInFlight--;
+            onCompletion(cqe);
+        }
+    }
+
+    // the number of operations that have not completed for good yet (a multishot one only has with its last completion)
+    int getNumInFlight() const
+    {
+        return m_nInFlight;
+    }
+
+    // the provided buffer a receive completed into, or nullptr if it did not use one
+    const char* getBuffer(const io_uring_cqe& cqe) const
+    {
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) return nullptr;
+        return m_buffers.data() + (size_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) * m_bufferSize;
+    }
+
+    // hands the buffer a receive completed into back to the kernel
+    void recycleBuffer(const io_uring_cqe& cqe)
+    {
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) return;
+        provideBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        publishBuffers();
+    }
+
+private:
+    int m_fd = -1;
+    void* m_sqRing = MAP_FAILED;
+    void* m_cqRing = MAP_FAILED;
+    void* m_sqes = MAP_FAILED;
+    size_t m_sqRingSize = 0;
+    size_t m_cqRingSize = 0;
+    size_t m_sqesSize = 0;
+
+    unsigned int* m_sqHead = nullptr;
+    unsigned int* m_sqTail = nullptr;
+    unsigned int m_sqMask = 0;
+    unsigned int m_sqEntries = 0;
+    unsigned int m_tail = 0;        // the submission tail, published to the kernel by submit()
+    unsigned int* m_cqHead = nullptr;
+    unsigned int* m_cqTail = nullptr;
+    unsigned int m_cqMask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+    int m_nInFlight = 0;
+
+    int m_wakeFd = -1;
+    uint64_t m_wakeCount = 0;
+
+    void* m_bufRing = MAP_FAILED;
+    size_t m_bufRingSize = 0;
+    int m_nBuffers = 0;
+    int m_bufferSize = 0;
+    unsigned short m_bufTail = 0;
+    std::vector<char> m_buffers;
+
+    bool fail(const std::string& what)
+    {
+        err = what + ". Error: " + std::string(strerror(errno));
+        return false;
+    }
+
+    io_uring_sqe* getSqe(int opcode, int fd, uint64_t userData)
+    {
+        if (m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+        {
+            submit(0);
+            if (m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) return nullptr;
+        }
+
+        io_uring_sqe* sqe = &((io_uring_sqe*)m_sqes)[m_tail & m_sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = userData;
+        m_tail++;
+        m_nInFlight++;
+        return sqe;
+    }
+
+    void provideBuffer(int id)
+    {
+        io_uring_buf* buf = &((io_uring_buf*)m_bufRing)[m_bufTail & (m_nBuffers - 1)];
+        buf->addr = (uint64_t)(uintptr_t)(m_buffers.data() + (size_t)id * m_bufferSize);
+        buf->len = m_bufferSize;
+        buf->bid = (unsigned short)id;
+        m_bufTail++;
+    }
+
+    // the ring's tail overlays the reserved field of its first entry
+    void publishBuffers()
+    {
+        __atomic_store_n(&((io_uring_buf*)m_bufRing)[0].resv, m_bufTail, __ATOMIC_RELEASE);
+    }
+};
+
+// what a ServerTCP ring completion is for, kept in the low bits of its user data, next to the (aligned) shard or connection it is about
+const uint64_t ringWake = 1;
+const uint64_t ringAccept = 2;
+const uint64_t ringReceive = 3;
+const uint64_t ringSend = 4;
+const uint64_t ringPoll = 5;
+const uint64_t ringOpMask = 7;
+
+#endif
+
+struct Garnet::ServerTCP::Shard
+{
+    Socket socket;
+    std::thread accepting;
+    std::unordered_map<std::thread::id, std::thread> receivings;
+    std::vector<std::thread::id> finishedReceivings;    // receiving threads of clients that have left, joined by the accepting thread
+
+    struct Client
+    {
+        Socket socket;
+        std::shared_ptr<Connection> conn; // reactor mode only
+    };
+
+    // a client in the list that iteration walks; an unlinked node keeps its next pointer, so a reader standing on it can still move on
+    struct Node
+    {
+        Address address;
+        Client client;
+        std::atomic<Node*> next{ nullptr };
+        Node* prev = nullptr;   // only touched with clientsMtx held
+    };
+
+    // the authoritative client table, so that connects, disconnects and lookups are O(1)
+    std::unordered_map<Address, Node*> clients;
+    mutable std::mutex clientsMtx;
+
+    // the same clients as a doubly linked list that readers walk without locking (RCU style): a connect links one node in at the head
+    // and a disconnect unlinks one, both in O(1) without copying the table, and unlinked nodes are freed once no reader can still be on them;
+    // what remains per change is one node allocation and the epoch domain's reclamation pass, and a walk that overlaps changes may see some of them
+    std::atomic<Node*> head{ nullptr };
+
+    ~Shard()
+    {
+        Node* node = head.load();
+        while (node != nullptr)
+        {
+            Node* next = node->next.load();
+            delete node;
+            node = next;
+        }
+
+        // the server's threads are gone by now, so the clients they removed last can be freed too
+        EpochDomain::get().collect();
+    }
+
+    // must be called with clientsMtx held; does nothing if the address is already in the table
+    void insert(const Address& address, const Client& client)
+    {
+        if (clients.count(address) != 0) return;
+
+        Node* node = new Node();
+        node->address = address;
+        node->client = client;
+        Node* first = head.load(std::memory_order_relaxed);
+        node->next.store(first, std::memory_order_relaxed);
+        if (first != nullptr) first->prev = node;
+        head.store(node, std::memory_order_release);
+        clients.insert({ address, node });
+    }
+
+    // must be called with clientsMtx held
+    void erase(const Address& address)
+    {
+        auto it = clients.find(address);
+        if (it == clients.end()) return;
+
+        Node* node = it->second;
+        Node* next = node->next.load(std::memory_order_relaxed);
+        if (node->prev != nullptr) node->prev->next.store(next, std::memory_order_release);
+        else head.store(next, std::memory_order_release);
+        if (next != nullptr) next->prev = node->prev;
+        clients.erase(it);
+        EpochDomain::get().retire([node]() { delete node; });
+    }
+
+    // must be called inside an EpochGuard, which keeps every node reached from here alive
+    const Node* getFirst() const
+    {
+        return head.load(std::memory_order_acquire);
+    }
+
+    static const Node* getNext(const Node* node)
+    {
+        return node->next.load(std::memory_order_acquire);
+    }
+};
+
+// an entry of a client's write queue: bytes to send, or a file range or a caller's buffer that goes out without being copied,
+// either of which is only sent once everything queued ahead of it has been
+struct Garnet::ServerTCP::WriteItem
+{
+    Buffer data;
+    long long size = 0;
+    int fileDescriptor = -1;            // owned by the item, and closed once the range has been sent or the client is gone
+    long long fileOffset = 0;
+    const char* zeroCopyData = nullptr;
+    unsigned int zeroCopyToken = 0;     // reported once the kernel is done with zeroCopyData
+    bool copyFallback = false;          // out of optmem for pinned pages, so the rest of zeroCopyData is copied
+
+    bool isData() const
+    {
+        return fileDescriptor == -1 && zeroCopyData == nullptr;
+    }
+};
+
+struct Garnet::ServerTCP::Connection : public std::enable_shared_from_this<Connection>
+{
+    Socket socket;
+    Shard* shard = nullptr;
+    Reactor* reactor = nullptr;
+    MessageFramer framer;
+    std::shared_ptr<Strand> strand;     // runs the client's callbacks in order when there are worker threads
+
+    std::mutex writeMtx;                // guards the fields below, and the socket against being closed mid-write
+    std::deque<WriteItem> writeQueue;   // what the socket has not taken yet, sent in order by the reactor when it becomes writable
+    long long writeOffset = 0;          // bytes of the front item already written
+    size_t queuedBytes = 0;
+    bool aboveHighWatermark = false;
+    bool closed = false;
+    bool zeroCopySent = false;          // a zero-copy item has been sent since the last check, so its token may be complete already
+#ifdef GNET_OS_LINUX
+    std::shared_ptr<ZeroCopyState> zeroCopyState;   // looked up by the first zero-copy send
+#endif
+
+#ifdef GNET_IO_URING
+    // with IOModel::IOUring, only touched by the ring thread
+    int nOps = 0;                       // operations in flight, which keep the descriptor open and the connection alive
+    bool flushing = false;              // a send of the write queue is in flight
+    bool sendingZeroCopy = false;       // the send in flight uses MSG_ZEROCOPY
+    bool disconnecting = false;
+    iovec sendIovs[16];
+    msghdr sendMsg{};
+#endif
+
+#ifdef GNET_OS_UNIX
+    // points iovecs at the data items at the front of the write queue; must be called with writeMtx held
+    int getWriteIovs(iovec* iovs, int maxIovs)
+    {
+        int nIovs = 0;
+        for (auto it = writeQueue.begin(); it != writeQueue.end() && it->isData() && nIovs < maxIovs; ++it, ++nIovs)
+        {
+            long long offset = nIovs == 0 ? writeOffset : 0;
+            iovs[nIovs].iov_base = (char*)it->data.getData() + offset;
+            iovs[nIovs].iov_len = it->size - offset;
+        }
+        return nIovs;
+    }
+#endif
+
+#ifdef GNET_OS_LINUX
+    // writes as much of the front item as the socket takes without blocking, and returns the number of bytes or -1 with errno set;
+    // must be called with writeMtx held, and for a file only on a non-blocking socket
+    long long writeFront()
+    {
+        WriteItem& item = writeQueue.front();
+        while (true)
+        {
+            long long nBytes;
+            if (item.fileDescriptor != -1)
+            {
+                SigPipeGuard sigPipeGuard;
+                off_t pos = item.fileOffset + writeOffset;
+                nBytes = ::sendfile(socket.m_bSocket, item.fileDescriptor, &pos, item.size - writeOffset);
+                if (nBytes == -1 && errno == EINTR) continue;
+                if (nBytes <= 0 && (nBytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)))
+                {
+                    // the rest of the stream would be misaligned after a short range, so the client has to go
+                    dropClient(nBytes == 0 ? "file is shorter than the range being sent" : "file could not be read. Error: " + std::string(strerror(errno)));
+                    errno = EPIPE;
+                    return -1;
+                }
+                return nBytes;
+            }
+
+            if (item.zeroCopyData != nullptr)
+            {
+                bool zeroCopy = !item.copyFallback && item.size >= zeroCopyMinSize;
+                nBytes = ::send(socket.m_bSocket, item.zeroCopyData + writeOffset, item.size - writeOffset, MSG_NOSIGNAL | MSG_DONTWAIT | (zeroCopy ? MSG_ZEROCOPY : 0));
+                if (nBytes == -1 && errno == ENOBUFS && zeroCopy)
+                {
+                    item.copyFallback = true;
+                    continue;
+                }
+                if (nBytes > 0 && zeroCopy) useZeroCopyId();
+            }
+            else
+            {
+                const int maxIovs = 64;
+                iovec iovs[maxIovs];
+                msghdr msg{};
+                msg.msg_iov = iovs;
+                msg.msg_iovlen = getWriteIovs(iovs, maxIovs);
+                nBytes = ::sendmsg(socket.m_bSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            }
+
+            if (nBytes == -1 && errno == EINTR) continue;
+            return nBytes;
+        }
+    }
+
+    // moves the next chunk of the file range at the front into a data item queued ahead of it, for a ring, where sendfile() would block
+    // the ring thread on the blocking socket; must be called with writeMtx held
+    bool readFileChunk()
+    {
+        const long long chunkSize = 256 * 1024;
+        WriteItem& item = writeQueue.front();
+        Buffer chunk((int)std::min(item.size, chunkSize));
+        ssize_t nBytes;
+        do nBytes = ::pread(item.fileDescriptor, chunk.getData(), chunk.getSize(), item.fileOffset);
+        while (nBytes == -1 && errno == EINTR);
+        if (nBytes <= 0)
+        {
+            dropClient(nBytes == 0 ? "file is shorter than the range being sent" : "file could not be read. Error: " + std::string(strerror(errno)));
+            return false;
+        }
+
+        item.fileOffset += nBytes;
+        item.size -= nBytes;
+        if (item.size == 0) popWrite();
+
+        WriteItem chunkItem;
+        chunkItem.data = nBytes < chunk.getSize() ? chunk.slice(0, (int)nBytes) : std::move(chunk);
+        chunkItem.size = nBytes;
+        writeQueue.push_front(std::move(chunkItem));
+        return true;
+    }
+
+    // counts a MSG_ZEROCOPY send that transmitted something, which is when the kernel uses up a notification id
+    void useZeroCopyId()
+    {
+        std::lock_guard<std::mutex> lock(zeroCopyState->mtx);
+        zeroCopyState->nextId++;
+    }
+
+    // shuts the socket down, which the reactor notices and disconnects the client as usual
+    void dropClient(const std::string& reason)
+    {
+        socket.shutdown();
+        err = "ServerTCP dropped client " + socket.getAddress().getHost() + ": " + reason;
+        if (printErrors) std::cout << err << "\n";
+    }
+#endif
+
+    // drops the front item, which the socket has taken all of; must be called with writeMtx held
+    void popWrite()
+    {
+    #ifdef GNET_OS_LINUX
+        WriteItem& item = writeQueue.front();
+        if (item.fileDescriptor != -1) ::close(item.fileDescriptor);
+        if (item.zeroCopyData != nullptr)
+        {
+            // completes once every notification id used so far has, which keeps tokens completing in the order they were handed out
+            std::lock_guard<std::mutex> lock(zeroCopyState->mtx);
+            zeroCopyState->pending.push_back({ item.zeroCopyToken, zeroCopyState->nextId - 1 });
+            zeroCopySent = true;
+        }
+    #endif
+        writeQueue.pop_front();
+    }
+
+    // drops the bytes the socket has taken from the front of the write queue, and returns whether that brought it down to the low watermark;
+    // must be called with writeMtx held
+    bool consumeWrites(long long nBytes, int lowWatermark)
+    {
+        queuedBytes -= nBytes;
+
+        // empty items go along with whatever was queued ahead of them
+        nBytes += writeOffset;
+        while (!writeQueue.empty() && nBytes >= writeQueue.front().size)
+        {
+            nBytes -= writeQueue.front().size;
+            popWrite();
+        }
+        writeOffset = nBytes;
+
+        if (!aboveHighWatermark || queuedBytes > (size_t)lowWatermark) return false;
+        aboveHighWatermark = false;
+        return true;
+    }
+
+    // closes the socket such that sends still in flight on other threads fail rather than write to a reused descriptor
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(writeMtx);
+        closed = true;
+    #ifdef GNET_OS_LINUX
+        for (WriteItem& item : writeQueue)
+        {
+            if (item.fileDescriptor != -1) ::close(item.fileDescriptor);
+        }
+    #endif
+        writeQueue.clear();
+        writeOffset = 0;
+        queuedBytes = 0;
+        socket.close();
+    }
+};
+
+struct Garnet::ServerTCP::Reactor
+{
+#ifdef GNET_OS_LINUX
+    int epollFd = -1;
+    int wakeFd = -1;
+#endif
+    IOUring* ring = nullptr;            // with IOModel::IOUring, in place of epoll and the wake eventfd
+    std::vector<Shard*> shards;         // with IOModel::IOUring, the shards whose listening sockets this ring accepts on
+    std::thread thread;
+
+    std::mutex pendingMtx;
+    std::vector<std::shared_ptr<Connection>> pending;                           // accepted connections not yet registered with the reactor
+    std::vector<std::shared_ptr<Connection>> flushes;                           // with IOModel::IOUring, connections with newly queued writes
+    std::unordered_map<Connection*, std::shared_ptr<Connection>> connections;   // only touched by the reactor thread (or after it has been joined)
+    bool tearDownOnExit = false;        // set when the server is closed from this reactor's own thread, which then tears it down once its loop exits
+
+    void close()
+    {
+        for (auto& conn : pending) conn->close();
+        for (auto& entry : connections) entry.second->close();
+    #ifdef GNET_OS_LINUX
+        if (epollFd != -1) ::close(epollFd);
+        if (wakeFd != -1) ::close(wakeFd);
+    #endif
+    #ifdef GNET_IO_URING
+        delete ring;
+    #endif
+    }
+
+    void wake()
+    {
+    #ifdef GNET_IO_URING
+        if (ring != nullptr)
+        {
+            ring->wake();
+            return;
+        }
+    #endif
+    #ifdef GNET_OS_LINUX
+        uint64_t one = 1;
+        write(wakeFd, &one, sizeof(one));
+    #endif
+    }
+};
+
+Garnet::ServerTCP::ServerTCP()
+{
+    m_addr = Address();
+    m_bufSize = 256;
+    m_nClients = 0;
+    m_open = false;
+    m_ioModel = IOModel::ThreadPerClient;
+    m_nIOThreads = 0;
+    m_nextReactor = 0;
+    m_nAcceptShards = 1;
+    m_nWorkers = 0;
+    m_workers = nullptr;
+    m_zeroCopy = false;
+    m_framed = false;
+    m_maxMessageSize = 16 * 1024 * 1024;
+    m_lowWatermark = 256 * 1024;
+    m_highWatermark = 1024 * 1024;
+    m_maxWriteQueueSize = 0;
+    m_pReceiveCallback = nullptr;
+    m_pClientConnectCallback = nullptr;
+    m_pClientDisconnectCallback = nullptr;
+    m_pZeroCopyCallback = nullptr;
+    m_pHighWatermarkCallback = nullptr;
+    m_pLowWatermarkCallback = nullptr;
+}
+
+Garnet::ServerTCP::ServerTCP(Address addr, bool* success)
+{
+    m_addr = addr;
+    bool successA, successB;
+    m_socket = Socket(Protocol::TCP, &successA);
+    m_socket.bind(addr, &successB);
+    m_bufSize = 256;
+    m_nClients = 0;
+    m_open = false;
+    m_ioModel = IOModel::ThreadPerClient;
+    m_nIOThreads = 0;
+    m_nextReactor = 0;
+    m_nAcceptShards = 1;
+    m_nWorkers = 0;
+    m_workers = nullptr;
+    m_zeroCopy = false;
+    m_framed = false;
+    m_maxMessageSize = 16 * 1024 * 1024;
+    m_lowWatermark = 256 * 1024;
+    m_highWatermark = 1024 * 1024;
+    m_maxWriteQueueSize = 0;
+    m_pReceiveCallback = nullptr;
+    m_pClientConnectCallback = nullptr;
+    m_pClientDisconnectCallback = nullptr;
+    m_pZeroCopyCallback = nullptr;
+    m_pHighWatermarkCallback = nullptr;
+    m_pLowWatermarkCallback = nullptr;
+
+    if (success != nullptr) *success = successA && successB; 
+}
+
+Garnet::ServerTCP::~ServerTCP()
+{
+    if (m_open) close();
+    WorkerPool::release(m_workers);
+}
+
+void Garnet::ServerTCP::open(int backlog, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to open ServerTCP: already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    // with more than one shard, every listening socket (including the one bound in the constructor) needs SO_REUSEPORT before binding
+    std::vector<Socket> listeners;
+    if (m_nAcceptShards > 1)
+    {
+        m_socket.close();
+        for (int i = 0; i < m_nAcceptShards; i++)
+        {
+            bool successA, successB, successC;
+            Socket listener(Protocol::TCP, &successA);
+            if (successA) listener.setReusePort(true, &successB);
+            if (successA && successB) listener.bind(m_addr, &successC);
+            if (!successA || !successB || !successC)
+            {
+                if (successA) listener.close();
+                for (Socket& opened : listeners) opened.close();
+                if (success != nullptr) *success = false;
+                return;
+            }
+            listeners.push_back(listener);
+        }
+        m_socket = listeners[0];
+    }
+    else listeners.push_back(m_socket);
+
+    for (Socket& listener : listeners)
+    {
+        // accepted sockets get the options again, but buffer sizes also have to be on the listener before the handshake to size the window
+        listener.setOptions(m_socketOptions);
+        bool successA;
+        listener.listen(backlog, &successA);
+        if (!successA)
+        {
+            if (m_nAcceptShards > 1) for (Socket& opened : listeners) opened.close();
+            if (success != nullptr) *success = false;
+            return;
+        }
+    }
+
+    m_open = true;
+
+    if (m_workers != nullptr && m_workers->getNumThreads() != m_nWorkers)
+    {
+        WorkerPool::release(m_workers);
+        m_workers = nullptr;
+    }
+    if (m_workers == nullptr && m_nWorkers > 0) m_workers = new WorkerPool(m_nWorkers);
+
+    for (int i = 0; i < (int)listeners.size(); i++)
+    {
+        Shard* shard = new Shard();
+        shard->socket = listeners[i];
+        m_shards.push_back(shard);
+    }
+
+    if (m_ioModel != IOModel::ThreadPerClient && !openReactors())
+    {
+        if (m_ioModel == IOModel::IOUring)
+        {
+            err = "ServerTCP could not use io_uring, falling back to thread-per-client: " + err;
+            if (printErrors) std::cout << err << "\n";
+            m_ioModel = IOModel::ThreadPerClient;
+        }
+        else
+        {
+            err = "Failed to open ServerTCP: " + err;
+            if (printErrors) std::cout << err << "\n";
+            m_open = false;
+            for (Shard* shard : m_shards)
+            {
+                if (m_nAcceptShards > 1) shard->socket.close();
+                delete shard;
+            }
+            m_shards.clear();
+            if (success != nullptr) *success = false;
+            return;
+        }
+    }
+
+    // the rings accept through io_uring themselves
+    if (m_ioModel != IOModel::IOUring)
+    {
+        unsigned int nCores = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < (int)m_shards.size(); i++)
+        {
+            m_shards[i]->accepting = std::thread(&Garnet::ServerTCP::accept, this, m_shards[i]);
+
+        #ifdef GNET_OS_LINUX
+            if (m_shards.size() > 1)
+            {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(i % nCores, &cpus);
+                pthread_setaffinity_np(m_shards[i]->accepting.native_handle(), sizeof(cpus), &cpus);
+            }
+        #endif
+        }
+    }
+
+    if (success != nullptr) *success = true;
+}
+
+bool Garnet::ServerTCP::openReactors()
+{
+#ifdef GNET_OS_LINUX
+    int nThreads = m_nIOThreads > 0 ? m_nIOThreads : std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < nThreads; i++)
+    {
+        Reactor* reactor = new Reactor();
+        m_reactors.push_back(reactor);
+
+        bool created;
+        if (m_ioModel == IOModel::IOUring)
+        {
+        #ifdef GNET_IO_URING
+            // the multishot receives of all of a ring's clients draw from its buffers, which go back to the kernel as soon as they are copied out
+            reactor->ring = new IOUring();
+            created = reactor->ring->init(4096, 1024, std::max((int)m_bufSize, 1));
+        #else
+            err = "io_uring is not supported by the kernel headers Garnet was built with";
+            created = false;
+        #endif
+        }
+        else
+        {
+            reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+            reactor->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr; // nullptr marks the wake eventfd
+            created = reactor->epollFd != -1 && reactor->wakeFd != -1 && epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, reactor->wakeFd, &ev) != -1;
+            if (!created) err = "failed to create reactor. Error: " + std::string(strerror(errno));
+        }
+
+        if (!created)
+        {
+            closeReactors();
+            return false;
+        }
+    }
+
+    // each listening socket is accepted on by one ring, which spreads the clients it accepts across all of them
+    if (m_ioModel == IOModel::IOUring)
+    {
+        for (int i = 0; i < (int)m_shards.size(); i++) m_reactors[i % m_reactors.size()]->shards.push_back(m_shards[i]);
+    }
+
+    for (Reactor* reactor : m_reactors)
+    {
+        if (m_ioModel == IOModel::IOUring) reactor->thread = std::thread(&Garnet::ServerTCP::reactRing, this, reactor);
+        else reactor->thread = std::thread(&Garnet::ServerTCP::react, this, reactor);
+    }
+    return true;
+#else
+    err = "the reactor and io_uring I/O models are only supported on Linux";
+    return false;
+#endif
+}
+
+void Garnet::ServerTCP::closeReactors()
+{
+#ifdef GNET_OS_LINUX
+    // wake and join every reactor before tearing any down, since a ring may still hand a client it accepted to another;
+    // when closing from inside a callback, the calling reactor is still on the stack, so it is left to tear itself down once its loop exits
+    for (Reactor* reactor : m_reactors)
+    {
+        if (!reactor->thread.joinable()) continue;
+        reactor->wake();
+        if (reactor->thread.get_id() == std::this_thread::get_id()) reactor->tearDownOnExit = true;
+        joinThread(reactor->thread);
+    }
+
+    for (Reactor* reactor : m_reactors)
+    {
+        if (reactor->tearDownOnExit) continue;
+        reactor->close();
+        delete reactor;
+    }
+    m_reactors.clear();
+#endif
+}
+
+void Garnet::ServerTCP::send(void* data, int size, Address clientAddr, bool* success)
+{
+    Span span;
+    span.data = data;
+    span.size = size;
+    send(&span, 1, clientAddr, success);
+}
+
+void Garnet::ServerTCP::send(const Span* spans, int count, Address clientAddr, bool* success)
+{
+    FramedSpans framed(spans, count, m_framed);
+
+#ifdef GNET_OS_LINUX
+    if (m_ioModel != IOModel::ThreadPerClient)
+    {
+        std::shared_ptr<Connection> conn = findConnection(clientAddr);
+        if (conn == nullptr)
+        {
+            err = "ServerTCP send failed: client is not connected";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        queueWrite(conn.get(), framed.get(), framed.getCount(), success);
+        return;
+    }
+#endif
+
+    Socket clientSocket;
+    if (!findClient(clientAddr, &clientSocket))
+    {
+        err = "ServerTCP send failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (framed.getCount() == 1) clientSocket.send(framed.get()[0].data, framed.get()[0].size, success);
+    else clientSocket.sendv(framed.get(), framed.getCount(), success);
+}
+
+void Garnet::ServerTCP::broadcast(void* data, int size, Address excludeClientAddr, bool* success)
+{
+    sendToAll(data, size, excludeClientAddr.isEmpty() ? nullptr : &excludeClientAddr, nullptr, success);
+}
+
+void Garnet::ServerTCP::multicast(void* data, int size, const std::vector<Address>& clientAddrs, bool* success)
+{
+    sendToAll(data, size, nullptr, &clientAddrs, success);
+}
+
+void Garnet::ServerTCP::sendToAll(void* data, int size, const Address* exclude, const std::vector<Address>* only, bool* success)
+{
+    // frame (if needed) and copy the data once, into a buffer that every recipient's write queue can share
+    Span span;
+    span.data = data;
+    span.size = size;
+    FramedSpans framed(&span, 1, m_framed);
+    int payloadSize = 0;
+    for (int i = 0; i < framed.getCount(); i++) payloadSize += framed.get()[i].size;
+
+    Buffer payload(payloadSize);
+    int pos = 0;
+    for (int i = 0; i < framed.getCount(); i++)
+    {
+        memcpy((char*)payload.getData() + pos, framed.get()[i].data, framed.get()[i].size);
+        pos += framed.get()[i].size;
+    }
+    Span payloadSpan;
+    payloadSpan.data = payload.getData();
+    payloadSpan.size = payloadSize;
+
+    // walk each shard's client list without taking its lock
+    std::unordered_set<Address> wanted;
+    if (only != nullptr) wanted.insert(only->begin(), only->end());
+    auto isRecipient = [&](const Address& addr)
+    {
+        if (exclude != nullptr && addr == *exclude) return false;
+        return only == nullptr || wanted.count(addr) != 0;
+    };
+
+    bool allSent = true;
+#ifdef GNET_OS_LINUX
+    if (m_ioModel != IOModel::ThreadPerClient)
+    {
+        // the guard keeps every connection reached on the lists alive until it is released
+        EpochGuard guard;
+        for (Shard* shard : m_shards)
+        {
+            for (const Shard::Node* node = shard->getFirst(); node != nullptr; node = Shard::getNext(node))
+            {
+                if (!isRecipient(node->address)) continue;
+
+                bool sent;
+                queueWrite(node->client.conn.get(), &payloadSpan, 1, &sent, &payload);
+                allSent = allSent && sent;
+            }
+        }
+
+        if (success != nullptr) *success = allSent;
+        return;
+    }
+#endif
+
+    std::vector<Socket> recipients;
+    {
+        EpochGuard guard;
+        for (Shard* shard : m_shards)
+        {
+            for (const Shard::Node* node = shard->getFirst(); node != nullptr; node = Shard::getNext(node))
+            {
+                if (isRecipient(node->address)) recipients.push_back(node->client.socket);
+            }
+        }
+    }
+
+    for (Socket& clientSocket : recipients)
+    {
+        bool sent;
+        clientSocket.send(payload.getData(), payloadSize, &sent);
+        allSent = allSent && sent;
+    }
+
+    if (success != nullptr) *success = allSent;
+}
+
+void Garnet::ServerTCP::queueWrite(Connection* conn, const Span* spans, int count, bool* success, const Buffer* payload)
+{
+#ifdef GNET_OS_LINUX
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += spans[i].size;
+
+    bool reachedHigh = false;
+    std::unique_lock<std::mutex> lock(conn->writeMtx);
+    if (conn->closed)
+    {
+        err = "ServerTCP send failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    size_t sent = 0;
+    bool idle = conn->writeQueue.empty();
+    if (idle)
+    {
+        // nothing is queued ahead of this data, so try writing it straight to the socket
+        IOVecs iovs(spans, count);
+        msghdr msg{};
+        msg.msg_iov = iovs.get();
+        msg.msg_iovlen = count;
+        int nBytes;
+        do nBytes = ::sendmsg(conn->socket.m_bSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        while (nBytes == -1 && errno == EINTR);
+
+        if (nBytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            err = "ServerTCP send failed. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+        if (nBytes > 0) sent = nBytes;
+    }
+
+    if (sent < total)
+    {
+        if (m_maxWriteQueueSize > 0 && conn->queuedBytes + (total - sent) > (size_t)m_maxWriteQueueSize)
+        {
+            // the reactor notices the shutdown and disconnects the client as usual
+            conn->socket.shutdown();
+            lock.unlock();
+            err = "ServerTCP dropped client " + conn->socket.getAddress().getHost() + ": write queue is full";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        // keep whatever the socket did not take until the reactor sees it writable again,
+        // sharing the caller's buffer if the data is already in one
+        WriteItem item;
+        item.size = total - sent;
+        if (payload != nullptr) item.data = payload->slice((int)sent, (int)(total - sent));
+        else
+        {
+            Buffer rest((int)(total - sent));
+            size_t skip = sent, pos = 0;
+            for (int i = 0; i < count; i++)
+            {
+                size_t size = spans[i].size;
+                if (skip >= size)
+                {
+                    skip -= size;
+                    continue;
+                }
+                memcpy((char*)rest.getData() + pos, (const char*)spans[i].data + skip, size - skip);
+                pos += size - skip;
+                skip = 0;
+            }
+            item.data = std::move(rest);
+        }
+        conn->writeQueue.push_back(std::move(item));
+        conn->queuedBytes += total - sent;
+
+        if (!conn->aboveHighWatermark && conn->queuedBytes >= (size_t)m_highWatermark)
+        {
+            conn->aboveHighWatermark = true;
+            reachedHigh = true;
+        }
+    }
+    lock.unlock();
+
+    // a ring does not watch for writability, so ask it to send what was just queued behind nothing
+    if (idle && sent < total) requestFlush(conn);
+
+    if (reachedHigh && m_pHighWatermarkCallback != nullptr) m_pHighWatermarkCallback(conn->socket.getAddress());
+    if (success != nullptr) *success = true;
+#endif
+}
+
+void Garnet::ServerTCP::queueWrite(Connection* conn, WriteItem& item, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    bool reachedHigh = false, reachedLow = false;
+    std::unique_lock<std::mutex> lock(conn->writeMtx);
+    if (conn->closed)
+    {
+        if (item.fileDescriptor != -1) ::close(item.fileDescriptor);
+        err = "ServerTCP send failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (m_maxWriteQueueSize > 0 && conn->queuedBytes + item.size > (size_t)m_maxWriteQueueSize)
+    {
+        if (item.fileDescriptor != -1) ::close(item.fileDescriptor);
+        conn->dropClient("write queue is full");
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (item.zeroCopyData != nullptr)
+    {
+        if (conn->zeroCopyState == nullptr) conn->zeroCopyState = findZeroCopyState(conn->socket.m_bSocket);
+        if (conn->zeroCopyState == nullptr)
+        {
+            err = "ServerTCP sendZeroCopy failed: zero copy is not enabled on this socket";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        // handed out under writeMtx, so that tokens are in the same order as the queue
+        std::lock_guard<std::mutex> stateLock(conn->zeroCopyState->mtx);
+        item.zeroCopyToken = conn->zeroCopyState->nextToken++;
+    }
+
+    bool idle = conn->writeQueue.empty();
+    long long size = item.size;
+    conn->writeQueue.push_back(std::move(item));
+    conn->queuedBytes += size;
+
+    if (idle && size == 0) conn->consumeWrites(0, m_lowWatermark);
+    else if (idle && m_ioModel == IOModel::Reactor)
+    {
+        // edge-triggered EPOLLOUT only fires once a full socket frees up, so write until it is full rather than wait for it
+        while (!conn->writeQueue.empty())
+        {
+            long long nBytes = conn->writeFront();
+            if (nBytes <= 0) break;
+            reachedLow = conn->consumeWrites(nBytes, m_lowWatermark) || reachedLow;
+        }
+    }
+
+    if (!conn->aboveHighWatermark && conn->queuedBytes >= (size_t)m_highWatermark)
+    {
+        conn->aboveHighWatermark = true;
+        reachedHigh = true;
+    }
+    bool zeroCopySent = conn->zeroCopySent;
+    conn->zeroCopySent = false;
+    lock.unlock();
+
+    if (idle && size > 0 && m_ioModel == IOModel::IOUring) requestFlush(conn);
+
+    // small sends complete immediately, so report them without waiting for the next error queue wakeup
+    if (zeroCopySent) completeZeroCopy(conn->socket);
+    if (reachedLow && m_pLowWatermarkCallback != nullptr) m_pLowWatermarkCallback(conn->socket.getAddress());
+    if (reachedHigh && m_pHighWatermarkCallback != nullptr) m_pHighWatermarkCallback(conn->socket.getAddress());
+    if (success != nullptr) *success = true;
+#else
+    (void)conn;
+    (void)item;
+    (void)success;
+#endif
+}
+
+void Garnet::ServerTCP::requestFlush(Connection* conn)
+{
+#ifdef GNET_IO_URING
+    if (m_ioModel != IOModel::IOUring) return;
+
+    Reactor* reactor = conn->reactor;
+    reactor->pendingMtx.lock();
+    reactor->flushes.push_back(conn->shared_from_this());
+    reactor->pendingMtx.unlock();
+    reactor->wake();
+#else
+    (void)conn;
+#endif
+}
+
+void Garnet::ServerTCP::flushWrites(Connection* conn)
+{
+#ifdef GNET_OS_LINUX
+    bool reachedLow = false;
+    conn->writeMtx.lock();
+    while (!conn->writeQueue.empty())
+    {
+        long long nBytes = conn->writeFront();
+        if (nBytes <= 0) break; // full again, or an error that the receiving side reports as a disconnect
+
+        reachedLow = conn->consumeWrites(nBytes, m_lowWatermark) || reachedLow;
+    }
+    bool zeroCopySent = conn->zeroCopySent;
+    conn->zeroCopySent = false;
+    conn->writeMtx.unlock();
+
+    if (zeroCopySent) completeZeroCopy(conn->socket);
+    if (reachedLow && m_pLowWatermarkCallback != nullptr) m_pLowWatermarkCallback(conn->socket.getAddress());
+#endif
+}
+
+unsigned int Garnet::ServerTCP::sendZeroCopy(void* data, int size, Address clientAddr, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    if (m_ioModel != IOModel::ThreadPerClient)
+    {
+        std::shared_ptr<Connection> conn = findConnection(clientAddr);
+        if (conn == nullptr)
+        {
+            err = "ServerTCP sendZeroCopy failed: client is not connected";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return 0;
+        }
+
+        WriteItem item;
+        item.zeroCopyData = (const char*)data;
+        item.size = size;
+        queueWrite(conn.get(), item, success);
+        return item.zeroCopyToken; // set before the item was moved into the queue
+    }
+#endif
+
+    Socket clientSocket;
+    if (!findClient(clientAddr, &clientSocket))
+    {
+        err = "ServerTCP sendZeroCopy failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return 0;
+    }
+
+    unsigned int token = 0;
+    clientSocket.sendZeroCopy(data, size, &token, success);
+
+    // small sends complete immediately, so report them without waiting for the next error queue wakeup
+    if (m_zeroCopy) completeZeroCopy(clientSocket);
+    return token;
+}
+
+void Garnet::ServerTCP::sendFile(const std::string& path, Address clientAddr, long long offset, long long length, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    if (m_ioModel != IOModel::ThreadPerClient)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            err = "ServerTCP sendFile failed: could not open '" + path + "'. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        sendFile(fd, clientAddr, offset, length, success);
+        ::close(fd);
+        return;
+    }
+#endif
+
+    Socket clientSocket;
+    if (!findClient(clientAddr, &clientSocket))
+    {
+        err = "ServerTCP sendFile failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    clientSocket.sendFile(path, offset, length, success);
+}
+
+void Garnet::ServerTCP::sendFile(int fileDescriptor, Address clientAddr, long long offset, long long length, bool* success)
+{
+#ifdef GNET_OS_LINUX
+    if (m_ioModel != IOModel::ThreadPerClient)
+    {
+        std::shared_ptr<Connection> conn = findConnection(clientAddr);
+        if (conn == nullptr)
+        {
+            err = "ServerTCP sendFile failed: client is not connected";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat) != 0)
+        {
+            err = "ServerTCP sendFile failed: invalid file descriptor. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        if (length < 0) length = fileStat.st_size - offset;
+        if (offset < 0 || length < 0 || offset + length > fileStat.st_size)
+        {
+            err = "ServerTCP sendFile failed: range is outside of the file";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        // the queue keeps its own descriptor, so the caller can close theirs right away
+        WriteItem item;
+        item.fileDescriptor = fcntl(fileDescriptor, F_DUPFD_CLOEXEC, 0);
+        item.fileOffset = offset;
+        item.size = length;
+        if (item.fileDescriptor == -1)
+        {
+            err = "ServerTCP sendFile failed: could not duplicate the file descriptor. Error: " + std::string(strerror(errno));
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return;
+        }
+
+        queueWrite(conn.get(), item, success);
+        return;
+    }
+#endif
+
+    Socket clientSocket;
+    if (!findClient(clientAddr, &clientSocket))
+    {
+        err = "ServerTCP sendFile failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    clientSocket.sendFile(fileDescriptor, offset, length, success);
+}
+
+void Garnet::ServerTCP::disconnectClient(Address clientAddr, bool* success)
+{
+    Socket clientSocket;
+    if (!findClient(clientAddr, &clientSocket))
+    {
+        err = "ServerTCP disconnectClient failed: client is not connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    // wakes the client's receiving thread or reactor, which then removes the client
+    clientSocket.shutdown(success);
+}
+
+void Garnet::ServerTCP::close(bool* success)
+{
+    if (!m_open)
+    {
+        err = "Failed to close ServerTCP: not open yet or already closed";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_open = false;
+    m_callbackMtx.lock();
+    m_callbackMtx.unlock();
+    m_callbackCv.notify_all();
+
+    // wake the accepting threads first, so that no client is added after the rest are woken
+    for (Shard* shard : m_shards)
+    {
+        shard->socket.interrupt();
+        joinThread(shard->accepting);
+    }
+
+    if (m_ioModel != IOModel::ThreadPerClient) closeReactors();
+
+    if (m_ioModel == IOModel::ThreadPerClient)
+    {
+        // wake every receiving thread blocked on its client, then wait for all of them to see that the server is closed
+        for (Shard* shard : m_shards)
+        {
+            shard->clientsMtx.lock();
+            for (auto& entry : shard->clients) entry.second->client.socket.interrupt();
+            shard->clientsMtx.unlock();
+        }
+        for (Shard* shard : m_shards)
+        {
+            for (auto& entry : shard->receivings) joinThread(entry.second);
+            for (auto& entry : shard->clients) entry.second->client.socket.close();
+        }
+    }
+
+    // no thread can queue callbacks anymore, so let the workers finish the ones already queued
+    WorkerPool::release(m_workers);
+    m_workers = nullptr;
+
+    for (Shard* shard : m_shards)
+    {
+        shard->socket.close();
+        delete shard;
+    }
+    m_shards.clear();
+    m_nClients = 0;
+    if (success != nullptr) *success = true;
+}
+
+bool Garnet::ServerTCP::isOpen() const
+{
+    return m_open;
+}
+
+int Garnet::ServerTCP::getBufferSize() const
+{
+    return m_bufSize;
+}
+
+int Garnet::ServerTCP::getNumClients() const
+{
+    return m_nClients;
+}
+
+Garnet::Socket Garnet::ServerTCP::getClientAcceptedSocket(Address clientAddr, bool* success)
+{
+    for (Shard* shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->clientsMtx);
+        auto it = shard->clients.find(clientAddr);
+        if (it == shard->clients.end()) continue;
+
+        if (success != nullptr) *success = true;
+        return it->second->client.socket;
+    }
+
+    err = "ServerTCP getClientAcceptedSocket failed: client is not connected";
+    if (printErrors) std::cout << err << "\n";
+    if (success != nullptr) *success = false;
+    return Socket();
+}
+
+std::list<Garnet::Address> Garnet::ServerTCP::getClientAddresses() const
+{
+    std::list<Address> clientAddrs;
+    EpochGuard guard;
+    for (Shard* shard : m_shards)
+    {
+        for (const Shard::Node* node = shard->getFirst(); node != nullptr; node = Shard::getNext(node)) clientAddrs.push_back(node->address);
+    }
+    return clientAddrs;
+}
+
+std::unordered_map<Garnet::Address, Garnet::Socket> Garnet::ServerTCP::getClientMap() const
+{
+    std::unordered_map<Address, Socket> clientMap;
+    EpochGuard guard;
+    for (Shard* shard : m_shards)
+    {
+        for (const Shard::Node* node = shard->getFirst(); node != nullptr; node = Shard::getNext(node)) clientMap.insert({ node->address, node->client.socket });
+    }
+    return clientMap;
+}
+
+Garnet::IOModel Garnet::ServerTCP::getIOModel() const
+{
+    return m_ioModel;
+}
+
+int Garnet::ServerTCP::getNumAcceptShards() const
+{
+    return m_nAcceptShards;
+}
+
+int Garnet::ServerTCP::getNumWorkerThreads() const
+{
+    return m_nWorkers;
+}
+
+int Garnet::ServerTCP::getWriteQueueSize(Address clientAddr) const
+{
+    std::shared_ptr<Connection> conn = findConnection(clientAddr);
+    if (conn == nullptr) return 0;
+
+    std::lock_guard<std::mutex> lock(conn->writeMtx);
+    return (int)conn->queuedBytes;
+}
+
+void Garnet::ServerTCP::setBufferSize(int size)
+{
+    m_bufSize = size;
+}
+
+void Garnet::ServerTCP::setIOModel(IOModel model, int nThreads, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP I/O model: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+#ifndef GNET_OS_LINUX
+    if (model != IOModel::ThreadPerClient)
+    {
+        err = "Failed to set ServerTCP I/O model: the reactor and io_uring I/O models are only supported on Linux";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#endif
+
+    m_ioModel = model;
+    m_nIOThreads = nThreads;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setNumAcceptShards(int nShards, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP accept shards: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (nShards == 0) nShards = std::max(1u, std::thread::hardware_concurrency());
+    if (nShards < 1)
+    {
+        err = "Failed to set ServerTCP accept shards: number of shards must be positive";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+#ifndef GNET_OS_LINUX
+    if (nShards > 1)
+    {
+        err = "Failed to set ServerTCP accept shards: SO_REUSEPORT load balancing is only supported on Linux";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#endif
+
+    m_nAcceptShards = nShards;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setNumWorkerThreads(int nThreads, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP worker threads: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (nThreads < 0)
+    {
+        err = "Failed to set ServerTCP worker threads: number of threads must not be negative";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_nWorkers = nThreads;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setZeroCopyEnabled(bool enabled, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP zero copy: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+#ifndef GNET_OS_LINUX
+    if (enabled)
+    {
+        err = "Failed to set ServerTCP zero copy: MSG_ZEROCOPY is only supported on Linux";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#endif
+
+    m_zeroCopy = enabled;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setSocketOptions(const SocketOptions& options, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP socket options: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_socketOptions = options;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setBusyPoll(int spinMicroseconds, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP busy polling: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_busyPoll.spinMicroseconds = std::max(spinMicroseconds, 0);
+    if (success != nullptr) *success = true;
+}
+
+Garnet::BusyPollStats Garnet::ServerTCP::getBusyPollStats() const
+{
+    return ::getBusyPollStats(m_busyPoll);
+}
+
+void Garnet::ServerTCP::setReceiveCallback(void(*callback)(const Buffer& buffer, int actualSize, Address fromClientAddr))
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_pReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ServerTCP::setClientConnectCallback(void(*callback)(Address clientAddr))
+{
+    m_pClientConnectCallback = callback;
+}
+
+void Garnet::ServerTCP::setClientDisconnectCallback(void(*callback)(Address clientAddr))
+{
+    m_pClientDisconnectCallback = callback;
+}
+
+void Garnet::ServerTCP::setFramingEnabled(bool enabled, int maxMessageSize, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerTCP framing: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (maxMessageSize < 0)
+    {
+        err = "Failed to set ServerTCP framing: maximum message size must not be negative";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_framed = enabled;
+    m_maxMessageSize = maxMessageSize;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setWriteQueueLimits(int lowWatermark, int highWatermark, int maxSize, bool* success)
+{
+    if (lowWatermark < 0 || highWatermark < lowWatermark || maxSize < 0 || (maxSize > 0 && maxSize < highWatermark))
+    {
+        err = "Failed to set ServerTCP write queue limits: expected 0 <= lowWatermark <= highWatermark <= maxSize (or maxSize = 0)";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_lowWatermark = lowWatermark;
+    m_highWatermark = highWatermark;
+    m_maxWriteQueueSize = maxSize;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerTCP::setZeroCopyCallback(void(*callback)(unsigned int token, Address clientAddr))
+{
+    m_pZeroCopyCallback = callback;
+}
+
+void Garnet::ServerTCP::setHighWatermarkCallback(void(*callback)(Address clientAddr))
+{
+    m_pHighWatermarkCallback = callback;
+}
+
+void Garnet::ServerTCP::setLowWatermarkCallback(void(*callback)(Address clientAddr))
+{
+    m_pLowWatermarkCallback = callback;
+}
+
+void Garnet::ServerTCP::accept(Shard* shard)
+{
+    while (m_open)
+    {
+        bool success;
+        Socket acceptedSocket;
+
+        muteAcceptErrors = true;
+        acceptedSocket = shard->socket.accept(&success);
+        muteAcceptErrors = false;
+        if (!success) continue;
+        if (!m_open)
+        {
+            // woken by close(), possibly with a connection made just for that
+            acceptedSocket.close();
+            break;
+        }
+
+        if (m_zeroCopy) acceptedSocket.setZeroCopy(true);
+        acceptedSocket.setOptions(m_socketOptions);
+        if (m_busyPoll.spinMicroseconds > 0) acceptedSocket.setBusyPoll(m_busyPoll.spinMicroseconds);
+
+    #ifdef GNET_OS_LINUX
+        if (m_ioModel == IOModel::Reactor)
+        {
+            // hand the connection to a reactor, which registers the client and calls the connect callback from its own thread
+            acceptedSocket.setBlocking(false);
+            Reactor* reactor = m_reactors[m_nextReactor++ % m_reactors.size()];
+            std::shared_ptr<Connection> conn = std::make_shared<Connection>();
+            conn->socket = acceptedSocket;
+            conn->shard = shard;
+            conn->reactor = reactor;
+            if (m_workers != nullptr) conn->strand = std::make_shared<Strand>(m_workers);
+
+            reactor->pendingMtx.lock();
+            reactor->pending.push_back(conn);
+            reactor->pendingMtx.unlock();
+            reactor->wake();
+            continue;
+        }
+    #endif
+
+        addClient(shard, acceptedSocket);
+
+        // with worker threads, queue the connect callback before the receiving thread can queue any data behind it
+        std::shared_ptr<Strand> strand = m_workers != nullptr ? std::make_shared<Strand>(m_workers) : nullptr;
+        void (*connectCallback)(Address clientAddr) = m_pClientConnectCallback;
+        Address clientAddr = acceptedSocket.getAddress();
+        if (strand != nullptr && connectCallback != nullptr) strand->post([connectCallback, clientAddr]() { connectCallback(clientAddr); });
+
+        {
+            std::lock_guard<std::mutex> lock(shard->clientsMtx);
+
+            // join the threads of clients that have left meanwhile, so that they don't pile up over the server's lifetime
+            for (std::thread::id finished : shard->finishedReceivings)
+            {
+                auto it = shard->receivings.find(finished);
+                if (it == shard->receivings.end()) continue;
+                it->second.join();
+                shard->receivings.erase(it);
+            }
+            shard->finishedReceivings.clear();
+
+            std::thread receiving(&Garnet::ServerTCP::receive, this, shard, acceptedSocket, strand);
+            std::thread::id id = receiving.get_id();
+            shard->receivings.insert({ id, std::move(receiving) });
+        }
+
+        if (strand == nullptr && connectCallback != nullptr) connectCallback(clientAddr);
+    }
+}
+
+bool Garnet::ServerTCP::findClient(const Address& clientAddr, Socket* clientSocket)
+{
+    for (Shard* shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->clientsMtx);
+        auto it = shard->clients.find(clientAddr);
+        if (it != shard->clients.end())
+        {
+            *clientSocket = it->second->client.socket;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<Garnet::ServerTCP::Connection> Garnet::ServerTCP::findConnection(const Address& clientAddr) const
+{
+    for (Shard* shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->clientsMtx);
+        auto it = shard->clients.find(clientAddr);
+        if (it != shard->clients.end()) return it->second->client.conn;
+    }
+    return nullptr;
+}
+
+void Garnet::ServerTCP::addClient(Shard* shard, const Socket& acceptedSocket, const std::shared_ptr<Connection>& conn)
+{
+    Shard::Client client;
+    client.socket = acceptedSocket;
+    client.conn = conn;
+
+    shard->clientsMtx.lock();
+    shard->insert(acceptedSocket.getAddress(), client);
+    shard->clientsMtx.unlock();
+    m_nClients = m_nClients + 1;
+}
+
+void Garnet::ServerTCP::removeClient(Shard* shard, const Address& clientAddr, Strand* strand)
+{
+    shard->clientsMtx.lock();
+    shard->erase(clientAddr);
+    shard->clientsMtx.unlock();
+    m_nClients = m_nClients - 1;
+
+    void (*callback)(Address clientAddr) = m_pClientDisconnectCallback;
+    if (callback == nullptr) return;
+
+    // behind the client's strand, the disconnect callback comes after every receive callback of that client
+    if (strand != nullptr)
+    {
+        Address addr = clientAddr;
+        strand->post([callback, addr]() { callback(addr); });
+    }
+    else callback(clientAddr);
+}
+
+void Garnet::ServerTCP::deliver(Strand* strand, const Buffer& buf, int size, const Address& clientAddr)
+{
+    void (*callback)(const Buffer& buffer, int actualSize, Address fromAddr) = m_pReceiveCallback;
+    if (callback == nullptr) return;
+
+    if (strand == nullptr)
+    {
+        callback(buf, size, clientAddr);
+        return;
+    }
+
+    // the copied handle keeps the pooled buffer alive until a worker gets to it
+    Buffer held = buf;
+    Address addr = clientAddr;
+    strand->post([callback, held, size, addr]() { callback(held, size, addr); });
+}
+
+void Garnet::ServerTCP::completeZeroCopy(Socket& clientSocket)
+{
+    const int maxTokens = 64;
+    unsigned int tokens[maxTokens];
+    int nTokens;
+    do
+    {
+        nTokens = clientSocket.getZeroCopyCompletions(tokens, maxTokens);
+        for (int i = 0; i < nTokens; i++)
+        {
+            if (m_pZeroCopyCallback != nullptr) m_pZeroCopyCallback(tokens[i], clientSocket.getAddress());
+        }
+    } while (nTokens == maxTokens);
+}
+
+void Garnet::ServerTCP::receive(Shard* shard, Socket acceptedSocket, std::shared_ptr<Strand> strand)
+{
+    MessageFramer framer;
+    while (m_open)
+    {
+        if (m_pReceiveCallback == nullptr)
+        {
+            // leave the data in the socket until there is a callback for it
+            std::unique_lock<std::mutex> lock(m_callbackMtx);
+            m_callbackCv.wait(lock, [this]() { return m_pReceiveCallback != nullptr || !m_open; });
+            continue;
+        }
+
+        Buffer buf;
+        void* dst;
+        int dstSize;
+        if (m_framed) dst = framer.prepareRead(m_bufSize, &dstSize);
+        else
+        {
+            buf = Buffer(m_bufSize);
+            dst = buf.getData();
+            dstSize = buf.getSize();
+        }
+
+        spinUntilReadable(m_busyPoll, acceptedSocket.m_bSocket);
+        bool recvSuccess;
+        int nBytes;
+    #ifdef GNET_OS_LINUX
+        if (m_zeroCopy)
+        {
+            bool wouldBlock;
+            nBytes = recvOrZeroCopyCompletion(acceptedSocket.m_bSocket, dst, dstSize, &wouldBlock);
+            completeZeroCopy(acceptedSocket);
+            if (wouldBlock) continue;
+            recvSuccess = nBytes > 0;
+        }
+        else
+    #endif
+        nBytes = acceptedSocket.receive(dst, dstSize, &recvSuccess);
+        if (!recvSuccess || nBytes == 0)
+        {
+            // client disconnected (0 is an orderly shutdown); on close, the server tears its clients down itself
+            if (m_open)
+            {
+                removeClient(shard, acceptedSocket.getAddress(), strand.get());
+                acceptedSocket.close();
+            }
+            break;
+        }
+
+        if (!m_framed)
+        {
+            deliver(strand.get(), buf, nBytes, acceptedSocket.getAddress());
+            continue;
+        }
+
+        const Address& clientAddr = acceptedSocket.getAddress();
+        if (!framer.commit(nBytes, m_maxMessageSize, [&](const Buffer& message) { deliver(strand.get(), message, message.getSize(), clientAddr); }))
+        {
+            err = "ServerTCP dropped client " + clientAddr.getHost() + ": message exceeds the maximum message size";
+            if (printErrors) std::cout << err << "\n";
+            if (m_open)
+            {
+                removeClient(shard, clientAddr, strand.get());
+                acceptedSocket.close();
+            }
+            break;
+        }
+    }
+
+    // this is the thread's last use of the shard, so the accepting thread can join it from now on;
+    // on close, the server joins every receiving thread itself, and one that closed the server from a callback must not touch the shard again
+    if (!m_open) return;
+    std::lock_guard<std::mutex> lock(shard->clientsMtx);
+    shard->finishedReceivings.push_back(std::this_thread::get_id());
+}
+
+void Garnet::ServerTCP::react(Reactor* reactor)
+{
+#ifdef GNET_OS_LINUX
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+
+    while (m_open)
+    {
+        int nEvents = 0;
+        if (!spinUntil(m_busyPoll, [&]() { return (nEvents = epoll_wait(reactor->epollFd, events, maxEvents, 0)) != 0; }))
+        {
+            nEvents = epoll_wait(reactor->epollFd, events, maxEvents, -1);
+        }
+        if (nEvents == -1)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < nEvents && m_open; i++)
+        {
+            if (events[i].data.ptr == nullptr)
+            {
+                uint64_t count;
+                read(reactor->wakeFd, &count, sizeof(count));
+
+                std::vector<std::shared_ptr<Connection>> adopted;
+                reactor->pendingMtx.lock();
+                adopted.swap(reactor->pending);
+                reactor->pendingMtx.unlock();
+
+                for (std::shared_ptr<Connection>& conn : adopted)
+                {
+                    // EPOLLOUT is edge-triggered too, so it only fires when a full send buffer frees up
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    ev.data.ptr = conn.get();
+                    if (epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, conn->socket.m_bSocket, &ev) == -1)
+                    {
+                        conn->close();
+                        continue;
+                    }
+
+                    adopt(reactor, conn);
+                }
+                continue;
+            }
+
+            // edge-triggered: drain the socket until it would block
+            Connection* conn = (Connection*)events[i].data.ptr;
+            if (m_zeroCopy && (events[i].events & EPOLLERR)) completeZeroCopy(conn->socket);
+            if (events[i].events & EPOLLOUT) flushWrites(conn);
+            if (!(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) continue;
+
+            bool disconnected = false;
+            while (m_open)
+            {
+                Buffer buf;
+                void* dst;
+                int dstSize;
+                if (m_framed) dst = conn->framer.prepareRead(m_bufSize, &dstSize);
+                else
+                {
+                    buf = Buffer(m_bufSize);
+                    dst = buf.getData();
+                    dstSize = buf.getSize();
+                }
+
+                int nBytes = ::recv(conn->socket.m_bSocket, dst, dstSize, 0);
+                if (nBytes > 0 && !m_framed)
+                {
+                    deliver(conn->strand.get(), buf, nBytes, conn->socket.getAddress());
+                    continue;
+                }
+                if (nBytes > 0)
+                {
+                    const Address& clientAddr = conn->socket.getAddress();
+                    auto onMessage = [&](const Buffer& message) { deliver(conn->strand.get(), message, message.getSize(), clientAddr); };
+                    if (conn->framer.commit(nBytes, m_maxMessageSize, onMessage)) continue;
+
+                    err = "ServerTCP dropped client " + clientAddr.getHost() + ": message exceeds the maximum message size";
+                    if (printErrors) std::cout << err << "\n";
+                    disconnected = true;
+                    break;
+                }
+
+                if (nBytes == -1 && errno == EINTR) continue;
+                if (nBytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                disconnected = true; // orderly shutdown (0) or error
+                break;
+            }
+
+            if (disconnected && m_open)
+            {
+                std::shared_ptr<Connection> owned = reactor->connections[conn];
+                epoll_ctl(reactor->epollFd, EPOLL_CTL_DEL, conn->socket.m_bSocket, nullptr);
+                reactor->connections.erase(conn);
+                removeClient(conn->shard, conn->socket.getAddress(), conn->strand.get());
+                conn->close();
+            }
+        }
+    }
+
+    if (reactor->tearDownOnExit)
+    {
+        reactor->close();
+        delete reactor;
+    }
+#endif
+}
+
+void Garnet::ServerTCP::adopt(Reactor* reactor, const std::shared_ptr<Connection>& conn)
+{
+    // an earlier connect callback may have closed the server, whose shards are gone by now
+    if (!m_open)
+    {
+        conn->close();
+        return;
+    }
+
+    reactor->connections.insert({ conn.get(), conn });
+    addClient(conn->shard, conn->socket, conn);
+
+    void (*connectCallback)(Address clientAddr) = m_pClientConnectCallback;
+    Address clientAddr = conn->socket.getAddress();
+    if (connectCallback != nullptr && conn->strand != nullptr) conn->strand->post([connectCallback, clientAddr]() { connectCallback(clientAddr); });
+    else if (connectCallback != nullptr) connectCallback(clientAddr);
+
+#ifdef GNET_IO_URING
+    // a ring only starts receiving after the connect callback, so that the callback always comes first
+    if (reactor->ring == nullptr) return;
+
+    int clientSocket = conn->socket.m_bSocket;
+    bool armed = reactor->ring->prepareReceive(clientSocket, (uint64_t)(uintptr_t)conn.get() | ringReceive);
+    if (armed) conn->nOps++;
+    if (armed && m_zeroCopy)
+    {
+        armed = reactor->ring->preparePoll(clientSocket, POLLERR, (uint64_t)(uintptr_t)conn.get() | ringPoll);
+        if (armed) conn->nOps++;
+    }
+    if (armed) return;
+
+    disconnectRing(reactor, conn.get());
+    if (conn->nOps == 0)
+    {
+        conn->close();
+        reactor->connections.erase(conn.get());
+    }
+#endif
+}
+
+void Garnet::ServerTCP::reactRing(Reactor* reactor)
+{
+#ifdef GNET_IO_URING
+    IOUring* ring = reactor->ring;
+    ring->prepareWake(ringWake);
+    for (Shard* shard : reactor->shards) ring->prepareAccept(shard->socket.m_bSocket, (uint64_t)(uintptr_t)shard | ringAccept);
+
+    auto onCompletion = [&](const io_uring_cqe& cqe)
+    {
+        uint64_t op = cqe.user_data & ringOpMask;
+        void* target = (void*)(uintptr_t)(cqe.user_data & ~ringOpMask);
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if (op == ringWake)
+        {
+            if (!m_open) return;
+
+            std::vector<std::shared_ptr<Connection>> adopted, flushed;
+            reactor->pendingMtx.lock();
+            adopted.swap(reactor->pending);
+            flushed.swap(reactor->flushes);
+            reactor->pendingMtx.unlock();
+
+            for (std::shared_ptr<Connection>& conn : adopted) adopt(reactor, conn);
+            for (std::shared_ptr<Connection>& conn : flushed)
+            {
+                if (!conn->flushing && !conn->disconnecting) flushRing(reactor, conn.get());
+            }
+            ring->prepareWake(ringWake);
+            return;
+        }
+
+        if (op == ringAccept)
+        {
+            Shard* shard = (Shard*)target;
+            if (cqe.res >= 0 && m_open) acceptRing(reactor, shard, cqe.res);
+            else if (cqe.res >= 0) ::close(cqe.res);
+            if (!more && m_open) ring->prepareAccept(shard->socket.m_bSocket, cqe.user_data);
+            return;
+        }
+
+        if (op != ringReceive && op != ringSend && op != ringPoll) return; // a cancellation
+
+        Connection* conn = (Connection*)target;
+        if (!more) conn->nOps--;
+        bool live = m_open && !conn->disconnecting;
+
+        if (op == ringReceive)
+        {
+            const char* data = ring->getBuffer(cqe);
+            bool kept = data == nullptr || cqe.res <= 0 || !live || receiveRing(conn, data, cqe.res);
+            ring->recycleBuffer(cqe);
+
+            // the multishot receive stops when the ring runs out of buffers, which is the only case where the client is still there (0 is an orderly shutdown)
+            if (!kept) disconnectRing(reactor, conn);
+            else if (live && !more && (cqe.res > 0 || cqe.res == -ENOBUFS))
+            {
+                if (ring->prepareReceive(conn->socket.m_bSocket, cqe.user_data)) conn->nOps++;
+                else disconnectRing(reactor, conn);
+            }
+            else if (live && !more) disconnectRing(reactor, conn);
+        }
+        else if (op == ringSend)
+        {
+            conn->flushing = false;
+            if (cqe.res == -ENOBUFS && conn->sendingZeroCopy)
+            {
+                // out of optmem for pinned pages, so copy the rest instead
+                conn->writeMtx.lock();
+                conn->writeQueue.front().copyFallback = true;
+                conn->writeMtx.unlock();
+                if (live) flushRing(reactor, conn);
+            }
+            else if (cqe.res > 0)
+            {
+                conn->writeMtx.lock();
+                if (conn->sendingZeroCopy) conn->useZeroCopyId();
+                bool reachedLow = conn->consumeWrites(cqe.res, m_lowWatermark);
+                bool queued = !conn->writeQueue.empty();
+                bool zeroCopySent = conn->zeroCopySent;
+                conn->zeroCopySent = false;
+                conn->writeMtx.unlock();
+
+                if (zeroCopySent) completeZeroCopy(conn->socket);
+                if (reachedLow && m_pLowWatermarkCallback != nullptr) m_pLowWatermarkCallback(conn->socket.getAddress());
+                if (queued && live) flushRing(reactor, conn);
+            }
+            else if (live) disconnectRing(reactor, conn);
+        }
+        else if (live)
+        {
+            completeZeroCopy(conn->socket);
+            if (!more)
+            {
+                if (ring->preparePoll(conn->socket.m_bSocket, POLLERR, cqe.user_data)) conn->nOps++;
+                else disconnectRing(reactor, conn);
+            }
+        }
+
+        // once the kernel is done with a disconnected client, its descriptor can be closed and the connection released
+        if (conn->disconnecting && conn->nOps == 0)
+        {
+            conn->close();
+            reactor->connections.erase(conn);
+        }
+    };
+
+    while (m_open)
+    {
+        if (!ring->submit(1)) break;
+        ring->forEachCompletion(onCompletion);
+    }
+
+    // cancel whatever is still in flight and wait for it, so that the kernel is done with every connection and buffer before they are released
+    ring->prepareCancel(-1);
+    while (ring->getNumInFlight() > 0 && ring->submit(1)) ring->forEachCompletion(onCompletion);
+
+    if (reactor->tearDownOnExit)
+    {
+        reactor->close();
+        delete reactor;
+    }
+#endif
+}
+
+void Garnet::ServerTCP::acceptRing(Reactor* reactor, Shard* shard, int clientSocket)
+{
+#ifdef GNET_IO_URING
+    // the client socket stays blocking, so that the ring waits for it to be ready instead of completing with EAGAIN
+    Socket acceptedSocket;
+    acceptedSocket.m_bSocket = clientSocket;
+    acceptedSocket.m_proto = Protocol::TCP;
+    getpeername(clientSocket, (sockaddr*)&acceptedSocket.m_bAddr, &acceptedSocket.m_bAddrSize);
+    acceptedSocket.m_addr = addr_btog(acceptedSocket.m_bAddr);
+    if (m_zeroCopy) acceptedSocket.setZeroCopy(true);
+    acceptedSocket.setOptions(m_socketOptions);
+
+    Reactor* target = m_reactors[m_nextReactor++ % m_reactors.size()];
+    std::shared_ptr<Connection> conn = std::make_shared<Connection>();
+    conn->socket = acceptedSocket;
+    conn->shard = shard;
+    conn->reactor = target;
+    if (m_workers != nullptr) conn->strand = std::make_shared<Strand>(m_workers);
+
+    if (target == reactor)
+    {
+        adopt(reactor, conn);
+        return;
+    }
+
+    target->pendingMtx.lock();
+    target->pending.push_back(conn);
+    target->pendingMtx.unlock();
+    target->wake();
+#endif
+}
+
+bool Garnet::ServerTCP::receiveRing(Connection* conn, const void* data, int size)
+{
+    const Address& clientAddr = conn->socket.getAddress();
+    if (!m_framed)
+    {
+        // the provided buffer goes straight back to the ring, so the callback gets a pooled copy that it can keep
+        Buffer buf(std::max((int)m_bufSize, size));
+        memcpy(buf.getData(), data, size);
+        deliver(conn->strand.get(), buf, size, clientAddr);
+        return true;
+    }
+
+    auto onMessage = [&](const Buffer& message) { deliver(conn->strand.get(), message, message.getSize(), clientAddr); };
+    int pos = 0;
+    while (pos < size)
+    {
+        int dstSize;
+        void* dst = conn->framer.prepareRead(size - pos, &dstSize);
+        int nBytes = std::min(dstSize, size - pos);
+        memcpy(dst, (const char*)data + pos, nBytes);
+        pos += nBytes;
+        if (conn->framer.commit(nBytes, m_maxMessageSize, onMessage)) continue;
+
+        err = "ServerTCP dropped client " + clientAddr.getHost() + ": message exceeds the maximum message size";
+        if (printErrors) std::cout << err << "\n";
+        return false;
+    }
+    return true;
+}
+
+void Garnet::ServerTCP::flushRing(Reactor* reactor, Connection* conn)
+{
+#ifdef GNET_IO_URING
+    // the queued items stay put until the send completes, since only the ring pops them and other threads only append
+    int nIovs = 0;
+    conn->sendingZeroCopy = false;
+    conn->writeMtx.lock();
+    if (!conn->writeQueue.empty() && conn->writeQueue.front().fileDescriptor != -1 && !conn->readFileChunk())
+    {
+        conn->writeMtx.unlock();
+        return;
+    }
+    if (!conn->writeQueue.empty() && conn->writeQueue.front().zeroCopyData != nullptr)
+    {
+        WriteItem& item = conn->writeQueue.front();
+        conn->sendIovs[0].iov_base = (char*)item.zeroCopyData + conn->writeOffset;
+        conn->sendIovs[0].iov_len = item.size - conn->writeOffset;
+        conn->sendingZeroCopy = !item.copyFallback && item.size >= zeroCopyMinSize;
+        nIovs = 1;
+    }
+    else nIovs = conn->getWriteIovs(conn->sendIovs, sizeof(conn->sendIovs) / sizeof(conn->sendIovs[0]));
+    conn->writeMtx.unlock();
+    if (nIovs == 0) return;
+
+    conn->sendMsg = msghdr{};
+    conn->sendMsg.msg_iov = conn->sendIovs;
+    conn->sendMsg.msg_iovlen = nIovs;
+    int flags = MSG_NOSIGNAL | (conn->sendingZeroCopy ? MSG_ZEROCOPY : 0);
+    if (!reactor->ring->prepareSendMessage(conn->socket.m_bSocket, &conn->sendMsg, (uint64_t)(uintptr_t)conn | ringSend, flags))
+    {
+        disconnectRing(reactor, conn);
+        return;
+    }
+    conn->nOps++;
+    conn->flushing = true;
+#endif
+}
+
+void Garnet::ServerTCP::disconnectRing(Reactor* reactor, Connection* conn)
+{
+#ifdef GNET_IO_URING
+    if (conn->disconnecting) return;
+    conn->disconnecting = true;
+    removeClient(conn->shard, conn->socket.getAddress(), conn->strand.get());
+
+    // the descriptor stays open until every operation on it has completed, so that none of them can end up on a reused one
+    if (conn->nOps > 0) reactor->ring->prepareCancel(conn->socket.m_bSocket);
+#endif
+}
+
+Garnet::ServerUDP::ServerUDP()
+{
+    m_addr = Address();
+    m_bufSize = 256;
+    m_open = false;
+    m_gro = false;
+    m_batchSize = 32;
+    m_nWorkers = 0;
+    m_workers = nullptr;
+    m_ioUring = false;
+    m_ring = nullptr;
+    m_pBatchReceiveCallback = nullptr;
+    m_pReceiveCallback = nullptr;
+}
+
+Garnet::ServerUDP::ServerUDP(Address addr, bool* success)
+{
+    m_addr = addr;
+    bool successA, successB;
+    m_socket = Socket(Protocol::UDP, &successA);
+    m_socket.bind(addr, &successB);
+    m_bufSize = 256;
+    m_open = false;
+    m_gro = false;
+    m_batchSize = 32;
+    m_nWorkers = 0;
+    m_workers = nullptr;
+    m_ioUring = false;
+    m_ring = nullptr;
+    m_pBatchReceiveCallback = nullptr;
+    m_pReceiveCallback = nullptr;
+
+    if (success != nullptr) *success = successA && successB;
+}
+
+Garnet::ServerUDP::~ServerUDP()
+{
+    if (m_open) close();
+}
+
+void Garnet::ServerUDP::open(bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to open ServerUDP: already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (m_nWorkers > 0)
+    {
+        m_workers = new WorkerPool(m_nWorkers);
+        for (int i = 0; i < m_nWorkers * 16; i++) m_strands.push_back(std::make_shared<Strand>(m_workers));
+    }
+
+    if (m_ioUring)
+    {
+    #ifdef GNET_IO_URING
+        if (m_gro) err = "GRO is enabled";
+        else
+        {
+            // each datagram lands in a provided buffer behind the recvmsg header and the sender address
+            m_ring = new IOUring();
+            if (!m_ring->init(1024, 1024, (int)(sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in)) + std::max((int)m_bufSize, 1)))
+            {
+                delete m_ring;
+                m_ring = nullptr;
+            }
+        }
+    #else
+        err = "io_uring is not supported by the kernel headers Garnet was built with";
+    #endif
+        if (m_ring == nullptr)
+        {
+            err = "ServerUDP could not use io_uring, falling back to blocking receives: " + err;
+            if (printErrors) std::cout << err << "\n";
+            m_ioUring = false;
+        }
+    }
+
+    m_open = true;
+    if (m_ring != nullptr) m_receiving = std::thread(&Garnet::ServerUDP::receiveRing, this);
+    else m_receiving = std::thread(&Garnet::ServerUDP::receive, this);
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ServerUDP::send(void* data, int size, Address addr, bool* success)
+{
+    m_socket.sendTo(data, size, addr, success);
+}
+
+void Garnet::ServerUDP::send(void* data, int size, const Endpoint& endpoint, bool* success)
+{
+    m_socket.sendTo(data, size, endpoint, success);
+}
+
+void Garnet::ServerUDP::send(const Span* spans, int count, Address addr, bool* success)
+{
+    m_socket.sendTo(spans, count, addr, success);
+}
+
+void Garnet::ServerUDP::sendSegmented(void* data, int size, int segmentSize, Address addr, bool* success)
+{
+    m_socket.sendToSegmented(data, size, segmentSize, addr, success);
+}
+
+void Garnet::ServerUDP::sendBatch(const Datagram* datagrams, int count, bool* success)
+{
+    m_socket.sendBatch(datagrams, count, success);
+}
+
+void Garnet::ServerUDP::close(bool* success)
+{
+    if (!m_open)
+    {
+        err = "Failed to close ServerUDP: not open yet or already closed";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_open = false;
+    m_callbackMtx.lock();
+    m_callbackMtx.unlock();
+    m_callbackCv.notify_all();
+
+    // a ring that had to fall back to blocking receives is woken like one
+#ifdef GNET_IO_URING
+    if (m_ring != nullptr) m_ring->wake();
+#endif
+    m_socket.interrupt();
+    joinThread(m_receiving);
+#ifdef GNET_IO_URING
+    delete m_ring;
+#endif
+    m_ring = nullptr;
+
+    // the receiving thread is gone, so let the workers finish the callbacks it queued, which may still send on the socket
+    m_strands.clear();
+    WorkerPool::release(m_workers);
+    m_workers = nullptr;
+    m_socket.close();
+    if (success != nullptr) *success = true;
+}
+
+bool Garnet::ServerUDP::isOpen() const
+{
+    return m_open;
+}
+
+int Garnet::ServerUDP::getBufferSize() const
+{
+    return m_bufSize;
+}
+
+void Garnet::ServerUDP::setBufferSize(int size)
+{
+    m_bufSize = size;
+}
+
+void Garnet::ServerUDP::setGROEnabled(bool enabled, bool* success)
+{
+    if (enabled && m_ring != nullptr)
+    {
+        err = "Failed to enable ServerUDP GRO: the server receives through io_uring";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    bool successA;
+    m_socket.setGRO(enabled, &successA);
+    if (successA) m_gro = enabled;
+    if (success != nullptr) *success = successA;
+}
+
+void Garnet::ServerUDP::setSocketOptions(const SocketOptions& options, bool* success)
+{
+    m_socket.setOptions(options, success);
+}
+
+void Garnet::ServerUDP::setBusyPoll(int spinMicroseconds, bool* success)
+{
+    m_busyPoll.spinMicroseconds = std::max(spinMicroseconds, 0);
+    m_socket.setBusyPoll(spinMicroseconds, success);
+}
+
+Garnet::BusyPollStats Garnet::ServerUDP::getBusyPollStats() const
+{
+    return ::getBusyPollStats(m_busyPoll);
+}
+
+void Garnet::ServerUDP::setIOUringEnabled(bool enabled, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerUDP io_uring: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+#ifndef GNET_OS_LINUX
+    if (enabled)
+    {
+        err = "Failed to set ServerUDP io_uring: io_uring is only supported on Linux";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+#endif
+
+    m_ioUring = enabled;
+    if (success != nullptr) *success = true;
+}
+
+bool Garnet::ServerUDP::isIOUringEnabled() const
+{
+    return m_ioUring;
+}
+
+void Garnet::ServerUDP::setNumWorkerThreads(int nThreads, bool* success)
+{
+    if (m_open)
+    {
+        err = "Failed to set ServerUDP worker threads: server is already open";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (nThreads < 0)
+    {
+        err = "Failed to set ServerUDP worker threads: number of threads must not be negative";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_nWorkers = nThreads;
+    if (success != nullptr) *success = true;
+}
+
+int Garnet::ServerUDP::getNumWorkerThreads() const
+{
+    return m_nWorkers;
+}
+
+Garnet::Strand* Garnet::ServerUDP::getStrand(const Address& clientAddr) const
+{
+    if (m_strands.empty()) return nullptr;
+    return m_strands[std::hash<Address>()(clientAddr) % m_strands.size()].get();
+}
+
+void Garnet::ServerUDP::setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize, Address fromAddr))
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_pReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ServerUDP::setBatchReceiveCallback(void (*callback)(const Datagram* datagrams, int count), int batchSize)
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_batchSize = std::max(1, batchSize);
+    m_pBatchReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ServerUDP::receive()
+{
+    std::vector<Datagram> batch;
+    while (m_open)
+    {
+        void (*batchCallback)(const Datagram* datagrams, int count) = m_pBatchReceiveCallback;
+        if (batchCallback != nullptr)
+        {
+            if ((int)batch.size() != m_batchSize) batch.resize(m_batchSize);
+
+            spinUntilReadable(m_busyPoll, m_socket.m_bSocket);
+            if (m_gro)
+            {
+                receiveCoalescedBatch(batchCallback, batch);
+                continue;
+            }
+
+            bool recvSuccess;
+            int nDatagrams = m_socket.receiveBatch(batch.data(), (int)batch.size(), m_bufSize, &recvSuccess);
+            if (!recvSuccess) continue;
+
+            deliverBatch(batchCallback, batch.data(), nDatagrams);
+            for (int i = 0; i < nDatagrams; i++) batch[i].buffer.release();
+            continue;
+        }
+
+        void (*callback)(const Buffer& buffer, int actualSize, Address fromAddr) = m_pReceiveCallback;
+        if (callback == nullptr)
+        {
+            // leave the datagrams in the socket until there is a callback for them
+            std::unique_lock<std::mutex> lock(m_callbackMtx);
+            m_callbackCv.wait(lock, [this]() { return m_pReceiveCallback != nullptr || m_pBatchReceiveCallback != nullptr || !m_open; });
+            continue;
+        }
+
+        spinUntilReadable(m_busyPoll, m_socket.m_bSocket);
+        bool recvSuccess;
+        Address from;
+
+        if (m_gro)
+        {
+            // a coalesced burst can be up to 64 KB, so read into a buffer that can hold one and hand out a slice per datagram
+            int segmentSize;
+            Buffer burst(std::max((int)m_bufSize, 65536));
+            int nBytes = m_socket.receiveFromCoalesced(burst.getData(), burst.getSize(), &from, &segmentSize, &recvSuccess);
+            if (!recvSuccess) continue;
+            if (segmentSize <= 0) segmentSize = std::max(nBytes, 1);
+
+            // a burst only ever holds datagrams from one sender, so it is handed to a worker as a whole
+            auto split = [callback, burst, nBytes, segmentSize, from]()
+            {
+                int offset = 0;
+                do
+                {
+                    int size = std::min(segmentSize, nBytes - offset);
+                    callback(burst.slice(offset, size), size, from);
+                    offset += size;
+                } while (offset < nBytes);
+            };
+            Strand* strand = getStrand(from);
+            if (strand != nullptr) strand->post(split);
+            else split();
+            continue;
+        }
+
+        Buffer buf(m_bufSize);
+        int nBytes = m_socket.receiveFrom(buf.getData(), buf.getSize(), &from, &recvSuccess);
+        if (!recvSuccess) continue;
+
+        Strand* strand = getStrand(from);
+        if (strand != nullptr) strand->post([callback, buf, nBytes, from]() { callback(buf, nBytes, from); });
+        else callback(buf, nBytes, from);
+    }
+}
+
+void Garnet::ServerUDP::receiveCoalescedBatch(void (*callback)(const Datagram* datagrams, int count), std::vector<Datagram>& batch)
+{
+    // recvmmsg() slots would cut a coalesced burst off at the buffer size, so read one burst and split it into a datagram per segment instead
+    int segmentSize;
+    bool recvSuccess;
+    Address from;
+    Buffer burst(std::max((int)m_bufSize, 65536));
+    int nBytes = m_socket.receiveFromCoalesced(burst.getData(), burst.getSize(), &from, &segmentSize, &recvSuccess);
+    if (!recvSuccess || !m_open) return; // the empty read that wakes the thread on close
+    if (segmentSize <= 0) segmentSize = std::max(nBytes, 1);
+
+    int nDatagrams = 0;
+    int offset = 0;
+    do
+    {
+        Datagram& datagram = batch[nDatagrams++];
+        datagram.size = std::min(segmentSize, nBytes - offset);
+        datagram.buffer = burst.slice(offset, datagram.size);
+        datagram.data = datagram.buffer.getData();
+        datagram.address = from;
+        offset += datagram.size;
+
+        // a burst can hold more segments than fit in one batch
+        if (nDatagrams == (int)batch.size() || offset >= nBytes)
+        {
+            deliverBatch(callback, batch.data(), nDatagrams);
+            for (int i = 0; i < nDatagrams; i++) batch[i].buffer.release();
+            nDatagrams = 0;
+        }
+    } while (offset < nBytes);
+}
+
+void Garnet::ServerUDP::deliverBatch(void (*callback)(const Datagram* datagrams, int count), const Datagram* datagrams, int count)
+{
+    if (m_strands.empty())
+    {
+        callback(datagrams, count);
+        return;
+    }
+
+    // split the batch up by strand, keeping each client's datagrams together and in order
+    std::unordered_map<Strand*, std::vector<Datagram>> groups;
+    for (int i = 0; i < count; i++) groups[getStrand(datagrams[i].address)].push_back(datagrams[i]);
+    for (auto& group : groups)
+    {
+        std::vector<Datagram> grouped = std::move(group.second);
+        group.first->post([callback, grouped]() { callback(grouped.data(), (int)grouped.size()); });
+    }
+}
+
+void Garnet::ServerUDP::receiveRing()
+{
+#ifdef GNET_IO_URING
+    const uint64_t wakeOp = 1;
+    const uint64_t receiveOp = 2;
+    IOUring* ring = m_ring;
+    int fd = m_socket.m_bSocket;
+
+    // only tells the multishot recvmsg how much room to leave for the sender address in front of each datagram
+    msghdr msg{};
+    msg.msg_namelen = sizeof(sockaddr_in);
+
+    ring->prepareWake(wakeOp);
+    ring->prepareReceiveMessage(fd, &msg, receiveOp);
+
+    std::vector<Datagram> received;
+    bool receiving = true;
+    auto onCompletion = [&](const io_uring_cqe& cqe)
+    {
+        if (cqe.user_data == wakeOp && m_open) ring->prepareWake(wakeOp);
+        if (cqe.user_data != receiveOp) return;
+
+        const char* data = ring->getBuffer(cqe);
+        if (data != nullptr && cqe.res > 0 && m_open)
+        {
+            const io_uring_recvmsg_out* out = (const io_uring_recvmsg_out*)data;
+            int offset = (int)(sizeof(io_uring_recvmsg_out) + msg.msg_namelen + msg.msg_controllen);
+            int size = std::max(0, std::min((int)out->payloadlen, cqe.res - offset));
+
+            sockaddr_in from{};
+            memcpy(&from, data + sizeof(io_uring_recvmsg_out), std::min((size_t)out->namelen, sizeof(from)));
+
+            Datagram datagram;
+            datagram.buffer = Buffer(std::max((int)m_bufSize, size));
+            memcpy(datagram.buffer.getData(), data + offset, size);
+            datagram.data = datagram.buffer.getData();
+            datagram.size = size;
+            datagram.address = addr_btog(from);
+            received.push_back(std::move(datagram));
+        }
+        ring->recycleBuffer(cqe);
+        if ((cqe.flags & IORING_CQE_F_MORE) || !m_open) return;
+
+        // the multishot receive stops when the ring runs out of buffers, or on a reported error such as an ICMP port unreachable;
+        // one that says the socket cannot be received from like this sends the thread back to blocking receives
+        if (cqe.res == -EINVAL || cqe.res == -EBADF || cqe.res == -ENOTSOCK || cqe.res == -EOPNOTSUPP || !ring->prepareReceiveMessage(fd, &msg, receiveOp))
+        {
+            err = "ServerUDP stopped receiving through io_uring, falling back to blocking receives. Error: " + std::string(strerror(-cqe.res));
+            if (printErrors) std::cout << err << "\n";
+            receiving = false;
+        }
+    };
+
+    while (m_open && receiving)
+    {
+        if (!ring->submit(1)) break;
+        ring->forEachCompletion(onCompletion);
+        if (received.empty()) continue;
+
+        void (*batchCallback)(const Datagram* datagrams, int count) = m_pBatchReceiveCallback;
+        void (*callback)(const Buffer& buffer, int actualSize, Address fromAddr) = m_pReceiveCallback;
+        if (batchCallback == nullptr && callback == nullptr)
+        {
+            // hold on to the datagrams until there is a callback for them; the socket keeps the rest once the ring's buffers run out
+            std::unique_lock<std::mutex> lock(m_callbackMtx);
+            m_callbackCv.wait(lock, [this]() { return m_pReceiveCallback != nullptr || m_pBatchReceiveCallback != nullptr || !m_open; });
+            batchCallback = m_pBatchReceiveCallback;
+            callback = m_pReceiveCallback;
+        }
+
+        if (batchCallback != nullptr)
+        {
+            int batchSize = m_batchSize;
+            for (int i = 0; i < (int)received.size(); i += batchSize) deliverBatch(batchCallback, &received[i], std::min(batchSize, (int)received.size() - i));
+        }
+        else if (callback != nullptr)
+        {
+            for (Datagram& datagram : received)
+            {
+                Buffer buf = datagram.buffer;
+                int nBytes = datagram.size;
+                Address from = datagram.address;
+                Strand* strand = getStrand(from);
+                if (strand != nullptr) strand->post([callback, buf, nBytes, from]() { callback(buf, nBytes, from); });
+                else callback(buf, nBytes, from);
+            }
+        }
+        received.clear();
+    }
+
+    // cancel whatever is still in flight and wait for it, so that the kernel is done with the buffers before they are released
+    ring->prepareCancel(-1);
+    while (ring->getNumInFlight() > 0 && ring->submit(1)) ring->forEachCompletion(onCompletion);
+
+    if (m_open) receive();
+#endif
+}
+
+Garnet::ClientTCP::ClientTCP()
+{
+    m_bufSize = 256;
+    m_pReceiveCallback = nullptr;
+    m_zeroCopy = false;
+    m_pZeroCopyCallback = nullptr;
+    m_framed = false;
+    m_maxMessageSize = 16 * 1024 * 1024;
+    m_connected = false;
+    m_pClientReceiveCallback = nullptr;
+    m_pReceiveEndedCallback = nullptr;
+    m_receiveEnded = false;
+    m_poolEntry = nullptr;
+    m_userPtr = nullptr;
+}
+
+Garnet::ClientTCP::ClientTCP(char dummy, bool* success)
+{
+    m_bufSize = 256;
+    m_pReceiveCallback = nullptr;
+    m_zeroCopy = false;
+    m_pZeroCopyCallback = nullptr;
+    m_framed = false;
+    m_maxMessageSize = 16 * 1024 * 1024;
+    m_connected = false;
+    m_pClientReceiveCallback = nullptr;
+    m_pReceiveEndedCallback = nullptr;
+    m_receiveEnded = false;
+    m_poolEntry = nullptr;
+    m_userPtr = nullptr;
+    m_socket = Socket(Protocol::TCP, success);
+}
+
+Garnet::ClientTCP::~ClientTCP()
+{
+    if (m_connected) disconnect();
+}
+
+void Garnet::ClientTCP::connect(Address serverAddr, bool* success)
+{
+    if (m_connected)
+    {
+        err = "Failed to connect ClientTCP: already connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    bool successA;
+    m_socket.connect(serverAddr, &successA);
+    if (successA)
+    {
+        if (success != nullptr) *success = true;
+    }
+    else
+    {
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    onConnected();
+}
+
+void Garnet::ClientTCP::onConnected()
+{
+    m_receiveEnded = false;
+    m_connected = true;
+    m_receiving = std::thread(&Garnet::ClientTCP::receive, this);
+}
+
+void Garnet::ClientTCP::resetSocket()
+{
+    m_socket.close();
+    createSocket();
+}
+
+void Garnet::ClientTCP::createSocket()
+{
+    m_socket = Socket(Protocol::TCP);
+    if (m_zeroCopy) m_socket.setZeroCopy(true);
+    m_socket.setOptions(m_socketOptions);
+    if (m_busyPoll.spinMicroseconds > 0) m_socket.setBusyPoll(m_busyPoll.spinMicroseconds);
+}
+
+void Garnet::ClientTCP::connect(Address serverAddr, int timeoutMs, bool* success)
+{
+    if (m_connected)
+    {
+        err = "Failed to connect ClientTCP: already connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    bool successA;
+    m_socket.connect(serverAddr, timeoutMs, &successA);
+    if (!successA)
+    {
+        resetSocket();
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    onConnected();
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ClientTCP::connect(const std::string& host, ushort port, int timeoutMs, bool* success)
+{
+    if (m_connected)
+    {
+        err = "Failed to connect ClientTCP: already connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    std::vector<Address> addresses;
+    unsigned char numeric[16];
+    if (inet_pton(AF_INET, host.c_str(), numeric) == 1 || inet_pton(AF_INET6, host.c_str(), numeric) == 1) addresses.push_back(Address(host, port));
+    else
+    {
+        bool resolved;
+        addresses = Resolver::getDefault().resolve(host, &resolved);
+        if (!resolved)
+        {
+            if (success != nullptr) *success = false;
+            return;
+        }
+        for (Address& address : addresses) address.port = port;
+    }
+
+    // the first attempt uses our own socket, later ones get a fresh socket each
+    const auto attemptDelay = std::chrono::milliseconds(250); // RFC 8305's recommended "Connection Attempt Delay"
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    int nAddresses = (int)addresses.size();
+    std::vector<Socket> attempts;
+    attempts.reserve(nAddresses);
+    std::vector<Socket*> sockets(nAddresses);
+    std::unique_ptr<bool[]> pending(new bool[nAddresses]());
+    std::unique_ptr<bool[]> connected(new bool[nAddresses]());
+    auto nextAttempt = std::chrono::steady_clock::now();
+    int winner = -1;
+    int nPending = 0;
+    while (winner == -1)
+    {
+        int next = (int)attempts.size();
+        if (next < nAddresses && (nPending == 0 || std::chrono::steady_clock::now() >= nextAttempt))
+        {
+            if (next == 0) attempts.push_back(m_socket);
+            else
+            {
+                attempts.push_back(Socket(Protocol::TCP));
+                if (m_zeroCopy) attempts.back().setZeroCopy(true);
+                attempts.back().setOptions(m_socketOptions);
+                if (m_busyPoll.spinMicroseconds > 0) attempts.back().setBusyPoll(m_busyPoll.spinMicroseconds);
+            }
+            sockets[next] = &attempts.back();
+            connected[next] = sockets[next]->beginConnect(addresses[next], &pending[next]);
+            if (connected[next]) winner = next;
+            if (pending[next]) nPending++;
+            nextAttempt = std::chrono::steady_clock::now() + attemptDelay;
+            continue;
+        }
+        if (nPending == 0) break; // every address failed
+
+        int remaining = getRemainingMs(deadline, timeoutMs >= 0);
+        if (remaining == 0) break;
+        if (next < nAddresses)
+        {
+            auto untilNext = std::chrono::duration_cast<std::chrono::milliseconds>(nextAttempt - std::chrono::steady_clock::now()).count();
+            if (remaining == -1 || untilNext < remaining) remaining = (int)std::max<long long>(untilNext, 0);
+        }
+
+        int nFinished = Socket::finishConnects(sockets.data(), next, pending.get(), connected.get(), remaining);
+        nPending -= nFinished;
+        for (int i = 0; i < next && winner == -1; i++) if (connected[i]) winner = i;
+
+        // a failed attempt makes way for the next address right away
+        if (nFinished > 0 && winner == -1) nextAttempt = std::chrono::steady_clock::now();
+    }
+
+    // abandon the attempts that lost the race (or all of them)
+    for (int i = 1; i < (int)attempts.size(); i++) if (i != winner) attempts[i].close();
+    if (winner == -1)
+    {
+        if (nPending > 0)
+        {
+            err = "Failed to connect ClientTCP: timed out after " + std::to_string(timeoutMs) + " ms";
+            if (printErrors) std::cout << err << "\n";
+        }
+        resetSocket();
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (winner != 0)
+    {
+        m_socket.close();
+        m_socket = attempts[winner];
+    }
+    onConnected();
+    if (success != nullptr) *success = true;
+}
+
+int Garnet::ClientTCP::connectMany(ClientTCP* const* clients, int count, Address serverAddr, int timeoutMs, bool* results)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::vector<Socket*> sockets(count);
+    std::unique_ptr<bool[]> pending(new bool[count]());
+    std::unique_ptr<bool[]> connected(new bool[count]());
+    std::unique_ptr<bool[]> started(new bool[count]());
+    int nPending = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sockets[i] = &clients[i]->m_socket;
+        if (clients[i]->m_connected)
+        {
+            err = "Failed to connect ClientTCP: already connected";
+            if (printErrors) std::cout << err << "\n";
+            continue;
+        }
+
+        started[i] = true;
+        connected[i] = sockets[i]->beginConnect(serverAddr, &pending[i]);
+        if (pending[i]) nPending++;
+    }
+
+    while (nPending > 0)
+    {
+        int remaining = getRemainingMs(deadline, timeoutMs >= 0);
+        if (remaining == 0)
+        {
+            err = "connectMany failed: " + std::to_string(nPending) + " connections timed out after " + std::to_string(timeoutMs) + " ms";
+            if (printErrors) std::cout << err << "\n";
+            break;
+        }
+        nPending -= Socket::finishConnects(sockets.data(), count, pending.get(), connected.get(), remaining);
+    }
+
+    int nConnected = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (connected[i])
+        {
+            clients[i]->onConnected();
+            nConnected++;
+        }
+        else if (started[i]) clients[i]->resetSocket();
+        if (results != nullptr) results[i] = connected[i];
+    }
+    return nConnected;
+}
+
+void Garnet::ClientTCP::send(void* data, int size, bool* success)
+{
+    if (!m_framed)
+    {
+        m_socket.send(data, size, success);
+        return;
+    }
+
+    Span span;
+    span.data = data;
+    span.size = size;
+    send(&span, 1, success);
+}
+
+void Garnet::ClientTCP::send(const Span* spans, int count, bool* success)
+{
+    FramedSpans framed(spans, count, m_framed);
+    m_socket.sendv(framed.get(), framed.getCount(), success);
+}
+
+unsigned int Garnet::ClientTCP::sendZeroCopy(void* data, int size, bool* success)
+{
+    unsigned int token = 0;
+    m_socket.sendZeroCopy(data, size, &token, success);
+
+    // small sends complete immediately, so report them without waiting for the next error queue wakeup
+    if (m_zeroCopy) completeZeroCopy();
+    return token;
+}
+
+void Garnet::ClientTCP::disconnect(bool* success)
+{
+    if (!m_connected)
+    {
+        err = "Failed to disconnect ClientTCP: not connected yet or already disconnected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+    
+    m_connected = false;
+    m_callbackMtx.lock();
+    m_callbackMtx.unlock();
+    m_callbackCv.notify_all();
+
+    m_socket.interrupt();
+    joinThread(m_receiving);
+    m_socket.close();
+    if (success != nullptr) *success = true;
+}
+
+bool Garnet::ClientTCP::isConnected() const
+{
+    return m_connected;
+}
+
+int Garnet::ClientTCP::getBufferSize() const
+{
+    return m_bufSize;
+}
+
+void Garnet::ClientTCP::setBufferSize(int bufferSize)
+{
+    m_bufSize = bufferSize;
+}
+
+void Garnet::ClientTCP::setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize))
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_pReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ClientTCP::setClientReceiveCallback(void (*callback)(ClientTCP& client, const Buffer& buffer, int actualSize))
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_pClientReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ClientTCP::setUserPtr(void* ptr)
+{
+    m_userPtr = ptr;
+}
+
+void* Garnet::ClientTCP::getUserPtr() const
+{
+    return m_userPtr;
+}
+
+void Garnet::ClientTCP::setZeroCopyEnabled(bool enabled, bool* success)
+{
+    bool zeroCopySuccess;
+    m_socket.setZeroCopy(enabled, &zeroCopySuccess);
+    if (zeroCopySuccess) m_zeroCopy = enabled;
+    if (success != nullptr) *success = zeroCopySuccess;
+}
+
+void Garnet::ClientTCP::setSocketOptions(const SocketOptions& options, bool* success)
+{
+    m_socketOptions = options;
+    m_socket.setOptions(options, success);
+}
+
+void Garnet::ClientTCP::setBusyPoll(int spinMicroseconds, bool* success)
+{
+    m_busyPoll.spinMicroseconds = std::max(spinMicroseconds, 0);
+    m_socket.setBusyPoll(spinMicroseconds, success);
+}
+
+Garnet::BusyPollStats Garnet::ClientTCP::getBusyPollStats() const
+{
+    return ::getBusyPollStats(m_busyPoll);
+}
+
+void Garnet::ClientTCP::setFramingEnabled(bool enabled, int maxMessageSize, bool* success)
+{
+    if (m_connected)
+    {
+        err = "Failed to set ClientTCP framing: already connected";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    if (maxMessageSize < 0)
+    {
+        err = "Failed to set ClientTCP framing: maximum message size must not be negative";
+        if (printErrors) std::cout << err << "\n";
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_framed = enabled;
+    m_maxMessageSize = maxMessageSize;
+    if (success != nullptr) *success = true;
+}
+
+void Garnet::ClientTCP::setZeroCopyCallback(void (*callback)(unsigned int token))
+{
+    m_pZeroCopyCallback = callback;
+}
+
+void Garnet::ClientTCP::completeZeroCopy()
+{
+    const int maxTokens = 64;
+    unsigned int tokens[maxTokens];
+    int nTokens;
+    do
+    {
+        nTokens = m_socket.getZeroCopyCompletions(tokens, maxTokens);
+        for (int i = 0; i < nTokens; i++)
+        {
+            if (m_pZeroCopyCallback != nullptr) m_pZeroCopyCallback(tokens[i]);
+        }
+    } while (nTokens == maxTokens);
+}
+
+void Garnet::ClientTCP::receive()
+{
+    auto deliver = [this](const Buffer& buffer, int actualSize)
+    {
+        if (m_pClientReceiveCallback != nullptr) m_pClientReceiveCallback(*this, buffer, actualSize);
+        else m_pReceiveCallback(buffer, actualSize);
+    };
+
+    MessageFramer framer;
+    while (m_connected)
+    {
+        if (m_pReceiveCallback == nullptr && m_pClientReceiveCallback == nullptr)
+        {
+            // leave the data in the socket until there is a callback for it
+            std::unique_lock<std::mutex> lock(m_callbackMtx);
+            m_callbackCv.wait(lock, [this]() { return m_pReceiveCallback != nullptr || m_pClientReceiveCallback != nullptr || !m_connected; });
+            continue;
+        }
+
+        Buffer buf;
+        void* dst;
+        int dstSize;
+        if (m_framed) dst = framer.prepareRead(m_bufSize, &dstSize);
+        else
+        {
+            buf = Buffer(m_bufSize);
+            dst = buf.getData();
+            dstSize = buf.getSize();
+        }
+
+        spinUntilReadable(m_busyPoll, m_socket.m_bSocket);
+        bool recvSuccess;
+        int nBytes;
+    #ifdef GNET_OS_LINUX
+        if (m_zeroCopy)
+        {
+            bool wouldBlock;
+            nBytes = recvOrZeroCopyCompletion(m_socket.m_bSocket, dst, dstSize, &wouldBlock);
+            completeZeroCopy();
+            if (wouldBlock) continue;
+            recvSuccess = nBytes > 0;
+        }
+        else
+    #endif
+        nBytes = m_socket.receive(dst, dstSize, &recvSuccess);
+        if (!recvSuccess || nBytes == 0) break; // the stream is over (or the client is disconnecting), and with it any partial message
+
+        if (!m_framed)
+        {
+            deliver(buf, nBytes);
+            continue;
+        }
+
+        if (!framer.commit(nBytes, m_maxMessageSize, [&](const Buffer& message) { deliver(message, message.getSize()); }))
+        {
+            err = "ClientTCP shut down the connection: message exceeds the maximum message size";
+            if (printErrors) std::cout << err << "\n";
+            m_socket.shutdown();
+            break;
+        }
+    }
+    m_receiveEnded = true;
+    if (m_pReceiveEndedCallback != nullptr) m_pReceiveEndedCallback(*this);
+}
+
+struct Garnet::ClientTCPPool::Entry
+{
+    struct Idle
+    {
+        ClientTCP* client;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    Address address;
+    std::mutex mtx;
+    std::condition_variable returned;
+    std::vector<Idle> idle; // a stack, so that the warmest connection is reused first and the coldest ones age out
+    int nOpen = 0;          // idle, checked out or connecting
+};
+
+Garnet::ClientTCPPool::ClientTCPPool(int minSize, int maxSize)
+{
+    m_minSize = std::max(minSize, 0);
+    m_maxSize = std::max(maxSize, std::max(m_minSize, 1));
+    m_connectTimeout = 5000;
+    m_idleTimeout = 60000;
+    m_healthCheckInterval = 5000;
+    m_pClientSetup = nullptr;
+    m_closing = false;
+    m_checking = std::thread(&Garnet::ClientTCPPool::checkHealth, this);
+}
+
+Garnet::ClientTCPPool::~ClientTCPPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_checkingMtx);
+        m_closing = true;
+    }
+    m_checkingCv.notify_all();
+    m_checking.join();
+
+    for (auto& pair : m_entries)
     {
-        m_accepting = std::thread(&Garnet::ServerTCP::accept, this);
+        for (Entry::Idle& idle : pair.second->idle)
+        {
+            idle.client->disconnect();
+            delete idle.client;
+        }
+        delete pair.second;
     }
-    else m_open = false;
 }
 
-void Garnet::ServerTCP::send(void* data, int size, Address clientAddr, bool* success)
+Garnet::ClientTCPPool::Entry* Garnet::ClientTCPPool::getEntry(Address serverAddr)
 {
-    m_clientMap[clientAddr].send(data, size, success);
+    {
+        std::shared_lock<std::shared_mutex> lock(m_entriesMtx);
+        auto it = m_entries.find(serverAddr);
+        if (it != m_entries.end()) return it->second;
+    }
+
+    std::lock_guard<std::shared_mutex> lock(m_entriesMtx);
+    Entry*& entry = m_entries[serverAddr];
+    if (entry == nullptr)
+    {
+        entry = new Entry();
+        entry->address = serverAddr;
+    }
+    return entry;
 }
 
-void Garnet::ServerTCP::close(bool* success)
+Garnet::ClientTCP* Garnet::ClientTCPPool::open(Entry* entry, bool* success)
 {
-    if (!m_open)
+    bool successA;
+    ClientTCP* client = new ClientTCP('c', &successA);
+    void (*setup)(ClientTCP& client) = m_pClientSetup;
+    if (successA && setup != nullptr) setup(*client);
+    if (successA) client->connect(entry->address, m_connectTimeout, &successA);
+    if (!successA)
     {
-        err = "Failed to close ServerTCP: not open yet or already closed";
-        if (printErrors) std::cout << err << "\n";
+        delete client;
+        entry->mtx.lock();
+        entry->nOpen--;
+        entry->mtx.unlock();
+        entry->returned.notify_one(); // someone waiting for a client may connect one of their own now
         if (success != nullptr) *success = false;
-        return;
+        return nullptr;
     }
 
-    m_socket.close();
-    for (Address& acceptedAddr : m_clientAddrs)
-    {
-        m_clientMap[acceptedAddr].close();
-    }
-    m_open = false;
-    m_accepting.detach();
-    for (std::thread& receiving : m_receivings) receiving.detach();
-    m_receivings.clear();
-    m_clientAddrsMtx.lock();
-    m_clientMapMtx.lock();
-    m_clientAddrs.clear();
-    m_clientMap.clear();
-    m_clientAddrsMtx.unlock();
-    m_clientMapMtx.unlock();
+    client->m_poolEntry = entry;
     if (success != nullptr) *success = true;
+    return client;
 }
 
-bool Garnet::ServerTCP::isOpen() const
+bool Garnet::ClientTCPPool::isHealthy(ClientTCP* client, bool pollSocket)
 {
-    return m_open;
+    if (!client->m_connected || client->m_receiveEnded) return false;
+    if (!pollSocket) return true;
+
+    SocketPollFd pfd{};
+    pfd.fd = client->m_socket.m_bSocket;
+#ifdef GNET_OS_LINUX
+    pfd.events = POLLRDHUP;
+    short hungUp = POLLRDHUP | POLLHUP | POLLERR;
+#else
+    pfd.events = 0;
+    short hungUp = POLLHUP | POLLERR;
+#endif
+    return pollSockets(&pfd, 1, 0) <= 0 || (pfd.revents & hungUp) == 0;
 }
 
-int Garnet::ServerTCP::getBufferSize() const
+void Garnet::ClientTCPPool::destroy(Entry* entry, ClientTCP* client)
 {
-    return m_bufSize;
+    if (client->isConnected()) client->disconnect();
+    delete client;
+    entry->returned.notify_one();
 }
 
-int Garnet::ServerTCP::getNumClients() const
+Garnet::ClientTCP* Garnet::ClientTCPPool::checkout(Address serverAddr, int timeoutMs, bool* success)
 {
-    return m_nClients;
+    Entry* entry = getEntry(serverAddr);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::unique_lock<std::mutex> lock(entry->mtx);
+    while (true)
+    {
+        while (!entry->idle.empty())
+        {
+            ClientTCP* client = entry->idle.back().client;
+            entry->idle.pop_back();
+            if (isHealthy(client, false))
+            {
+                if (success != nullptr) *success = true;
+                return client;
+            }
+
+            entry->nOpen--;
+            lock.unlock();
+            destroy(entry, client);
+            lock.lock();
+        }
+
+        if (entry->nOpen < m_maxSize)
+        {
+            entry->nOpen++;
+            lock.unlock();
+            return open(entry, success);
+        }
+
+        if (timeoutMs < 0) entry->returned.wait(lock);
+        else if (entry->returned.wait_until(lock, deadline) == std::cv_status::timeout && entry->idle.empty() && entry->nOpen >= m_maxSize)
+        {
+            err = "ClientTCPPool checkout failed: all " + std::to_string(m_maxSize) + " clients to " + serverAddr.getHost() + ":" + std::to_string(serverAddr.port) + " are in use";
+            if (printErrors) std::cout << err << "\n";
+            if (success != nullptr) *success = false;
+            return nullptr;
+        }
+    }
 }
 
-Garnet::Socket& Garnet::ServerTCP::getClientAcceptedSocket(Address clientAddr)
+void Garnet::ClientTCPPool::checkin(ClientTCP* client, bool reusable)
 {
-    return m_clientMap[clientAddr];
+    Entry* entry = (Entry*)client->m_poolEntry;
+    std::unique_lock<std::mutex> lock(entry->mtx);
+    if (!reusable || !isHealthy(client, false))
+    {
+        entry->nOpen--;
+        lock.unlock();
+        destroy(entry, client);
+        return;
+    }
+
+    entry->idle.push_back(Entry::Idle{ client, std::chrono::steady_clock::now() });
+    lock.unlock();
+    entry->returned.notify_one();
 }
 
-const std::list<Garnet::Address>& Garnet::ServerTCP::getClientAddresses() const
+void Garnet::ClientTCPPool::warmUp(Address serverAddr, bool* success)
 {
-    return m_clientAddrs;
+    Entry* entry = getEntry(serverAddr);
+    entry->mtx.lock();
+    int nMissing = std::max(m_minSize - entry->nOpen, 0);
+    entry->nOpen += nMissing;
+    entry->mtx.unlock();
+
+    std::vector<ClientTCP*> clients;
+    void (*setup)(ClientTCP& client) = m_pClientSetup;
+    for (int i = 0; i < nMissing; i++)
+    {
+        clients.push_back(new ClientTCP('c'));
+        if (setup != nullptr) setup(*clients.back());
+    }
+    std::unique_ptr<bool[]> connected(new bool[nMissing]());
+    int nConnected = ClientTCP::connectMany(clients.data(), nMissing, serverAddr, m_connectTimeout, connected.get());
+
+    auto now = std::chrono::steady_clock::now();
+    entry->mtx.lock();
+    for (int i = 0; i < nMissing; i++)
+    {
+        if (connected[i])
+        {
+            clients[i]->m_poolEntry = entry;
+            entry->idle.push_back(Entry::Idle{ clients[i], now });
+        }
+        else
+        {
+            entry->nOpen--;
+            delete clients[i];
+        }
+    }
+    entry->mtx.unlock();
+    entry->returned.notify_all();
+
+    if (success != nullptr) *success = nConnected == nMissing;
 }
 
-const std::unordered_map<Garnet::Address, Garnet::Socket>& Garnet::ServerTCP::getClientMap() const
+void Garnet::ClientTCPPool::setClientSetup(void (*setup)(ClientTCP& client))
 {
-    return m_clientMap;
+    m_pClientSetup = setup;
 }
 
-void Garnet::ServerTCP::setBufferSize(int size)
+void Garnet::ClientTCPPool::setConnectTimeout(int timeoutMs)
 {
-    m_bufSize = size;
+    m_connectTimeout = timeoutMs;
 }
 
-void Garnet::ServerTCP::setReceiveCallback(void(*callback)(void* buffer, int bufferSize, int actualSize, Address fromClientAddr))
+void Garnet::ClientTCPPool::setIdleTimeout(int timeoutMs)
 {
-    m_pReceiveCallback = callback;
+    m_idleTimeout = timeoutMs;
 }
 
-void Garnet::ServerTCP::setClientConnectCallback(void(*callback)(Address clientAddr))
+void Garnet::ClientTCPPool::setHealthCheckInterval(int intervalMs)
 {
-    m_pClientConnectCallback = callback;
+    m_healthCheckInterval = intervalMs;
+    m_checkingCv.notify_all();
 }
 
-void Garnet::ServerTCP::setClientDisconnectCallback(void(*callback)(Address clientAddr))
+int Garnet::ClientTCPPool::getNumIdle(Address serverAddr)
 {
-    m_pClientDisconnectCallback = callback;
+    Entry* entry = getEntry(serverAddr);
+    std::lock_guard<std::mutex> lock(entry->mtx);
+    return (int)entry->idle.size();
 }
 
-void Garnet::ServerTCP::accept()
+int Garnet::ClientTCPPool::getNumOpen(Address serverAddr)
 {
-    while (m_open)
+    Entry* entry = getEntry(serverAddr);
+    std::lock_guard<std::mutex> lock(entry->mtx);
+    return entry->nOpen;
+}
+
+void Garnet::ClientTCPPool::checkHealth()
+{
+    std::unique_lock<std::mutex> checkingLock(m_checkingMtx);
+    while (!m_closing)
     {
-        bool success;
-        Socket acceptedSocket;
+        m_checkingCv.wait_for(checkingLock, std::chrono::milliseconds(m_healthCheckInterval));
+        if (m_closing) break;
+        checkingLock.unlock();
 
-        bool prevPrintErrors = printErrors;
-        printErrors = false;
-        acceptedSocket = m_socket.accept(&success);
-        printErrors = prevPrintErrors;
-        if (!success) continue;
-        else
+        std::vector<Entry*> entries;
         {
-            m_clientAddrsMtx.lock();
-            m_clientMapMtx.lock();
-            m_clientAddrs.push_back(acceptedSocket.getAddress());
-            m_clientMap.insert({ acceptedSocket.getAddress(), acceptedSocket });
-            m_clientAddrsMtx.unlock();
-            m_clientMapMtx.unlock();
+            std::shared_lock<std::shared_mutex> lock(m_entriesMtx);
+            for (auto& pair : m_entries) entries.push_back(pair.second);
+        }
 
-            m_receivings.push_back(std::thread(&Garnet::ServerTCP::receive, this, acceptedSocket));
-            m_nClients = m_nClients + 1;
+        for (Entry* entry : entries)
+        {
+            // idle clients are ordered from the coldest, so the ones past the idle timeout are at the front
+            std::vector<ClientTCP*> evicted;
+            auto idleSince = std::chrono::steady_clock::now() - std::chrono::milliseconds(m_idleTimeout);
+            entry->mtx.lock();
+            for (size_t i = 0; i < entry->idle.size();)
+            {
+                ClientTCP* client = entry->idle[i].client;
+                bool expired = entry->idle[i].since < idleSince && entry->nOpen > m_minSize;
+                if (!expired && isHealthy(client, true))
+                {
+                    i++;
+                    continue;
+                }
+
+                evicted.push_back(client);
+                entry->idle.erase(entry->idle.begin() + i);
+                entry->nOpen--;
+            }
+            bool refill = entry->nOpen < m_minSize;
+            entry->mtx.unlock();
 
-            if (m_pClientConnectCallback != nullptr) m_pClientConnectCallback(acceptedSocket.getAddress());
+            for (ClientTCP* client : evicted) destroy(entry, client);
+            if (refill) warmUp(entry->address);
         }
+
+        checkingLock.lock();
     }
 }
 
-void Garnet::ServerTCP::receive(Socket acceptedSocket)
+struct Garnet::ClientRPC::State
 {
-    while (m_open)
+    typedef std::function<void(const Buffer& response, bool success)> Callback;
+    typedef std::pair<std::chrono::steady_clock::time_point, uint64_t> Deadline;
+
+    std::mutex mtx;
+    std::unordered_map<uint64_t, Callback> outstanding;
+    uint64_t nextID = 1;
+    bool open = false; // false once the receiving thread has stopped, so no request is left waiting for a response that cannot come
+    bool connectedBefore = false;
+    int maxResponseSize = 16 * 1024 * 1024;
+
+    // deadlines of answered requests are left in the queue and skipped once due, since the request IDs are never reused
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+    std::condition_variable deadlinesCv;
+    std::thread expiring;
+    bool closing = false;
+
+    std::mutex sendMtx; // keeps the messages of concurrent calls from interleaving
+
+    // removes a request and returns its callback, or an empty one if it was already answered or failed
+    Callback take(uint64_t id)
     {
-        if (m_pReceiveCallback == nullptr) continue;
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = outstanding.find(id);
+        if (it == outstanding.end()) return Callback();
+        Callback callback = std::move(it->second);
+        outstanding.erase(it);
+        return callback;
+    }
 
-        byte* buf = new byte[m_bufSize];
-        bool recvSuccess;
-        int nBytes = acceptedSocket.receive(buf, m_bufSize, &recvSuccess);
-        if (!recvSuccess)
+    // the timeout thread, started by the first call with a timeout: fails requests as their deadlines pass
+    void expire()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!closing)
         {
-            // client disconnected
-            m_clientAddrsMtx.lock();
-            m_clientMapMtx.lock();
-            m_clientAddrs.remove(acceptedSocket.getAddress());
-            m_clientMap.erase(acceptedSocket.getAddress());
-            m_clientAddrsMtx.unlock();
-            m_clientMapMtx.unlock();
-            m_nClients = m_nClients - 1;
+            if (deadlines.empty())
+            {
+                deadlinesCv.wait(lock);
+                continue;
+            }
 
-            if (m_pClientDisconnectCallback != nullptr) m_pClientDisconnectCallback(acceptedSocket.getAddress());
+            Deadline deadline = deadlines.top();
+            if (std::chrono::steady_clock::now() < deadline.first)
+            {
+                deadlinesCv.wait_until(lock, deadline.first);
+                continue;
+            }
+            deadlines.pop();
 
-            delete buf;
-            break;
+            auto it = outstanding.find(deadline.second);
+            if (it == outstanding.end()) continue;
+            Callback callback = std::move(it->second);
+            outstanding.erase(it);
+
+            lock.unlock();
+            err = "ClientRPC request timed out";
+            if (printErrors) std::cout << err << "\n";
+            callback(Buffer(), false);
+            lock.lock();
         }
+    }
+};
 
-        m_pReceiveCallback(buf, m_bufSize, nBytes, acceptedSocket.getAddress());
+static void writeRequestID(unsigned char* dst, uint64_t id)
+{
+    for (int i = Garnet::ClientRPC::HeaderSize - 1; i >= 0; i--)
+    {
+        dst[i] = (unsigned char)(id & 0xFF);
+        id >>= 8;
     }
 }
 
-Garnet::ServerUDP::ServerUDP()
+static uint64_t readRequestID(const unsigned char* src)
 {
-    m_addr.host = "";
-    m_addr.port = 0;
-    m_bufSize = 256;
-    m_open = false;
-    m_pReceiveCallback = nullptr;
+    uint64_t id = 0;
+    for (int i = 0; i < Garnet::ClientRPC::HeaderSize; i++) id = (id << 8) | src[i];
+    return id;
 }
 
-Garnet::ServerUDP::ServerUDP(Address addr, bool* success)
+Garnet::ClientRPC::ClientRPC(bool* success)
+    : m_client('c', success)
 {
-    m_addr = addr;
-    bool successA, successB;
-    m_socket = Socket(Protocol::UDP, &successA);
-    m_socket.bind(addr, &successB);
-    m_bufSize = 256;
-    m_open = false;
-    m_pReceiveCallback = nullptr;
-
-    if (success != nullptr) *success = successA && successB;
+    m_state = new State();
+    m_client.setUserPtr(this);
+    m_client.setBufferSize(16 * 1024); // pipelined responses arrive back to back, so read many of them at a time
+    m_client.setClientReceiveCallback(onResponse);
+    m_client.m_pReceiveEndedCallback = onReceiveEnded;
 }
 
-void Garnet::ServerUDP::open(bool* success)
+Garnet::ClientRPC::~ClientRPC()
 {
-    if (m_open)
+    if (m_client.m_connected) m_client.disconnect();
+
     {
-        err = "Failed to open ServerUDP: already open";
-        if (printErrors) std::cout << err << "\n";
-        if (success != nullptr) *success = false;
-        return;
+        std::lock_guard<std::mutex> lock(m_state->mtx);
+        m_state->closing = true;
     }
-
-    m_open = true;
-    m_receiving = std::thread(&Garnet::ServerUDP::receive, this);
-    if (success != nullptr) *success = true;
-}
-
-void Garnet::ServerUDP::send(void* data, int size, Address addr, bool* success)
-{
-    m_socket.sendTo(data, size, addr, success);
+    m_state->deadlinesCv.notify_all();
+    if (m_state->expiring.joinable()) m_state->expiring.join();
+    delete m_state;
 }
 
-void Garnet::ServerUDP::close(bool* success)
+void Garnet::ClientRPC::connect(Address serverAddr, int timeoutMs, bool* success)
 {
-    if (!m_open)
+    // after the server has closed the connection, the old receiving thread still has to be joined
+    if (m_client.m_connected && m_client.m_receiveEnded) m_client.disconnect();
+    if (m_client.m_connected)
     {
-        err = "Failed to close ServerUDP: not open yet or already closed";
+        err = "Failed to connect ClientRPC: already connected";
         if (printErrors) std::cout << err << "\n";
         if (success != nullptr) *success = false;
         return;
     }
 
-    m_socket.close();
-    m_open = false;
-    m_receiving.detach();
-    if (success != nullptr) *success = true;
-}
-
-bool Garnet::ServerUDP::isOpen() const
-{
-    return m_open;
-}
-
-int Garnet::ServerUDP::getBufferSize() const
-{
-    return m_bufSize;
-}
-
-void Garnet::ServerUDP::setBufferSize(int size)
-{
-    m_bufSize = size;
-}
+    // disconnect() closes the client's socket, so a reconnect needs a new one
+    if (m_state->connectedBefore) m_client.createSocket();
+    m_client.setFramingEnabled(true, m_state->maxResponseSize);
 
-void Garnet::ServerUDP::setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize, Address fromAddr))
-{
-    m_pReceiveCallback = callback;
-}
+    m_state->mtx.lock();
+    m_state->open = true;
+    m_state->mtx.unlock();
 
-void Garnet::ServerUDP::receive()
-{
-    while (m_open)
+    bool successA;
+    if (timeoutMs < 0) m_client.connect(serverAddr, &successA);
+    else m_client.connect(serverAddr, timeoutMs, &successA);
+    if (!successA)
     {
-        if (m_pReceiveCallback == nullptr) continue;
-
-        bool recvSuccess;
-        Address from;
-        byte* buf = new byte[m_bufSize];
-        int nBytes = m_socket.receiveFrom(buf, m_bufSize, &from, &recvSuccess);
-        if (!recvSuccess)
-        {
-            delete buf;
-            continue;
-        }
-
-        m_pReceiveCallback(buf, m_bufSize, nBytes, from);
+        m_state->mtx.lock();
+        m_state->open = false;
+        m_state->mtx.unlock();
+        if (success != nullptr) *success = false;
+        return;
     }
+
+    m_state->connectedBefore = true;
+    if (success != nullptr) *success = true;
 }
 
-Garnet::ClientTCP::ClientTCP()
+void Garnet::ClientRPC::disconnect(bool* success)
 {
-    m_bufSize = 256;
-    m_pReceiveCallback = nullptr;
-    m_connected = false;
+    m_client.disconnect(success);
 }
 
-Garnet::ClientTCP::ClientTCP(char dummy, bool* success)
+bool Garnet::ClientRPC::isConnected() const
 {
-    m_bufSize = 256;
-    m_pReceiveCallback = nullptr;
-    m_connected = false;
-    m_socket = Socket(Protocol::TCP, success);
+    return m_client.m_connected && !m_client.m_receiveEnded;
 }
 
-void Garnet::ClientTCP::connect(Address serverAddr, bool* success)
+void Garnet::ClientRPC::call(const void* data, int size, std::function<void(const Buffer& response, bool success)> callback, int timeoutMs)
 {
-    if (m_connected)
+    std::unique_lock<std::mutex> lock(m_state->mtx);
+    if (!m_state->open)
     {
-        err = "Failed to connect ClientTCP: already connected";
+        lock.unlock();
+        err = "ClientRPC request failed: not connected";
         if (printErrors) std::cout << err << "\n";
-        if (success != nullptr) *success = false;
+        callback(Buffer(), false);
         return;
     }
 
-    bool successA;
-    m_socket.connect(serverAddr, &successA);
-    if (successA)
-    {
-        m_connected = true;
-        if (success != nullptr) *success = true;
-    }
-    else
+    uint64_t id = m_state->nextID++;
+    m_state->outstanding[id] = std::move(callback);
+    if (timeoutMs >= 0)
     {
-        if (success != nullptr) *success = false;
-        return;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        bool earliest = m_state->deadlines.empty() || deadline < m_state->deadlines.top().first;
+        m_state->deadlines.push(State::Deadline(deadline, id));
+        if (!m_state->expiring.joinable()) m_state->expiring = std::thread(&State::expire, m_state);
+        else if (earliest) m_state->deadlinesCv.notify_one();
     }
-
-    m_receiving = std::thread(&Garnet::ClientTCP::receive, this);
-}
-
-void Garnet::ClientTCP::send(void* data, int size, bool* success)
-{
-    m_socket.send(data, size, success);
+    lock.unlock();
+
+    // registered before sending, as the response may arrive before send() returns
+    unsigned char header[HeaderSize];
+    writeRequestID(header, id);
+    Span spans[2];
+    spans[0].data = header;
+    spans[0].size = HeaderSize;
+    spans[1].data = (void*)data;
+    spans[1].size = size;
+
+    bool sent;
+    m_state->sendMtx.lock();
+    m_client.send(spans, 2, &sent);
+    m_state->sendMtx.unlock();
+    if (sent) return;
+
+    State::Callback failed = m_state->take(id);
+    if (!failed) return;
+    err = "ClientRPC request failed: could not send";
+    if (printErrors) std::cout << err << "\n";
+    failed(Buffer(), false);
 }
 
-void Garnet::ClientTCP::disconnect(bool* success)
+std::future<Garnet::Buffer> Garnet::ClientRPC::call(const void* data, int size, int timeoutMs)
 {
-    if (!m_connected)
+    std::shared_ptr<std::promise<Buffer>> promise = std::make_shared<std::promise<Buffer>>();
+    std::future<Buffer> future = promise->get_future();
+    call(data, size, [promise](const Buffer& response, bool success)
     {
-        err = "Failed to disconnect ClientTCP: not connected yet or already disconnected";
-        if (printErrors) std::cout << err << "\n";
-        if (success != nullptr) *success = false;
-        return;
-    }
-    
-    m_connected = false;
-    m_socket.close();
-    m_receiving.detach();
-    if (success != nullptr) *success = true;
+        promise->set_value(success ? response : Buffer());
+    }, timeoutMs);
+    return future;
 }
 
-bool Garnet::ClientTCP::isConnected() const
+int Garnet::ClientRPC::getNumOutstanding()
 {
-    return m_connected;
+    std::lock_guard<std::mutex> lock(m_state->mtx);
+    return (int)m_state->outstanding.size();
 }
 
-int Garnet::ClientTCP::getBufferSize() const
+void Garnet::ClientRPC::setMaxResponseSize(int size)
 {
-    return m_bufSize;
+    m_state->maxResponseSize = size;
 }
 
-void Garnet::ClientTCP::setBufferSize(int bufferSize)
+void Garnet::ClientRPC::onResponse(ClientTCP& client, const Buffer& buffer, int actualSize)
 {
-    m_bufSize = bufferSize;
-}
+    ClientRPC* rpc = (ClientRPC*)client.getUserPtr();
+    if (actualSize < HeaderSize)
+    {
+        err = "ClientRPC dropped a response: too short for a request ID";
+        if (printErrors) std::cout << err << "\n";
+        return;
+    }
 
-void Garnet::ClientTCP::setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize))
-{
-    m_pReceiveCallback = callback;
+    State::Callback callback = rpc->m_state->take(readRequestID((const unsigned char*)buffer.getData()));
+    if (callback) callback(buffer.slice(HeaderSize, actualSize - HeaderSize), true); // a late response to a timed out request is dropped
 }
 
-void Garnet::ClientTCP::receive()
+void Garnet::ClientRPC::onReceiveEnded(ClientTCP& client)
 {
-    while (m_connected)
+    ClientRPC* rpc = (ClientRPC*)client.getUserPtr();
+    std::unordered_map<uint64_t, State::Callback> failed;
     {
-        if (m_pReceiveCallback == nullptr) continue;
-
-        byte* buf = new byte[m_bufSize];
-        bool recvSuccess;
-        int nBytes = m_socket.receive(buf, m_bufSize, &recvSuccess);
-        if (!recvSuccess) continue;
-        
-        m_pReceiveCallback(buf, m_bufSize, nBytes);
+        std::lock_guard<std::mutex> lock(rpc->m_state->mtx);
+        rpc->m_state->open = false;
+        failed.swap(rpc->m_state->outstanding);
     }
+
+    if (failed.empty()) return;
+    err = "ClientRPC request failed: the connection was closed";
+    if (printErrors) std::cout << err << "\n";
+    for (auto& pair : failed) pair.second(Buffer(), false);
 }
 
 Garnet::ClientUDP::ClientUDP()
 {
     m_bufSize = 256;
+    m_batchSize = 32;
+    m_pBatchReceiveCallback = nullptr;
     m_pReceiveCallback = nullptr;
     m_connected = false;
 }
@@ -1007,6 +7479,8 @@ Garnet::ClientUDP::ClientUDP()
 Garnet::ClientUDP::ClientUDP(char dummy, bool* success)
 {
     m_bufSize = 256;
+    m_batchSize = 32;
+    m_pBatchReceiveCallback = nullptr;
     m_pReceiveCallback = nullptr;
     m_connected = true;
     m_socket = Socket(Protocol::UDP, success);
@@ -1014,11 +7488,36 @@ Garnet::ClientUDP::ClientUDP(char dummy, bool* success)
     m_receiving = std::thread(&Garnet::ClientUDP::receive, this);
 }
 
+Garnet::ClientUDP::~ClientUDP()
+{
+    if (m_connected) disconnect();
+}
+
 void Garnet::ClientUDP::send(void* data, int size, Address addr, bool* success)
 {
     m_socket.sendTo(data, size, addr, success);
 }
 
+void Garnet::ClientUDP::send(void* data, int size, const Endpoint& endpoint, bool* success)
+{
+    m_socket.sendTo(data, size, endpoint, success);
+}
+
+void Garnet::ClientUDP::send(const Span* spans, int count, Address addr, bool* success)
+{
+    m_socket.sendTo(spans, count, addr, success);
+}
+
+void Garnet::ClientUDP::sendSegmented(void* data, int size, int segmentSize, Address addr, bool* success)
+{
+    m_socket.sendToSegmented(data, size, segmentSize, addr, success);
+}
+
+void Garnet::ClientUDP::sendBatch(const Datagram* datagrams, int count, bool* success)
+{
+    m_socket.sendBatch(datagrams, count, success);
+}
+
 void Garnet::ClientUDP::disconnect(bool* success)
 {
     if (!m_connected)
@@ -1030,8 +7529,13 @@ void Garnet::ClientUDP::disconnect(bool* success)
     }
 
     m_connected = false;
+    m_callbackMtx.lock();
+    m_callbackMtx.unlock();
+    m_callbackCv.notify_all();
+
+    m_socket.interrupt();
+    joinThread(m_receiving);
     m_socket.close();
-    m_receiving.detach();
     if (success != nullptr) *success = true;
 }
 
@@ -1050,27 +7554,73 @@ void Garnet::ClientUDP::setBufferSize(int size)
     m_bufSize = size;
 }
 
-void Garnet::ClientUDP::setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize, Address fromServerAddress))
+void Garnet::ClientUDP::setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize, Address fromServerAddress))
 {
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
     m_pReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ClientUDP::setBatchReceiveCallback(void (*callback)(const Datagram* datagrams, int count), int batchSize)
+{
+    std::lock_guard<std::mutex> lock(m_callbackMtx);
+    m_batchSize = std::max(1, batchSize);
+    m_pBatchReceiveCallback = callback;
+    m_callbackCv.notify_all();
+}
+
+void Garnet::ClientUDP::setSocketOptions(const SocketOptions& options, bool* success)
+{
+    m_socket.setOptions(options, success);
+}
+
+void Garnet::ClientUDP::setBusyPoll(int spinMicroseconds, bool* success)
+{
+    m_busyPoll.spinMicroseconds = std::max(spinMicroseconds, 0);
+    m_socket.setBusyPoll(spinMicroseconds, success);
+}
+
+Garnet::BusyPollStats Garnet::ClientUDP::getBusyPollStats() const
+{
+    return ::getBusyPollStats(m_busyPoll);
 }
 
 void Garnet::ClientUDP::receive()
 {
+    std::vector<Datagram> batch;
     while (m_connected)
     {
-        if (m_pReceiveCallback == nullptr) continue;
+        void (*batchCallback)(const Datagram* datagrams, int count) = m_pBatchReceiveCallback;
+        if (batchCallback != nullptr)
+        {
+            if ((int)batch.size() != m_batchSize) batch.resize(m_batchSize);
 
-        bool recvSuccess;
-        Address from;
-        byte* buf = new byte[m_bufSize];
-        int nBytes = m_socket.receiveFrom(buf, m_bufSize, &from, &recvSuccess);
-        if (!recvSuccess)
+            spinUntilReadable(m_busyPoll, m_socket.m_bSocket);
+            bool recvSuccess;
+
+            int nDatagrams = m_socket.receiveBatch(batch.data(), (int)batch.size(), m_bufSize, &recvSuccess);
+            if (!recvSuccess) continue;
+
+            batchCallback(batch.data(), nDatagrams);
+            for (int i = 0; i < nDatagrams; i++) batch[i].buffer.release();
+            continue;
+        }
+
+        if (m_pReceiveCallback == nullptr)
         {
-            delete buf;
+            // leave the datagrams in the socket until there is a callback for them
+            std::unique_lock<std::mutex> lock(m_callbackMtx);
+            m_callbackCv.wait(lock, [this]() { return m_pReceiveCallback != nullptr || m_pBatchReceiveCallback != nullptr || !m_connected; });
             continue;
         }
 
-        m_pReceiveCallback(buf, m_bufSize, nBytes, from);
+        spinUntilReadable(m_busyPoll, m_socket.m_bSocket);
+        bool recvSuccess;
+        Address from;
+        Buffer buf(m_bufSize);
+        int nBytes = m_socket.receiveFrom(buf.getData(), buf.getSize(), &from, &recvSuccess);
+        if (!recvSuccess) continue;
+
+        m_pReceiveCallback(buf, nBytes, from);
     }
 }
@@ -5,9 +5,13 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <vector>
 #include <list>
+#include <memory>
+#include <shared_mutex>
+#include <future>
 
 #define GNET_VERSION_MAJOR  1
 #define GNET_VERSION_MINOR  0
@@ -38,6 +42,9 @@ typedef unsigned short ushort;
 #ifdef GNET_OS_WINDOWS
     #include <winsock2.h>
     #include <ws2tcpip.h>
+    #include <mswsock.h>
+    #include <io.h>
+    #include <fcntl.h>
 
 #elif defined(GNET_OS_UNIX)
     #include <sys/types.h>
@@ -49,7 +56,37 @@ typedef unsigned short ushort;
     #include <errno.h>
     #include <fcntl.h>
     #include <netdb.h>
+    #include <poll.h>
+    #include <sys/stat.h>
+    #include <netinet/tcp.h>
+    #include <signal.h>
+
+    #ifdef GNET_OS_LINUX
+        #include <pthread.h>
+        #include <sched.h>
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+        #include <netinet/udp.h>
+        #include <linux/errqueue.h>
+        #include <sys/sendfile.h>
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #if __has_include(<linux/io_uring.h>)
+            #include <linux/io_uring.h>
+            #ifdef IORING_RECV_MULTISHOT
+                #define GNET_IO_URING // the kernel headers know multishot receives and provided buffer rings (Linux 6.0)
+            #endif
+        #endif
+    #endif
+
+#endif
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    #include <coroutine>
+    #include <exception>
+    #include <optional>
+    #include <utility>
+    #define GNET_COROUTINES // compiled as C++20, so the awaitable operations are available (the library itself only needs C++17)
 #endif
 
 /*
@@ -103,6 +140,13 @@ namespace Garnet
      */
     const std::string& GetLastError();
 
+    /*
+        @brief Sets the last error message, printing it if errors are printed (see `Init()`).
+        Used by the templated servers, whose code lives in this header; also available for errors of your own.
+        @param message The error message.
+     */
+    void SetLastError(const std::string& message);
+
     /*
         @brief Sets the user pointer for the library.
         @param ptr The pointer to set.
@@ -126,25 +170,195 @@ namespace Garnet
         UDP     // User Datagram Protocol.
     };
 
+    /*
+        @brief An enum class to represent how a server multiplexes its connected clients.
+     */
+    enum class IOModel
+    {
+        ThreadPerClient,    // One blocking receive thread per connected client. Available on all platforms.
+        Reactor,            // A fixed number of threads multiplexing all clients with non-blocking sockets and edge-triggered epoll. Linux only.
+        IOUring             // A fixed number of threads submitting accepts, receives and sends through io_uring, without readiness polling. Linux 6.0 or later.
+    };
+
     /*
         @brief A struct to represent an address.
+        The IP address is stored in binary form (4 bytes for IPv4, 16 bytes for IPv6) so that addresses are small, trivially copyable and cheap to hash and compare.
+        The text form of the host is only produced on demand with `getHost()`.
      */
     struct Address
     {
-        std::string host = "";   // The IP address or hostname / domain name.
-        ushort port = 0;        // The port number.
+        ushort port;    // The port number.
+
+        /*
+            @brief Creates an empty address (no host, port 0).
+         */
+        Address();
+
+        /*
+            @brief Creates an address from a host and a port.
+            @param host The IP address (IPv4 or IPv6) or hostname / domain name. Hostnames are resolved to an IPv4 address immediately, through the default `Resolver`.
+            @param port The port number.
+            @param success A pointer to a boolean to store whether the host was successfully parsed or resolved.
+         */
+        Address(const std::string& host, ushort port, bool* success = nullptr);
+
+        /*
+            @brief Gets the IP address as text.
+            @return The IP address as a string, or an empty string if the address has no host.
+         */
+        std::string getHost() const;
+
+        /*
+            @brief Sets the IP address.
+            @param host The IP address (IPv4 or IPv6) or hostname / domain name. Hostnames are resolved to an IPv4 address immediately, through the default `Resolver`.
+            @param success A pointer to a boolean to store whether the host was successfully parsed or resolved.
+         */
+        void setHost(const std::string& host, bool* success = nullptr);
+
+        /*
+            @brief Gets the raw IP address bytes, in network byte order.
+            @return A pointer to 16 bytes. Only the first 4 are used for IPv4 addresses.
+         */
+        const unsigned char* getBytes() const;
+
+        /*
+            @brief Sets the raw IP address bytes, in network byte order.
+            @param ip A pointer to 4 bytes (IPv4) or 16 bytes (IPv6).
+            @param ipv6 True if `ip` points to an IPv6 address, false if it points to an IPv4 address.
+         */
+        void setBytes(const void* ip, bool ipv6);
+
+        /*
+            @brief Checks whether the address has no host.
+            @return True if no host was set, false otherwise.
+         */
+        bool isEmpty() const;
+
+        /*
+            @brief Checks whether the address is an IPv6 address.
+            @return True if the address is an IPv6 address, false otherwise.
+         */
+        bool isIPv6() const;
+
+        /*
+            @brief Gets a hash of the address, computed from its raw bytes and port.
+            @return The hash of the address.
+         */
+        size_t getHash() const;
 
-        void operator=(const Address& other);
         bool operator==(const Address& other) const;
+        bool operator!=(const Address& other) const;
+
+    private:
+        unsigned char m_ip[16];
+        unsigned char m_family; // 0 = no host, 4 = IPv4, 6 = IPv6
     };
 
     /*
         @brief Converts a hostname to an IP address.
+        The hostname is resolved through the default `Resolver`, so repeated calls are answered from its cache.
         @param hostname The hostname / domain name to convert.
         @param success A pointer to a boolean to store whether the conversion was successful.
         @return The IP address as a string. If the conversion was unsuccessful, an empty string is returned.
      */
     std::string HostnameToIP(const std::string& hostname, bool* success = nullptr);
+
+    /*
+        @brief A class to resolve hostnames to IPv4 addresses, caching the answers.
+        Addresses, `HostnameToIP()` and `ClientTCP::connect()` resolve through the default resolver (see `getDefault()`), so a hostname in heavy use is only looked up
+        once per TTL, and concurrent lookups of the same name wait for one shared query. Failed lookups are cached too (negative caching).
+        By default, names are looked up with the system resolver (getaddrinfo), which does not report TTLs, so its answers are kept for `setDefaultTTL()` seconds.
+        With `setNameServer()`, the resolver queries that DNS server directly instead, and keeps every answer for as long as its TTL says.
+        A hosts file set with `setHostsFile()` is consulted before either, which also makes name resolution easy to stub out.
+        All functions can be called from any thread.
+     */
+    class Resolver
+    {
+    public:
+        /*
+            @brief Creates a resolver with an empty cache, using the system resolver.
+         */
+        Resolver();
+
+        /*
+            @brief Destroys the resolver, waiting for the asynchronous lookups still in flight to finish and call back.
+         */
+        ~Resolver();
+
+        Resolver(const Resolver&) = delete;
+        Resolver& operator=(const Resolver&) = delete;
+
+        /*
+            @brief Gets the resolver used by `Address`, `HostnameToIP()` and `ClientTCP::connect()`.
+            Configure it before the first hostnames are resolved, e.g. right after `Init()`.
+            @return The default resolver.
+         */
+        static Resolver& getDefault();
+
+        /*
+            @brief Resolves a hostname to its IPv4 addresses, from the cache if possible.
+         !  This is a blocking function if the answer is not cached - it will wait for the lookup (or for the same lookup already in flight).
+            @param hostname The hostname / domain name to resolve. IPv4 addresses are returned as they are.
+            @param success A pointer to a boolean to store whether the hostname was successfully resolved.
+            @return The addresses, in order of preference, with port 0. If the hostname could not be resolved, an empty vector is returned.
+         */
+        std::vector<Address> resolve(const std::string& hostname, bool* success = nullptr);
+
+        /*
+            @brief Resolves a hostname to its IPv4 addresses without blocking, calling back with the result.
+            If the answer is cached, the callback is called right away on the calling thread. Otherwise it is called on one of the resolver's background threads
+            once the lookup finishes, even when the lookup is shared with a blocking `resolve()` on another thread.
+            @param hostname The hostname / domain name to resolve. IPv4 addresses are returned as they are.
+            @param callback The function to call with the result. The callback function should adhere to the following signature:
+            `void callback(const std::vector<Address>& addresses, bool success);`
+            - `addresses`: The addresses, in order of preference, with port 0. Empty if the hostname could not be resolved.
+            - `success`: Whether the hostname was successfully resolved.
+         */
+        void resolveAsync(const std::string& hostname, std::function<void(const std::vector<Address>& addresses, bool success)> callback);
+
+        /*
+            @brief Sets a DNS server to query directly (over UDP) instead of using the system resolver.
+            Answers are cached for their TTL, and negative answers for the time the server's SOA record allows (RFC 2308).
+            @param nameServer The address of the DNS server, usually on port 53. An empty address goes back to the system resolver.
+            @param timeoutMs How long to wait for an answer before asking again, in milliseconds. The server is asked twice before the lookup fails.
+            @param success A pointer to a boolean to store whether the name server was successfully set.
+         */
+        void setNameServer(Address nameServer, int timeoutMs = 1000, bool* success = nullptr);
+
+        /*
+            @brief Sets a hosts file (lines of an IPv4 address followed by hostnames, '#' starting a comment) to consult before any other lookup.
+            The file is read right away; its entries never expire.
+            @param path The path of the hosts file. An empty path removes the entries of the previous file.
+            @param success A pointer to a boolean to store whether the file was successfully read.
+         */
+        void setHostsFile(const std::string& path, bool* success = nullptr);
+
+        /*
+            @brief Sets how long answers of the system resolver are cached, since it does not report TTLs.
+            The default is 60 seconds. 0 disables caching of those answers (concurrent lookups are still shared).
+            @param seconds The time to cache answers for, in seconds.
+         */
+        void setDefaultTTL(int seconds);
+
+        /*
+            @brief Sets how long failed lookups are cached, unless the DNS server says otherwise.
+            The default is 5 seconds. 0 disables negative caching.
+            @param seconds The time to cache failed lookups for, in seconds.
+         */
+        void setNegativeTTL(int seconds);
+
+        /*
+            @brief Empties the cache, so that every hostname is looked up again.
+         */
+        void clearCache();
+
+    private:
+        struct State; // the cache, the lookups in flight and the settings, defined in Garnet.cpp
+        State* m_state;
+
+        // looks up the IPv4 addresses of a hostname with a DNS server (RFC 1035). `ttl` gets how long the answer (or its absence) may be cached
+        static bool queryNameServer(const std::string& hostname, Address nameServer, int timeoutMs, int negativeTTL, std::vector<Address>* addresses, int* ttl);
+    };
 };
 
 namespace std
@@ -154,7 +368,7 @@ namespace std
     {
         size_t operator()(const Garnet::Address& addr) const 
         {
-            return hash<string>()(addr.host) ^ (hash<int>()(addr.port) << 1);
+            return addr.getHash();
         }
     };
 };
@@ -165,6 +379,210 @@ namespace std
  */
 namespace Garnet
 {
+    /*
+        @brief A class to represent a pre-resolved endpoint.
+        An endpoint holds an address together with its ready-to-use backend socket address, so sending to it never needs to resolve the host again.
+        Useful for peers that are sent to repeatedly, e.g. with `Socket::sendTo()`, `ServerUDP::send()` or `ClientUDP::send()`.
+     */
+    class Endpoint
+    {
+    public:
+        /*
+            @brief Creates an empty, invalid endpoint.
+         */
+        Endpoint();
+
+        /*
+            @brief Creates an endpoint by resolving the specified address.
+         !  The address needs an IPv4 host: an empty address, which stands for any address when binding, makes an invalid endpoint.
+            @param address The address to resolve. The host may be an IP address or a hostname / domain name.
+            @param success A pointer to a boolean to store whether the address was successfully resolved.
+         */
+        explicit Endpoint(Address address, bool* success = nullptr);
+
+        /*
+            @brief Gets the address the endpoint was created from.
+            @return The address of the endpoint.
+         */
+        const Address& getAddress() const;
+
+        /*
+            @brief Checks whether the endpoint was successfully resolved.
+            @return True if the endpoint is valid, false otherwise.
+         */
+        bool isValid() const;
+
+    private:
+        friend class Socket;
+
+        Address m_addr;
+
+    #ifdef GNET_OS_WINDOWS
+        SOCKADDR_IN m_bAddr;
+    #elif defined(GNET_OS_UNIX)
+        sockaddr_in m_bAddr;
+    #endif
+
+        bool m_valid;
+    };
+
+    /*
+        @brief A class to represent a reference-counted handle to a pooled buffer.
+        Buffers are taken from a per-thread pool of size-classed blocks and go back to that same pool wherever the last handle is released,
+        so a receive loop does not touch the heap in steady state, even when its buffers are handed to other threads.
+        Copying a handle shares the same memory; it is released when the last copy is destroyed.
+     */
+    class Buffer
+    {
+    public:
+        /*
+            @brief Creates an empty buffer handle.
+         */
+        Buffer();
+
+        /*
+            @brief Creates a buffer of the specified size from the calling thread's pool.
+            @param size The size of the buffer in bytes.
+         */
+        Buffer(int size);
+
+        Buffer(const Buffer& other);
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(const Buffer& other);
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+
+        /*
+            @brief Gets the data of the buffer.
+            @return A pointer to the data of the buffer, or `nullptr` if the handle is empty.
+         */
+        void* getData() const;
+
+        /*
+            @brief Gets the size of the buffer.
+            @return The size of the buffer in bytes.
+         */
+        int getSize() const;
+
+        /*
+            @brief Checks whether the handle refers to a buffer.
+            @return True if the handle refers to a buffer, false if it is empty.
+         */
+        bool isValid() const;
+
+        /*
+            @brief Creates a handle to a part of this buffer, sharing the same memory (no copy).
+            The whole buffer stays alive as long as any slice of it does.
+            @param offset The offset of the slice from the start of this buffer, in bytes.
+            @param size The size of the slice in bytes.
+            @return The slice, or an empty handle if the range is out of bounds.
+         */
+        Buffer slice(int offset, int size) const;
+
+        /*
+            @brief Releases this handle's reference to the buffer, leaving the handle empty.
+            The buffer goes back to the pool if this was the last reference.
+         */
+        void release();
+
+    private:
+        struct Block;
+        struct Pool;
+        static Pool& getPool();
+
+        Block* m_block;
+        char* m_data;
+        int m_size;
+    };
+
+    /*
+        @brief A struct to represent a single datagram in a batch.
+        Used both to describe outgoing datagrams for `sendBatch()` and to hold incoming datagrams from `receiveBatch()` / batch receive callbacks.
+     */
+    struct Datagram
+    {
+        void* data = nullptr;   // The data of the datagram.
+        int size = 0;           // The size of the data in bytes.
+        Address address;        // The address the datagram is sent to, or was received from.
+        Buffer buffer;          // For received datagrams, the pooled buffer that `data` points into. Copy it to keep the data alive. Unused when sending.
+    };
+
+    /*
+        @brief A struct to represent one piece of a scatter/gather operation.
+        An array of spans lets a header and payload that live in separate memory be sent or received in one system call, without copying them into a single buffer first.
+     */
+    struct Span
+    {
+        void* data = nullptr;   // The start of the memory.
+        int size = 0;           // The size of the memory in bytes.
+    };
+
+    /*
+        @brief A struct to hold a set of socket options, for `Socket::setOptions()` and the servers' and clients' `setSocketOptions()`.
+        Every option that is -1 is left at the system default. The named profiles `lowLatency()` and `bulkThroughput()` are good starting points.
+     */
+    struct SocketOptions
+    {
+        int noDelay = -1;           // TCP_NODELAY (TCP only): 1 to send small segments right away, 0 to let Nagle's algorithm coalesce them.
+        int cork = -1;              // TCP_CORK, or TCP_NOPUSH on BSD / macOS (TCP only): 1 to hold back partial segments until they are full or the socket is uncorked.
+        int quickAck = -1;          // TCP_QUICKACK (TCP only, Linux): 1 to acknowledge received data right away instead of delaying the ACK. One-shot: the kernel reverts to delayed ACKs on its own.
+        int receiveBufferSize = -1; // SO_RCVBUF in bytes. Linux doubles the value for bookkeeping and caps it at net.core.rmem_max.
+        int sendBufferSize = -1;    // SO_SNDBUF in bytes. Linux doubles the value for bookkeeping and caps it at net.core.wmem_max.
+        int priority = -1;          // SO_PRIORITY (Linux): the queueing priority of outgoing packets, 0 to 6 without CAP_NET_ADMIN.
+        int typeOfService = -1;     // IP_TOS: the type of service / DSCP byte of outgoing packets.
+
+        /*
+            @brief Gets the low-latency profile: no Nagle coalescing and low-delay packet marking.
+            TCP_QUICKACK is left out, since applying it once when the socket is set up only affects the first few ACKs.
+            Request/response traffic with small messages gets its replies a round trip sooner, at the cost of more, smaller packets.
+            @return The low-latency options.
+         */
+        static SocketOptions lowLatency();
+
+        /*
+            @brief Gets the bulk-throughput profile: Nagle coalescing, 4 MiB send and receive buffers and throughput packet marking.
+            Streams keep more data in flight and send full segments, at the cost of delaying small messages.
+            @return The bulk-throughput options.
+         */
+        static SocketOptions bulkThroughput();
+    };
+
+    /*
+        @brief A struct to hold the counters of busy-poll receiving (see `setBusyPoll()` of the servers and clients), for tuning the spin budget.
+     */
+    struct BusyPollStats
+    {
+        long long nSpins = 0;           // The number of times a receiving thread spun before receiving.
+        long long nHits = 0;            // The number of spins that found data within the spin budget, so that the thread did not block.
+        long long spinMicroseconds = 0; // The total time spent spinning, in microseconds.
+
+        /*
+            @brief Gets the share of spins that found data. A low hit rate means the spin budget mostly burns CPU and could be shorter or turned off.
+            @return `nHits / nSpins` between 0 and 1, or 0 before the first spin.
+         */
+        double getHitRate() const;
+    };
+
+    // the spin budget and live counters behind `BusyPollStats`, kept by every server and client
+    struct BusyPoll
+    {
+        std::atomic<int> spinMicroseconds{ 0 };
+        std::atomic<long long> nSpins{ 0 };
+        std::atomic<long long> nHits{ 0 };
+        std::atomic<long long> spinNanoseconds{ 0 };
+    };
+
+#ifdef GNET_COROUTINES
+    // the awaitable operations of `Socket` and `ClientTCP`, and the coroutine type they are awaited in (see the end of this header)
+    class AsyncReceive;
+    class AsyncSend;
+    class AsyncAccept;
+    class AsyncConnect;
+    template<typename T = void>
+    class Task;
+    struct TaskPromiseBase;
+#endif
+
     /*
         @brief A class to represent a socket.
         This class provides a simple cross-platform interface for creating and managing sockets.
@@ -217,6 +635,16 @@ namespace Garnet
          */
         void connect(Address serverAddress, bool* success = nullptr);
 
+        /*
+            @brief Connects the socket to the specified server address, giving up once `timeoutMs` milliseconds have passed.
+            Unlike `connect()`, an unreachable server does not hold up the calling thread for the system's whole SYN retry period.
+         !  If the connection failed or timed out, close the socket and create a new one before trying again.
+            @param serverAddress The address of the server to connect to.
+            @param timeoutMs The longest time to wait for the connection, in milliseconds. -1 waits as long as the system does.
+            @param success A pointer to a boolean to store whether the connection was successful.
+         */
+        void connect(Address serverAddress, int timeoutMs, bool* success = nullptr);
+
         /*
             @brief Sends data through the socket.
          !  This function is only meant for TCP sockets. For UDP sockets, use `sendTo()`.
@@ -238,6 +666,58 @@ namespace Garnet
          */
         int receive(void* buffer, int bufferSize, bool* success = nullptr);
 
+        /*
+            @brief Sends the contents of several spans through the socket in a single system call (gather write), in order.
+         !  This function is only meant for TCP sockets. For UDP sockets, use `sendTo()`.
+            @param spans The spans to send.
+            @param count The number of spans.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+            @return The number of bytes sent, which may be less than the total size of the spans. If an error occurred, -1 is returned.
+         */
+        int sendv(const Span* spans, int count, bool* success = nullptr);
+
+        /*
+            @brief Receives data through the socket into several spans in a single system call (scatter read), filling them in order.
+         !  This is a blocking function - it will wait until there is data to receive.
+         !  This function is only meant for TCP sockets.
+            @param spans The spans to store the received data in.
+            @param count The number of spans.
+            @param success A pointer to a boolean to store whether the data was successfully received.
+            @return The number of bytes received. If an error occurred, -1 is returned.
+         */
+        int receivev(const Span* spans, int count, bool* success = nullptr);
+
+        /*
+            @brief Sends part of a file through the socket without reading it into user memory (sendfile on Linux, TransmitFile on Windows).
+            Partial writes are retried internally, also on non-blocking sockets, so this returns once the whole range is sent or an error occurs.
+         !  This is a blocking function - call it from your own thread for large files, not from a receive callback.
+         !  This function is only meant for TCP sockets.
+            If the peer has closed the connection, this fails with `success` false instead of raising SIGPIPE: on Linux, SIGPIPE is blocked on the
+            calling thread for the duration of the call and a SIGPIPE raised by the transfer is consumed.
+            @param path The path of the file to send.
+            @param offset The offset in the file to start sending from, in bytes.
+            @param length The number of bytes to send. If negative, the rest of the file from `offset` is sent.
+            @param success A pointer to a boolean to store whether the whole range was successfully sent.
+            @return The number of bytes sent. If an error occurred before any were sent, -1 is returned.
+         */
+        long long sendFile(const std::string& path, long long offset = 0, long long length = -1, bool* success = nullptr);
+
+        /*
+            @brief Sends part of an already open file through the socket without reading it into user memory (sendfile on Linux, TransmitFile on Windows).
+            Partial writes are retried internally, also on non-blocking sockets, so this returns once the whole range is sent or an error occurs.
+            The file's own read position is left alone on Linux, so one descriptor can serve several clients at once.
+         !  This is a blocking function - call it from your own thread for large files, not from a receive callback.
+         !  This function is only meant for TCP sockets.
+            If the peer has closed the connection, this fails with `success` false instead of raising SIGPIPE: on Linux, SIGPIPE is blocked on the
+            calling thread for the duration of the call and a SIGPIPE raised by the transfer is consumed.
+            @param fileDescriptor The file descriptor of the file to send (from `open()`, or `_open()` on Windows).
+            @param offset The offset in the file to start sending from, in bytes.
+            @param length The number of bytes to send. If negative, the rest of the file from `offset` is sent.
+            @param success A pointer to a boolean to store whether the whole range was successfully sent.
+            @return The number of bytes sent. If an error occurred before any were sent, -1 is returned.
+         */
+        long long sendFile(int fileDescriptor, long long offset = 0, long long length = -1, bool* success = nullptr);
+
         /*
             @brief Sends data through the socket to the specified address.
          !  This function is only meant for UDP sockets. For TCP sockets, use `send()`.
@@ -249,6 +729,29 @@ namespace Garnet
          */
         int sendTo(void* data, int size, Address to, bool* success = nullptr);
 
+        /*
+            @brief Sends data through the socket to the specified pre-resolved endpoint.
+            Unlike the overload taking an `Address`, this never resolves the host.
+         !  This function is only meant for UDP sockets. For TCP sockets, use `send()`.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param to The endpoint to send the data to. Sending to an invalid endpoint (empty, or one that failed to resolve) fails.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+            @return The number of bytes sent. If an error occurred, -1 is returned.
+         */
+        int sendTo(void* data, int size, const Endpoint& to, bool* success = nullptr);
+
+        /*
+            @brief Sends the contents of several spans to the specified address as a single datagram.
+         !  This function is only meant for UDP sockets. For TCP sockets, use `sendv()`.
+            @param spans The spans that make up the datagram.
+            @param count The number of spans.
+            @param to The address to send the datagram to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+            @return The number of bytes sent. If an error occurred, -1 is returned.
+         */
+        int sendTo(const Span* spans, int count, Address to, bool* success = nullptr);
+
         /*
             @brief Receives data through the socket from the specified address.
          *  This is NOT a blocking function - it will return immediately if there is no data to receive.
@@ -261,6 +764,110 @@ namespace Garnet
          */
         int receiveFrom(void* buffer, int bufferSize, Address* from, bool* success = nullptr);
 
+        /*
+            @brief Sends a large buffer to the specified address as a series of equal-sized datagrams, letting the kernel do the segmentation (UDP GSO on Linux).
+            Every datagram is `segmentSize` bytes except possibly the last one. Where UDP GSO is not available, the datagrams are sent one by one.
+         !  This function is only meant for UDP sockets.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param segmentSize The size of each datagram in bytes.
+            @param to The address to send the datagrams to.
+            @param success A pointer to a boolean to store whether all of the data was successfully sent.
+            @return The number of bytes sent. If an error occurred before anything was sent, -1 is returned.
+         */
+        int sendToSegmented(void* data, int size, int segmentSize, Address to, bool* success = nullptr);
+
+        /*
+            @brief Receives data through the socket like `receiveFrom()`, but also reports the segment size if the kernel coalesced several datagrams (UDP GRO).
+            GRO must be enabled with `setGRO()` for datagrams to be coalesced. The buffer should be large enough for a coalesced burst (up to 64 KB).
+         !  This is a blocking function - it will wait until there is data to receive.
+         !  This function is only meant for UDP sockets.
+            @param buffer The buffer to store the received data.
+            @param bufferSize The size of the buffer in bytes.
+            @param from The address to receive the data from.
+            @param segmentSize A pointer to an integer to store the size of each coalesced datagram, or 0 if the data is a single datagram.
+            @param success A pointer to a boolean to store whether the data was successfully received.
+            @return The number of bytes received. If an error occurred, -1 is returned.
+         */
+        int receiveFromCoalesced(void* buffer, int bufferSize, Address* from, int* segmentSize, bool* success = nullptr);
+
+        /*
+            @brief Sets whether the kernel may coalesce incoming datagrams from the same flow into one receive (UDP_GRO). Linux only.
+            Use `receiveFromCoalesced()` to split coalesced data back into datagrams.
+            @param enabled True to enable GRO, false to disable it.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setGRO(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sends multiple datagrams through the socket, each to its own address, in as few system calls as possible (sendmmsg on Linux).
+         !  This function is only meant for UDP sockets.
+            @param datagrams The datagrams to send. Only `data`, `size` and `address` are used.
+            @param count The number of datagrams.
+            @param success A pointer to a boolean to store whether all of the datagrams were successfully sent.
+            @return The number of datagrams sent. If an error occurred before any were sent, -1 is returned.
+         */
+        int sendBatch(const Datagram* datagrams, int count, bool* success = nullptr);
+
+        /*
+            @brief Receives up to `count` datagrams through the socket in as few system calls as possible (recvmmsg on Linux, up to 64 datagrams per call).
+         !  This is a blocking function - it will wait until there is at least one datagram to receive, then return whatever else is already queued.
+         !  This function is only meant for UDP sockets.
+            @param datagrams The datagrams to fill. Each received datagram gets its own pooled buffer of `bufferSize` bytes.
+            @param count The maximum number of datagrams to receive.
+            @param bufferSize The size of each datagram's buffer in bytes.
+            @param success A pointer to a boolean to store whether the datagrams were successfully received.
+            @return The number of datagrams received. If an error occurred, -1 is returned.
+         */
+        int receiveBatch(Datagram* datagrams, int count, int bufferSize, bool* success = nullptr);
+
+        /*
+            @brief Sets whether the socket may send without copying, using SO_ZEROCOPY. Linux only.
+            Must be enabled before `sendZeroCopy()` is used. Only disable it once every token from `sendZeroCopy()` has completed.
+         !  This function is only meant for TCP sockets.
+            @param enabled True to enable zero-copy sends, false to disable them.
+            @param success A pointer to a boolean to store whether zero-copy sends were successfully enabled or disabled.
+         */
+        void setZeroCopy(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sends data through the socket without copying it into the kernel, using MSG_ZEROCOPY. Linux only.
+            The kernel sends straight from `data`, so it must stay alive and unmodified until `token` is returned by `getZeroCopyCompletions()`.
+            Payloads smaller than about 10 KB are copied as usual, since pinning their pages costs more than copying them; they still get a token.
+         !  This function is only meant for TCP sockets, with `setZeroCopy()` enabled.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param token A pointer to store the completion token of this send. Tokens count up from 0 per socket.
+            @param success A pointer to a boolean to store whether all of the data was successfully sent.
+            @return The number of bytes sent. If an error occurred before any were sent, -1 is returned.
+         */
+        int sendZeroCopy(void* data, int size, unsigned int* token = nullptr, bool* success = nullptr);
+
+        /*
+            @brief Collects the tokens of zero-copy sends whose buffers the kernel has released, in the order they were sent.
+         *  This is NOT a blocking function - it will return immediately if no sends have completed.
+            @param tokens The array to store the completed tokens in.
+            @param maxTokens The size of `tokens`.
+            @param success A pointer to a boolean to store whether the completions were successfully collected.
+            @return The number of tokens stored. If an error occurred, -1 is returned.
+         */
+        int getZeroCopyCompletions(unsigned int* tokens, int maxTokens, bool* success = nullptr);
+
+        /*
+            @brief Sets whether the socket is in blocking mode.
+            Sockets are blocking by default. In non-blocking mode, `accept()`, `receive()` and `send()` return immediately with an error if they would have to wait.
+            @param blocking True to make the socket blocking, false to make it non-blocking.
+            @param success A pointer to a boolean to store whether the mode was successfully set.
+         */
+        void setBlocking(bool blocking, bool* success = nullptr);
+
+        /*
+            @brief Shuts down both directions of the socket without closing it.
+            Any thread blocked in `accept()` or `receive()` on the socket is woken up.
+            @param success A pointer to a boolean to store whether the socket was successfully shut down.
+         */
+        void shutdown(bool* success = nullptr);
+
         /*
             @brief Closes the socket.
          !  This function should always be called when the socket is no longer needed.
@@ -281,17 +888,166 @@ namespace Garnet
         const Protocol& getProtocol() const;
 
         /*
-            @brief Checks whether the socket is open.
-            The socket is considered 'open' if it was created with the constructor that takes a protocol and it has not been closed.
-            @return True if the socket is open, false otherwise.
+            @brief Sets whether the socket may be bound to an address and port that other sockets are also bound to (SO_REUSEPORT).
+            On Linux, incoming connections / datagrams are load-balanced across all sockets bound with this option.
+         !  This function must be called before `bind()`.
+            @param enabled True to enable SO_REUSEPORT, false to disable it.
+            @param success A pointer to a boolean to store whether the option was successfully set.
          */
-        bool isOpen() const;
+        void setReusePort(bool enabled, bool* success = nullptr);
 
-    private:
-        Address m_addr;
-        Protocol m_proto;
+        /*
+            @brief Sets whether small segments are sent right away instead of being coalesced by Nagle's algorithm (TCP_NODELAY). TCP only.
+            @param enabled True to send right away, false to coalesce.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setNoDelay(bool enabled, bool* success = nullptr);
 
-    #ifdef GNET_OS_WINDOWS
+        /*
+            @brief Sets whether partial segments are held back until they are full (TCP_CORK, or TCP_NOPUSH on BSD / macOS). TCP only, not supported on Windows.
+            Cork the socket, make several sends, then uncork it to send them in as few segments as possible. Uncorking sends what is held back right away.
+            @param enabled True to cork the socket, false to uncork it.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setCork(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sets whether received data is acknowledged right away instead of delaying the ACK (TCP_QUICKACK). TCP only, Linux only.
+         !  This is one-shot rather than a permanent setting: the kernel falls back to delayed ACKs on its own (typically after the next receive),
+         !  so it has to be set again after every receive to keep acknowledging right away.
+            @param enabled True to acknowledge right away, false to allow delayed ACKs.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setQuickAck(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sets the size of the socket's receive buffer (SO_RCVBUF). For TCP, this bounds the receive window, so set it before `listen()` or `connect()`.
+            @param size The size in bytes. Linux doubles it for bookkeeping and caps it at net.core.rmem_max.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setReceiveBufferSize(int size, bool* success = nullptr);
+
+        /*
+            @brief Gets the size of the socket's receive buffer (SO_RCVBUF), as the system reports it.
+            @param success A pointer to a boolean to store whether the size was successfully retrieved.
+            @return The size in bytes. If an error occurred, -1 is returned.
+         */
+        int getReceiveBufferSize(bool* success = nullptr) const;
+
+        /*
+            @brief Sets the size of the socket's send buffer (SO_SNDBUF).
+            @param size The size in bytes. Linux doubles it for bookkeeping and caps it at net.core.wmem_max.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setSendBufferSize(int size, bool* success = nullptr);
+
+        /*
+            @brief Gets the size of the socket's send buffer (SO_SNDBUF), as the system reports it.
+            @param success A pointer to a boolean to store whether the size was successfully retrieved.
+            @return The size in bytes. If an error occurred, -1 is returned.
+         */
+        int getSendBufferSize(bool* success = nullptr) const;
+
+        /*
+            @brief Sets the queueing priority of outgoing packets (SO_PRIORITY). Linux only.
+            @param priority The priority, 0 to 6 without CAP_NET_ADMIN.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setPriority(int priority, bool* success = nullptr);
+
+        /*
+            @brief Sets the type of service / DSCP byte of outgoing packets (IP_TOS).
+            Windows ignores it unless enabled by system policy.
+            @param typeOfService The TOS byte, e.g. 0x10 for low delay or 0x08 for throughput.
+            @param success A pointer to a boolean to store whether the option was successfully set.
+         */
+        void setTypeOfService(int typeOfService, bool* success = nullptr);
+
+        /*
+            @brief Sets every option in `options` that is not -1.
+            TCP-only options are skipped on UDP sockets, and options the platform does not support are skipped, so that a profile can be applied anywhere.
+            @param options The options to set.
+            @param success A pointer to a boolean to store whether all options were successfully set. Failing options do not stop the others from being set.
+         */
+        void setOptions(const SocketOptions& options, bool* success = nullptr);
+
+        /*
+            @brief Sets how long a receive on an empty socket busy-polls the network device for new data before it sleeps (SO_BUSY_POLL). Linux only.
+            Where the kernel supports it (Linux 5.11 and later), SO_PREFER_BUSY_POLL is set along with it, so busy polling takes precedence over interrupts.
+         !  Raising the value above net.core.busy_read needs CAP_NET_ADMIN.
+            @param microseconds The busy-poll time in microseconds. 0 turns busy polling off.
+            @param success A pointer to a boolean to store whether the options were successfully set.
+         */
+        void setBusyPoll(int microseconds, bool* success = nullptr);
+
+        /*
+            @brief Checks whether the socket is open.
+            The socket is considered 'open' if it was created with the constructor that takes a protocol and it has not been closed.
+            @return True if the socket is open, false otherwise.
+         */
+        bool isOpen() const;
+
+    #ifdef GNET_COROUTINES
+        /*
+            @brief Receives data through the socket without blocking the thread, for use with `co_await` in a task run by an `EventLoop`.
+            The awaiting task is suspended until there is data to receive, and the event loop runs other tasks in the meantime.
+         !  This function is only available when compiling as C++20, and is only meant for TCP sockets.
+         !  The socket must not be closed while a task awaits it; `shutdown()` it instead, which makes the operation fail.
+            @param buffer The buffer to store the received data.
+            @param bufferSize The size of the buffer in bytes.
+            @param success A pointer to a boolean to store whether the data was successfully received.
+            @return An awaitable that yields the number of bytes received, 0 once the peer has closed the connection. If an error occurred, -1 is yielded.
+         */
+        AsyncReceive asyncReceive(void* buffer, int bufferSize, bool* success = nullptr);
+
+        /*
+            @brief Sends data through the socket without blocking the thread, for use with `co_await` in a task run by an `EventLoop`.
+            Unlike `send()`, the awaiting task is only resumed once all of the data was sent (or an error occurred).
+         !  This function is only available when compiling as C++20, and is only meant for TCP sockets.
+            @param data The data to send. It must stay alive until the operation completes.
+            @param size The size of the data in bytes.
+            @param success A pointer to a boolean to store whether all of the data was successfully sent.
+            @return An awaitable that yields the number of bytes sent. If an error occurred, -1 is yielded.
+         */
+        AsyncSend asyncSend(const void* data, int size, bool* success = nullptr);
+
+        /*
+            @brief Accepts an incoming connection on the socket without blocking the thread, for use with `co_await` in a task run by an `EventLoop`.
+         !  This function is only available when compiling as C++20.
+            @param success A pointer to a boolean to store whether the connection was successfully accepted.
+            @return An awaitable that yields the accepted socket.
+         */
+        AsyncAccept asyncAccept(bool* success = nullptr);
+
+        /*
+            @brief Connects the socket to the specified server address without blocking the thread, for use with `co_await` in a task run by an `EventLoop`.
+         !  This function is only available when compiling as C++20.
+            @param serverAddress The address of the server to connect to.
+            @param success A pointer to a boolean to store whether the connection was successful.
+            @return An awaitable that completes once the connection is established or has failed.
+         */
+        AsyncConnect asyncConnect(Address serverAddress, bool* success = nullptr);
+    #endif
+
+    private:
+        friend class ServerTCP;
+        friend class ServerUDP;
+        friend class ClientTCP;
+        friend class ClientUDP;
+        friend class EventLoop;
+        friend class Resolver;
+        friend class AsyncReceive;
+        friend class AsyncSend;
+        friend class AsyncAccept;
+        friend class AsyncConnect;
+        friend class ClientTCPPool;
+        template<typename Handler, int BufferSize> friend class BasicServerTCP;
+        template<typename Handler, int BufferSize> friend class BasicServerUDP;
+
+        Address m_addr;
+        Protocol m_proto;
+
+    #ifdef GNET_OS_WINDOWS
         SOCKET m_bSocket;
         SOCKADDR_IN m_bAddr;
         int m_bAddrSize;
@@ -302,8 +1058,116 @@ namespace Garnet
     #endif
 
         bool m_open;
+
+        // makes a thread blocked in accept() or a receive on this socket return, so that it can be joined before the socket is closed
+        void interrupt();
+
+        // single non-blocking attempts behind the awaitable operations, which set `wouldBlock` when the socket is not ready yet.
+        // a connect is begun with beginConnect() and, if that would block, finished with endConnect() once the socket is writable
+        int tryReceive(void* buffer, int bufferSize, bool* wouldBlock);
+        int trySend(const void* data, int size, bool* wouldBlock);
+        Socket tryAccept(bool* wouldBlock, bool* success);
+        bool beginConnect(Address serverAddress, bool* wouldBlock);
+        bool endConnect();
+
+        // waits up to `timeoutMs` for any of the `pending` connects begun with beginConnect() and finishes those that are done,
+        // clearing their `pending` flag and storing the outcome in `connected`. returns how many finished
+        static int finishConnects(Socket* const* sockets, int count, bool* pending, bool* connected, int timeoutMs);
+    };
+
+    /*
+        @brief A class to wait for many sockets on one thread, calling back (or resuming coroutine tasks) once they are ready.
+        This is what drives the `async...()` operations of `Socket` and `ClientTCP`: they register the socket they wait for with the loop
+        running on the awaiting thread (epoll on Linux, poll elsewhere), so thousands of connections can each be served by straight-line code in a task
+        instead of a thread each.
+     !  Only `post()` and `stop()` may be called from other threads. Everything else must be called from the thread running `run()`.
+     */
+    class EventLoop
+    {
+    public:
+        /*
+            @brief Creates an event loop.
+            @param success A pointer to a boolean to store whether the event loop was successfully created.
+         */
+        EventLoop(bool* success = nullptr);
+
+        /*
+            @brief Destroys the event loop.
+         !  The loop must not be running. Callbacks that are still waiting are dropped without being called, and tasks started with `spawn()`
+         !  that have not finished are destroyed where they are suspended, along with the tasks they await, without being resumed.
+         */
+        ~EventLoop();
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        /*
+            @brief Runs the loop on the calling thread, calling posted functions and readiness callbacks as they come.
+         !  This is a blocking function - it will return once `stop()` is called.
+         */
+        void run();
+
+        /*
+            @brief Makes `run()` return after the callbacks that are already due. Can be called from any thread.
+            Waiting callbacks and suspended tasks are kept, and carry on if `run()` is called again.
+         */
+        void stop();
+
+        /*
+            @brief Queues a function to be called by the loop's thread. Can be called from any thread.
+            @param function The function to call.
+         */
+        void post(std::function<void()> function);
+
+        /*
+            @brief Calls a function once the socket has data to receive, a pending connection or an error (it is called only once).
+            @param socket The socket to wait for. It must stay open until the callback is called.
+            @param callback The function to call.
+            @param success A pointer to a boolean to store whether the wait was successfully registered. There can only be one waiting reader per socket.
+         */
+        void waitReadable(const Socket& socket, std::function<void()> callback, bool* success = nullptr);
+
+        /*
+            @brief Calls a function once the socket can be written to, has connected or has an error (it is called only once).
+            @param socket The socket to wait for. It must stay open until the callback is called.
+            @param callback The function to call.
+            @param success A pointer to a boolean to store whether the wait was successfully registered. There can only be one waiting writer per socket.
+         */
+        void waitWritable(const Socket& socket, std::function<void()> callback, bool* success = nullptr);
+
+        /*
+            @brief Gets the event loop running on the calling thread.
+            @return The event loop whose `run()` is executing on this thread, or nullptr if there is none.
+         */
+        static EventLoop* getCurrent();
+
+    #ifdef GNET_COROUTINES
+        /*
+            @brief Starts a task on the loop's thread and lets it run on its own, destroying it once it finishes.
+            An exception that escapes the task terminates the program, as with `std::thread`.
+         !  This function is only available when compiling as C++20.
+            @param task The task to start.
+         */
+        void spawn(Task<void> task);
+    #endif
+
+    private:
+        struct State; // the poller, the waiting callbacks and the posted functions, defined in Garnet.cpp
+        State* m_state;
+
+        void wait(const Socket& socket, bool writable, std::function<void()> callback, bool* success);
+
+        // spawned tasks that have not finished yet, by frame address, so that the destructor can destroy them
+        friend struct TaskPromiseBase;
+        void addTask(void* frame, void (*destroy)(void* frame));
+        void removeTask(void* frame);
     };
 
+    // the executor behind `setNumWorkerThreads()` and the ring behind `IOModel::IOUring`, internal to Garnet.cpp
+    class WorkerPool;
+    class Strand;
+    class IOUring;
+
     /*
         @brief A class to represent a TCP server.
         This class provides a simple but comprehensive interface for creating and managing TCP servers.
@@ -325,9 +1189,15 @@ namespace Garnet
          */
         ServerTCP(Address serverAddress, bool* success = nullptr);
 
+        /*
+            @brief Destroys the server, closing it first if it is still open.
+         */
+        ~ServerTCP();
+
         /*
             @brief Opens the server for incoming connections.
             This function starts listening for incoming connects and starts the thread that coninuously accepts them.
+            If more than one accept shard was set with `setNumAcceptShards()`, one listening socket and accepting thread is created per shard.
             @param backlog The maximum number of pending connections. Default is 10.
             @param success A pointer to a boolean to store whether the server was successfully opened.
          */
@@ -335,7 +1205,9 @@ namespace Garnet
 
         /*
             @brief Sends data to the specified client.
-         !  This function will throw an error if the client address is not in the list of connected clients.
+            With `IOModel::Reactor` or `IOModel::IOUring`, this never blocks: whatever the socket cannot take right away is queued and written by the reactor
+            once the client can receive more (see `setWriteQueueLimits()`). With `IOModel::ThreadPerClient`, it blocks until the data is sent.
+         !  If the client address is not in the list of connected clients, nothing is sent and `success` is set to false.
             @param data The data to send.
             @param size The size of the data in bytes.
             @param clientAddress The address of the client to send the data to.
@@ -343,8 +1215,95 @@ namespace Garnet
          */
         void send(void* data, int size, Address clientAddress, bool* success = nullptr);
 
+        /*
+            @brief Sends the contents of several spans to the specified client in order, without copying them into one buffer.
+         !  If the client address is not in the list of connected clients, nothing is sent and `success` is set to false.
+            @param spans The spans to send.
+            @param count The number of spans.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(const Span* spans, int count, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends data to every connected client, optionally except one.
+            The client list is walked once without locking (a client connecting or disconnecting meanwhile may or may not be included),
+            and the data is copied once into a pooled buffer that every client's write queue shares with `IOModel::Reactor` or `IOModel::IOUring`,
+            so the cost per client is one non-blocking write. With `IOModel::ThreadPerClient`, the clients are sent to one after another with blocking writes.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param excludeClientAddress The address of a client to leave out, e.g. the one the data came from. An empty address leaves out no one.
+            @param success A pointer to a boolean to store whether the data was successfully sent to every client.
+         */
+        void broadcast(void* data, int size, Address excludeClientAddress = Address(), bool* success = nullptr);
+
+        /*
+            @brief Sends data to each of the specified clients, the same way as `broadcast()`.
+            Addresses of clients that are not connected are skipped.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param clientAddresses The addresses of the clients to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent to every connected client in the list.
+         */
+        void multicast(void* data, int size, const std::vector<Address>& clientAddresses, bool* success = nullptr);
+
+        /*
+            @brief Sends data to the specified client without copying it into the kernel. Linux only.
+            The data must stay alive and unmodified until the zero-copy callback is called with the returned token.
+         !  This function requires `setZeroCopyEnabled(true)` to have been called before `open()`.
+            With `IOModel::Reactor` or `IOModel::IOUring`, the data goes through the client's write queue like any other send, so it never interleaves
+            with data sent before or after it, and the function does not block. The data then also has to stay alive until the zero-copy callback.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent, or queued with `IOModel::Reactor` or `IOModel::IOUring`.
+            @return The completion token of this send, unique per client.
+         */
+        unsigned int sendZeroCopy(void* data, int size, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends part of a file to the specified client without reading it into user memory (see `Socket::sendFile()`).
+         !  With `IOModel::ThreadPerClient`, this is a blocking function - call it from your own thread for large files, not from a receive callback.
+            With `IOModel::Reactor` or `IOModel::IOUring`, the range goes through the client's write queue like any other send, so it never interleaves
+            with data sent before or after it, and the function does not block. It counts towards the write queue size and watermarks,
+            and the client is disconnected if the file turns out shorter than the range by the time it is sent.
+         !  If the client address is not in the list of connected clients, nothing is sent and `success` is set to false.
+            @param path The path of the file to send.
+            @param clientAddress The address of the client to send the file to.
+            @param offset The offset in the file to start sending from, in bytes.
+            @param length The number of bytes to send. If negative, the rest of the file from `offset` is sent.
+            @param success A pointer to a boolean to store whether the whole range was successfully sent, or queued with `IOModel::Reactor` or `IOModel::IOUring`.
+         */
+        void sendFile(const std::string& path, Address clientAddress, long long offset = 0, long long length = -1, bool* success = nullptr);
+
+        /*
+            @brief Sends part of an already open file to the specified client without reading it into user memory (see `Socket::sendFile()`).
+         !  With `IOModel::ThreadPerClient`, this is a blocking function - call it from your own thread for large files, not from a receive callback.
+            With `IOModel::Reactor` or `IOModel::IOUring`, the range goes through the client's write queue like any other send, so it never interleaves
+            with data sent before or after it, and the function does not block. It counts towards the write queue size and watermarks,
+            and the client is disconnected if the file turns out shorter than the range by the time it is sent.
+         !  If the client address is not in the list of connected clients, nothing is sent and `success` is set to false.
+            @param fileDescriptor The file descriptor of the file to send (from `open()`, or `_open()` on Windows).
+            @param clientAddress The address of the client to send the file to.
+            @param offset The offset in the file to start sending from, in bytes.
+            @param length The number of bytes to send. If negative, the rest of the file from `offset` is sent.
+            @param success A pointer to a boolean to store whether the whole range was successfully sent, or queued with `IOModel::Reactor` or `IOModel::IOUring`.
+         */
+        void sendFile(int fileDescriptor, Address clientAddress, long long offset = 0, long long length = -1, bool* success = nullptr);
+
+        /*
+            @brief Disconnects the specified client, e.g. a slow reader whose write queue keeps growing.
+            The disconnect callback is called once the client's receiving thread or reactor has noticed.
+            @param clientAddress The address of the client to disconnect.
+            @param success A pointer to a boolean to store whether the client was found and disconnected.
+         */
+        void disconnectClient(Address clientAddress, bool* success = nullptr);
+
         /*
             @brief Closes the server and and clears client data (does not affect the actual clients).
+            The accepting, receiving and reactor threads are woken and joined, and callbacks already queued for worker threads are run, before this function returns.
+            When called from a callback running on a reactor thread, that reactor releases its connections itself once the callback returns.
+            When called from a callback running on a worker thread, the callbacks still queued are run after this function returns, and the workers then stop on their own.
          !  This function should always be called when the server is no longer needed.
             @param success A pointer to a boolean to store whether the server was successfully closed.
          */
@@ -371,13 +1330,50 @@ namespace Garnet
 
         /*
             @brief Gets the socket representing the accepted connection with the client at the specified address.
-         !  This function will throw an error if the client address is not in the list of connected clients.
+            The socket is a copy, so it stays valid after the client disconnects, but its descriptor is closed by then.
+            @param clientAddress The address of the client.
+            @param success A pointer to a boolean to store whether the client is connected.
+            @return A copy of the socket representing the accepted connection with the client, or an empty socket if the client is not connected.
+         */
+        Socket getClientAcceptedSocket(Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Gets the addresses of all connected clients.
+            @return A copy of the addresses of all connected clients, across all accept shards.
+         */
+        std::list<Address> getClientAddresses() const;
+
+        /*
+            @brief Gets a map of the addresses of all connected clients to their accepted sockets.
+            @return A copy of the client map, across all accept shards.
+         */
+        std::unordered_map<Address, Socket> getClientMap() const;
+
+        /*
+            @brief Gets the I/O model of the server.
+            @return The I/O model of the server.
+         */
+        IOModel getIOModel() const;
+
+        /*
+            @brief Gets the number of accept shards.
+            @return The number of listening sockets / accepting threads the server opens with.
+         */
+        int getNumAcceptShards() const;
+
+        /*
+            @brief Gets the number of worker threads that run the callbacks.
+            @return The number of worker threads, or 0 if the callbacks run on the I/O threads.
+         */
+        int getNumWorkerThreads() const;
+
+        /*
+            @brief Gets the number of bytes queued for the specified client that the socket has not taken yet.
+            Always 0 with `IOModel::ThreadPerClient`, where sends block instead of queueing.
             @param clientAddress The address of the client.
-            @return The socket representing the accepted connection with the client.
+            @return The size of the client's write queue in bytes.
          */
-        Socket& getClientAcceptedSocket(Address clientAddress);
-        const std::list<Address>& getClientAddresses() const;
-        const std::unordered_map<Address, Socket>& getClientMap() const;
+        int getWriteQueueSize(Address clientAddress) const;
 
         /*
             @brief Sets the size of the receiving buffer.
@@ -386,18 +1382,112 @@ namespace Garnet
          */
         void setBufferSize(int size);
 
+        /*
+            @brief Sets the I/O model used to serve connected clients.
+            The default is `IOModel::ThreadPerClient`. With `IOModel::Reactor`, accepted sockets are made non-blocking and spread across `nThreads` reactor threads,
+            and the receive, client connect and client disconnect callbacks are called from those threads.
+            With `IOModel::IOUring`, each of the `nThreads` threads owns an io_uring instead: the listening sockets take multishot accepts, every client one multishot receive
+            into a ring of provided buffers, and queued writes are flushed with submitted sends, so one system call submits and completes the work of many clients.
+            If io_uring is not available when `open()` is called (an older kernel, or blocked by a seccomp policy), the server falls back to `IOModel::ThreadPerClient`,
+            which `getIOModel()` then reports, and the last error says why.
+         !  This function must be called before `open()`.
+            @param model The I/O model to use.
+            @param nThreads The number of reactor or io_uring threads. If 0, the number of hardware threads is used. Ignored for `IOModel::ThreadPerClient`.
+            @param success A pointer to a boolean to store whether the I/O model was successfully set.
+         */
+        void setIOModel(IOModel model, int nThreads = 0, bool* success = nullptr);
+
+        /*
+            @brief Sets the number of accept shards.
+            The default is 1. With more than one shard, `open()` creates that many listening sockets bound to the server address with SO_REUSEPORT,
+            each with its own accepting thread pinned to a core and its own client table, and the kernel spreads incoming connections across them. Linux only.
+         !  This function must be called before `open()`.
+            @param nShards The number of accept shards. If 0, the number of hardware threads is used.
+            @param success A pointer to a boolean to store whether the number of shards was successfully set.
+         */
+        void setNumAcceptShards(int nShards, bool* success = nullptr);
+
+        /*
+            @brief Sets the number of worker threads that run the receive, client connect and client disconnect callbacks.
+            The default is 0, which calls them straight from the receiving threads or reactors. With worker threads, those threads only read
+            and queue the data, and a work-stealing pool runs the callbacks, so a slow handler no longer holds up reading for its client
+            (or for every client of a reactor). Each client's callbacks still run one at a time and in the order the data arrived,
+            ending with the disconnect callback. The zero-copy and watermark callbacks are always called directly.
+         !  This function must be called before `open()`.
+            @param nThreads The number of worker threads. If 0, no pool is used.
+            @param success A pointer to a boolean to store whether the number of worker threads was successfully set.
+         */
+        void setNumWorkerThreads(int nThreads, bool* success = nullptr);
+
+        /*
+            @brief Sets whether accepted client sockets are set up for `sendZeroCopy()`. Linux only.
+            The default is false. Zero-copy sends only pay off for large payloads (100 KB and up); small ones cost more to track than to copy.
+         !  This function must be called before `open()`.
+            @param enabled True to enable zero-copy sends, false to disable them.
+            @param success A pointer to a boolean to store whether zero-copy sends were successfully enabled or disabled.
+         */
+        void setZeroCopyEnabled(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sets the socket options of the listening sockets and of every client socket accepted, e.g. `SocketOptions::lowLatency()`.
+            By default, no options are set beyond the system defaults.
+         !  This function must be called before `open()`.
+            @param options The socket options.
+            @param success A pointer to a boolean to store whether the socket options were successfully set.
+         */
+        void setSocketOptions(const SocketOptions& options, bool* success = nullptr);
+
+        /*
+            @brief Sets up busy-poll receiving: before each blocking receive, a client's receiving thread spins on non-blocking checks for up to `spinMicroseconds`,
+            so that data arriving within that time is picked up without the wakeup of a sleeping thread. The thread only blocks once the budget is spent.
+            Accepted sockets also get SO_BUSY_POLL (see `Socket::setBusyPoll()`) on Linux. The reactor I/O model spins on its epoll instance instead; the io_uring I/O model does not spin.
+         !  This function must be called before `open()`. With thread-per-client, every client's thread spins on its own, so keep the budget short or the clients few.
+            @param spinMicroseconds The spin budget in microseconds. 0 (the default) turns busy polling off.
+            @param success A pointer to a boolean to store whether busy polling was successfully set up.
+         */
+        void setBusyPoll(int spinMicroseconds, bool* success = nullptr);
+
+        /*
+            @brief Gets the busy-poll counters of all of the server's receiving threads, to tune the spin budget with.
+            @return The busy-poll counters.
+         */
+        BusyPollStats getBusyPollStats() const;
+
+        /*
+            @brief Sets whether the server exchanges length-prefixed messages instead of raw stream data.
+            The default is false. In framed mode, every `send()` goes out as one message (a 4-byte big-endian length, then the data),
+            and the receive callback gets exactly one complete message per call, reassembled per client. Messages that arrive whole in one read
+            are passed on without copying; `getBufferSize()` then only sets how much is read at a time. `sendZeroCopy()` and `sendFile()` stay unframed.
+            A client that announces a message larger than `maxMessageSize` is disconnected.
+         !  This function must be called before `open()`.
+            @param enabled True to enable framed mode, false to disable it.
+            @param maxMessageSize The largest message a client may send, in bytes.
+            @param success A pointer to a boolean to store whether framed mode was successfully enabled or disabled.
+         */
+        void setFramingEnabled(bool enabled, int maxMessageSize = 16 * 1024 * 1024, bool* success = nullptr);
+
+        /*
+            @brief Sets the limits of the per-client write queues used with `IOModel::Reactor` and `IOModel::IOUring`.
+            The defaults are 256 KB (low), 1 MB (high) and no maximum. When a client's queue grows to `highWatermark` bytes, the high watermark callback is called;
+            once the reactor has drained it back to `lowWatermark` bytes, the low watermark callback is called. Use these to stop and resume sending to that client.
+            A send that would grow the queue past `maxSize` fails, and the client is disconnected as a reader that cannot keep up.
+            @param lowWatermark The queue size in bytes at or below which a client is considered writable again.
+            @param highWatermark The queue size in bytes at or above which a client is considered backed up.
+            @param maxSize The largest the queue may grow in bytes. If 0, there is no maximum.
+            @param success A pointer to a boolean to store whether the limits were successfully set.
+         */
+        void setWriteQueueLimits(int lowWatermark, int highWatermark, int maxSize = 0, bool* success = nullptr);
+
         /*
             @brief Sets the receive callback function.
-         !  THE USER IS RESPONSIBLE FOR DELETING THE BUFFER IF A CALLBACK IS USED.
             This function will be called whenever data is received from a client.
             @param callback The receive callback function. The callback function should adhere to the following signature:
-            `void callback(void* buffer, int size, int actualSize, Address fromClientAddress);`
-            - `buffer`: A buffer created (on the heap) by the library holding the data received. This should be deleted when done.
-            - `bufferSize`: The size of the given data in bytes.
-            - `actualSize`: The original size of the data that was sent from the client (regardless of `bufferSize`), in bytes.
+            `void callback(const Buffer& buffer, int actualSize, Address fromClientAddress);`
+            - `buffer`: A pooled buffer holding the data received, of size `getBufferSize()` (or the message size in framed mode). It is recycled when the callback returns, unless the handle is copied.
+            - `actualSize`: The original size of the data that was sent from the client (regardless of the buffer size), in bytes.
             - `fromClientAddress`: The address of the client that sent the data.
          */
-        void setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize, Address fromClientAddress));
+        void setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize, Address fromClientAddress));
 
         /*
             @brief Sets the client connect callback function.
@@ -417,6 +1507,34 @@ namespace Garnet
          */
         void setClientDisconnectCallback(void (*callback)(Address clientAddress));
 
+        /*
+            @brief Sets the zero-copy callback function.
+            This function will be called whenever the kernel releases the buffer of a `sendZeroCopy()` call, from the reactor or receiving thread of that client.
+            @param callback The zero-copy callback function. The callback function should adhere to the following signature:
+            `void callback(unsigned int token, Address clientAddress);`
+            - `token`: The token returned by `sendZeroCopy()`. Its buffer may now be reused or freed.
+            - `clientAddress`: The address of the client the data was sent to.
+         */
+        void setZeroCopyCallback(void (*callback)(unsigned int token, Address clientAddress));
+
+        /*
+            @brief Sets the high watermark callback function.
+            This function will be called from the sending thread whenever a client's write queue grows to the high watermark.
+            @param callback The high watermark callback function. The callback function should adhere to the following signature:
+            `void callback(Address clientAddress);`
+            - `clientAddress`: The address of the client that is not keeping up.
+         */
+        void setHighWatermarkCallback(void (*callback)(Address clientAddress));
+
+        /*
+            @brief Sets the low watermark callback function.
+            This function will be called from the reactor whenever a client's write queue that had reached the high watermark drains to the low watermark.
+            @param callback The low watermark callback function. The callback function should adhere to the following signature:
+            `void callback(Address clientAddress);`
+            - `clientAddress`: The address of the client that can be sent to again.
+         */
+        void setLowWatermarkCallback(void (*callback)(Address clientAddress));
+
     private:
         Address m_addr;
         Socket m_socket;
@@ -424,21 +1542,67 @@ namespace Garnet
         std::atomic<int> m_bufSize;
         std::atomic<int> m_nClients;
 
-        std::list<Address> m_clientAddrs;
-        std::unordered_map<Address, Socket> m_clientMap;
-        std::mutex m_clientAddrsMtx;
-        std::mutex m_clientMapMtx;
-
         std::atomic<bool> m_open;
 
-        void accept();
-        void receive(Socket acceptedSocket);
-        std::thread m_accepting;
-        std::vector<std::thread> m_receivings;
-
-        void (*m_pReceiveCallback)(void* buffer, int bufferSize, int actualSize, Address fromAddr);
+        struct Shard;
+        struct Connection;
+        struct Reactor;
+        struct WriteItem;
+
+        IOModel m_ioModel;
+        int m_nIOThreads;
+        std::vector<Reactor*> m_reactors;
+        std::atomic<unsigned int> m_nextReactor;
+
+        int m_nAcceptShards;
+        std::vector<Shard*> m_shards;
+
+        void accept(Shard* shard);
+        void receive(Shard* shard, Socket acceptedSocket, std::shared_ptr<Strand> strand);
+        void react(Reactor* reactor);
+        void reactRing(Reactor* reactor);
+        bool openReactors();
+        void closeReactors();
+        void adopt(Reactor* reactor, const std::shared_ptr<Connection>& conn);
+        void acceptRing(Reactor* reactor, Shard* shard, int clientSocket);
+        bool receiveRing(Connection* conn, const void* data, int size);
+        void flushRing(Reactor* reactor, Connection* conn);
+        void disconnectRing(Reactor* reactor, Connection* conn);
+        bool findClient(const Address& clientAddr, Socket* clientSocket);
+        std::shared_ptr<Connection> findConnection(const Address& clientAddr) const;
+        void addClient(Shard* shard, const Socket& acceptedSocket, const std::shared_ptr<Connection>& conn = nullptr);
+        void removeClient(Shard* shard, const Address& clientAddr, Strand* strand = nullptr);
+        void deliver(Strand* strand, const Buffer& buffer, int size, const Address& clientAddr);
+
+        int m_nWorkers;
+        WorkerPool* m_workers;
+
+        int m_lowWatermark;
+        int m_highWatermark;
+        int m_maxWriteQueueSize;
+        void queueWrite(Connection* conn, const Span* spans, int count, bool* success, const Buffer* payload = nullptr);
+        void queueWrite(Connection* conn, WriteItem& item, bool* success);
+        void requestFlush(Connection* conn);
+        void sendToAll(void* data, int size, const Address* exclude, const std::vector<Address>* only, bool* success);
+        void flushWrites(Connection* conn);
+        void completeZeroCopy(Socket& clientSocket);
+
+        bool m_zeroCopy;
+        bool m_framed;
+        int m_maxMessageSize;
+        SocketOptions m_socketOptions;
+        BusyPoll m_busyPoll;
+
+        // receiving threads without a receive callback wait on this instead of spinning
+        std::mutex m_callbackMtx;
+        std::condition_variable m_callbackCv;
+
+        void (*m_pReceiveCallback)(const Buffer& buffer, int actualSize, Address fromAddr);
         void (*m_pClientConnectCallback)(Address clientAddr);
         void (*m_pClientDisconnectCallback)(Address clientAddr);
+        void (*m_pZeroCopyCallback)(unsigned int token, Address clientAddr);
+        void (*m_pHighWatermarkCallback)(Address clientAddr);
+        void (*m_pLowWatermarkCallback)(Address clientAddr);
     };
 
     /*
@@ -462,6 +1626,11 @@ namespace Garnet
          */
         ServerUDP(Address serverAddress, bool* success = nullptr);
 
+        /*
+            @brief Destroys the server, closing it first if it is still open.
+         */
+        ~ServerUDP();
+
         /*
             @brief Opens the server for incoming connections.
             This function starts the thread that continuously receives data.
@@ -478,8 +1647,46 @@ namespace Garnet
          */
         void send(void* data, int size, Address clientAddress, bool* success = nullptr);
 
+        /*
+            @brief Sends data to the specified pre-resolved client endpoint.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param clientEndpoint The endpoint of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(void* data, int size, const Endpoint& clientEndpoint, bool* success = nullptr);
+
+        /*
+            @brief Sends the contents of several spans to the specified client as a single datagram.
+            @param spans The spans that make up the datagram.
+            @param count The number of spans.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(const Span* spans, int count, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends a large buffer to the specified client as a series of equal-sized datagrams, segmented by the kernel where UDP GSO is available.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param segmentSize The size of each datagram in bytes.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether all of the data was successfully sent.
+         */
+        void sendSegmented(void* data, int size, int segmentSize, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends multiple datagrams, each to its own client, in as few system calls as possible.
+            @param datagrams The datagrams to send. Only `data`, `size` and `address` are used.
+            @param count The number of datagrams.
+            @param success A pointer to a boolean to store whether all of the datagrams were successfully sent.
+         */
+        void sendBatch(const Datagram* datagrams, int count, bool* success = nullptr);
+
         /*
             @brief Closes the server.
+            The receiving thread is woken and joined, and callbacks already queued for worker threads are run, before this function returns.
+            When called from a callback running on a worker thread, the callbacks still queued are run after this function returns, and the workers then stop on their own.
          !  This function should always be called when the server is no longer needed.
             @param success A pointer to a boolean to store whether the server was successfully closed.
          */
@@ -505,18 +1712,99 @@ namespace Garnet
          */
         void setBufferSize(int size);
 
+        /*
+            @brief Sets whether incoming datagrams may be coalesced by the kernel (UDP GRO). Linux only. Disabled by default.
+            Coalesced data is split back into its original datagrams, and the receive callback is still called once per datagram, with a slice of a shared pooled buffer.
+            With the batch receive callback, each coalesced burst is split the same way and passed on in batches of up to `batchSize` datagrams,
+            so a batch then only holds datagrams from one sender, read with one system call per burst instead of recvmmsg.
+            @param enabled True to enable GRO, false to disable it.
+            @param success A pointer to a boolean to store whether GRO was successfully enabled or disabled.
+         */
+        void setGROEnabled(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sets the socket options of the server's socket, e.g. `SocketOptions::bulkThroughput()` for larger receive buffers.
+            @param options The socket options.
+            @param success A pointer to a boolean to store whether the socket options were successfully set.
+         */
+        void setSocketOptions(const SocketOptions& options, bool* success = nullptr);
+
+        /*
+            @brief Sets up busy-poll receiving for latency-critical traffic. Disabled by default.
+            Before each blocking receive, the receiving thread first spins on non-blocking checks of the socket for up to `spinMicroseconds`,
+            picking up datagrams that arrive meanwhile without paying for the wakeup of a sleeping thread, and only blocks once the budget is spent.
+            On Linux, the socket also gets SO_BUSY_POLL and SO_PREFER_BUSY_POLL (see `Socket::setBusyPoll()`), so that the spinning polls the network device directly.
+            If only those fail (e.g. for lack of CAP_NET_ADMIN), the thread still spins. Receiving through io_uring does not spin.
+         !  The receiving thread keeps a core busy while it spins. Use `getBusyPollStats()` to check that the hit rate is worth it.
+            @param spinMicroseconds The spin budget in microseconds. 0 turns busy polling off.
+            @param success A pointer to a boolean to store whether busy polling was successfully set up, including the socket options on Linux.
+         */
+        void setBusyPoll(int spinMicroseconds, bool* success = nullptr);
+
+        /*
+            @brief Gets the busy-poll counters of the receiving thread, to tune the spin budget with.
+            @return The busy-poll counters.
+         */
+        BusyPollStats getBusyPollStats() const;
+
+        /*
+            @brief Sets whether the server receives through io_uring. Linux 6.0 or later. Disabled by default.
+            With io_uring, the receiving thread keeps one multishot receive armed on the socket, into a ring of provided buffers,
+            and hands everything that completed by the time it wakes up to the callbacks, so a burst of datagrams costs one system call instead of one each.
+            With the batch receive callback, those datagrams are passed on in batches of up to `batchSize`. GRO is not combined with io_uring:
+            with `setGROEnabled(true)`, the server keeps receiving with blocking calls. If io_uring is not available when `open()` is called,
+            the server falls back to blocking calls as well, which `isIOUringEnabled()` then reports, and the last error says why.
+         !  This function must be called before `open()`.
+            @param enabled True to receive through io_uring, false to use blocking calls.
+            @param success A pointer to a boolean to store whether the setting was successfully changed.
+         */
+        void setIOUringEnabled(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Checks whether the server receives through io_uring.
+            @return True if io_uring was enabled and, once the server is open, is in use.
+         */
+        bool isIOUringEnabled() const;
+
+        /*
+            @brief Sets the number of worker threads that run the receive and batch receive callbacks.
+            The default is 0, which calls them straight from the receiving thread. With worker threads, the receiving thread only reads
+            and queues the datagrams, and a work-stealing pool runs the callbacks, so a slow handler no longer stops the server from reading.
+            Datagrams from the same client are still handled one at a time and in the order they arrived; a batch is split up by client for this.
+         !  This function must be called before `open()`.
+            @param nThreads The number of worker threads. If 0, no pool is used.
+            @param success A pointer to a boolean to store whether the number of worker threads was successfully set.
+         */
+        void setNumWorkerThreads(int nThreads, bool* success = nullptr);
+
+        /*
+            @brief Gets the number of worker threads that run the callbacks.
+            @return The number of worker threads, or 0 if the callbacks run on the receiving thread.
+         */
+        int getNumWorkerThreads() const;
+
         /*
             @brief Sets the receive callback function.
-         !  THE USER IS RESPONSIBLE FOR DELETING THE BUFFER IF A CALLBACK IS USED.
             This function will be called whenever data is received from a client.
             @param callback The receive callback function. The callback function should adhere to the following signature:
-            `void callback(void* buffer, int size, int actualSize, Address fromClientAddress);`
-            - `buffer`: A buffer created (on the heap) by the library holding the data received. This should be deleted when done.
-            - `bufferSize`: The size of the given data in bytes.
-            - `actualSize`: The original size of the data that was sent from the client (regardless of `bufferSize`), in bytes.
+            `void callback(const Buffer& buffer, int actualSize, Address fromClientAddress);`
+            - `buffer`: A pooled buffer holding the data received, of size `getBufferSize()`. It is recycled when the callback returns, unless the handle is copied.
+            - `actualSize`: The original size of the data that was sent from the client (regardless of the buffer size), in bytes.
             - `fromClientAddress`: The address of the client that sent the data.
          */
-        void setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize, Address fromClientAddress));
+        void setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize, Address fromClientAddress));
+
+        /*
+            @brief Sets the batch receive callback function.
+            When set, the receiving thread pulls up to `batchSize` datagrams per system call (recvmmsg on Linux) and hands them all to this callback at once,
+            instead of calling the receive callback once per datagram. Set it to `nullptr` to go back to the receive callback.
+            @param callback The batch receive callback function. The callback function should adhere to the following signature:
+            `void callback(const Datagram* datagrams, int count);`
+            - `datagrams`: The datagrams received, each with its data, size, sender address and pooled buffer (of size `getBufferSize()`).
+            - `count`: The number of datagrams received.
+            @param batchSize The maximum number of datagrams per batch. Default is 32.
+         */
+        void setBatchReceiveCallback(void (*callback)(const Datagram* datagrams, int count), int batchSize = 32);
 
     private:
         Address m_addr;
@@ -524,17 +1812,237 @@ namespace Garnet
 
         std::atomic<int> m_bufSize;
         std::atomic<bool> m_open;
+        std::atomic<int> m_batchSize;
+        std::atomic<bool> m_gro;
+        BusyPoll m_busyPoll;
 
         void receive();
+        void receiveRing();
+        void receiveCoalescedBatch(void (*callback)(const Datagram* datagrams, int count), std::vector<Datagram>& batch);
+        void deliverBatch(void (*callback)(const Datagram* datagrams, int count), const Datagram* datagrams, int count);
         std::thread m_receiving;
 
-        void (*m_pReceiveCallback)(void* buffer, int bufferSize, int actualSize, Address fromAddr);
+        bool m_ioUring;
+        IOUring* m_ring;
+
+        int m_nWorkers;
+        WorkerPool* m_workers;
+        std::vector<std::shared_ptr<Strand>> m_strands; // clients are hashed onto these to keep their datagrams in order
+        Strand* getStrand(const Address& clientAddr) const;
+
+        // the receiving thread waits on this instead of spinning while neither callback is set
+        std::mutex m_callbackMtx;
+        std::condition_variable m_callbackCv;
+
+        void (*m_pReceiveCallback)(const Buffer& buffer, int actualSize, Address fromAddr);
+        void (*m_pBatchReceiveCallback)(const Datagram* datagrams, int count);
     };
 
     /*
-        @brief A class to represent a TCP client.
-        This class provides a simple but comprehensive interface for creating and managing TCP clients.
-        The client is multithreaded to allow for concurrent receiving of data.
+        @brief An empty handler for `BasicServerTCP` and `BasicServerUDP` to derive from.
+        A handler only needs to redefine the callbacks it uses; the rest fall back to these, which do nothing.
+        Since the server calls its handler directly rather than through a function pointer, the compiler can inline the callbacks.
+     */
+    struct ServerHandler
+    {
+        /*
+            @brief Called whenever data is received from a client.
+            @param data The data received, in a buffer on the receiving thread's stack. It is only valid until the callback returns.
+            @param actualSize The original size of the data that was sent from the client (regardless of the buffer size), in bytes.
+            @param fromClientAddress The address of the client that sent the data.
+         */
+        void onReceive(const void* /* data */, int /* actualSize */, Address /* fromClientAddress */) {}
+
+        /*
+            @brief Called whenever a client connects to the server (TCP only).
+            @param clientAddress The address of the client that connected.
+         */
+        void onConnect(Address /* clientAddress */) {}
+
+        /*
+            @brief Called whenever a client disconnects from the server (TCP only).
+            @param clientAddress The address of the client that disconnected.
+         */
+        void onDisconnect(Address /* clientAddress */) {}
+    };
+
+    /*
+        @brief A class to represent a TCP server whose callbacks are fixed at compile time.
+        This is a leaner `ServerTCP` for hot paths: each client gets a receiving thread that reads into a `BufferSize`-byte buffer on its own stack
+        and calls `Handler::onReceive()` directly, with no pooled buffer, function pointer or user pointer lookup per message.
+        The handler lives in the server and holds whatever state the callbacks need (see `getHandler()`).
+        For the reactor I/O model, accept sharding, framing, write queues or worker threads, use `ServerTCP`.
+        @tparam Handler A type with `onReceive()`, `onConnect()` and `onDisconnect()` members, usually derived from `ServerHandler`.
+        @tparam BufferSize The size of the receiving buffer in bytes.
+     */
+    template<typename Handler, int BufferSize = 256>
+    class BasicServerTCP
+    {
+    public:
+        static_assert(BufferSize > 0, "BasicServerTCP: BufferSize must be positive");
+
+        /*
+            @brief Creates an empty TCP server.
+            Should not be actually used to create or manage a server.
+         */
+        BasicServerTCP();
+
+        /*
+            @brief Creates a TCP server with the specified server address.
+            @param serverAddress The address of the server.
+            @param success A pointer to a boolean to store whether the server was successfully created.
+         */
+        BasicServerTCP(Address serverAddress, bool* success = nullptr);
+
+        /*
+            @brief Destroys the server, closing it first if it is still open.
+         */
+        ~BasicServerTCP();
+
+        /*
+            @brief Opens the server for incoming connections.
+            This function starts listening for incoming connects and starts the thread that coninuously accepts them.
+            @param backlog The maximum number of pending connections. Default is 10.
+            @param success A pointer to a boolean to store whether the server was successfully opened.
+         */
+        void open(int backlog = 10, bool* success = nullptr);
+
+        /*
+            @brief Sends data to the specified client. This is a blocking function.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(void* data, int size, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Closes the server, disconnecting every client and waiting for the accepting and receiving threads to finish.
+            The disconnect callback is not called for the clients disconnected this way.
+            @param success A pointer to a boolean to store whether the server was successfully closed.
+         */
+        void close(bool* success = nullptr);
+
+        /*
+            @brief Checks whether the server is open.
+            The server is considered 'open' if `open()` was called and `close()` was not.
+            @return True if the server is open, false otherwise.
+         */
+        bool isOpen() const;
+
+        /*
+            @brief Gets the number of connected clients.
+            @return The number of connected clients.
+         */
+        int getNumClients() const;
+
+        /*
+            @brief Gets the handler whose members are called as callbacks.
+            Set up its state through this before calling `open()`; afterwards, it is accessed from the accepting and receiving threads.
+            @return A reference to the handler.
+         */
+        Handler& getHandler();
+
+    private:
+        Address m_addr;
+        Socket m_socket;
+        Handler m_handler;
+
+        std::atomic<bool> m_open;
+        std::thread m_accepting;
+
+        std::unordered_map<Address, Socket> m_clients;
+        std::unordered_map<std::thread::id, std::thread> m_receivings;
+        std::vector<std::thread::id> m_finishedReceivings;  // receiving threads of clients that have left, joined by the accepting thread
+        mutable std::mutex m_clientsMtx;
+
+        void accept();
+        void receive(Socket acceptedSocket);
+    };
+
+    /*
+        @brief A class to represent a UDP server whose callbacks are fixed at compile time.
+        This is a leaner `ServerUDP` for hot paths: the receiving thread reads each datagram into a `BufferSize`-byte buffer on its own stack
+        and calls `Handler::onReceive()` directly, with no pooled buffer, function pointer or user pointer lookup per datagram.
+        For GRO, batch receiving or worker threads, use `ServerUDP`.
+        @tparam Handler A type with an `onReceive()` member, usually derived from `ServerHandler`.
+        @tparam BufferSize The size of the receiving buffer in bytes.
+     */
+    template<typename Handler, int BufferSize = 256>
+    class BasicServerUDP
+    {
+    public:
+        static_assert(BufferSize > 0, "BasicServerUDP: BufferSize must be positive");
+
+        /*
+            @brief Creates an empty UDP server.
+            Should not be actually used to create or manage a server.
+         */
+        BasicServerUDP();
+
+        /*
+            @brief Creates a UDP server with the specified server address.
+            @param serverAddress The address of the server.
+            @param success A pointer to a boolean to store whether the server was successfully created.
+         */
+        BasicServerUDP(Address serverAddress, bool* success = nullptr);
+
+        /*
+            @brief Destroys the server, closing it first if it is still open.
+         */
+        ~BasicServerUDP();
+
+        /*
+            @brief Opens the server for incoming connections.
+            This function starts the thread that continuously receives data.
+            @param success A pointer to a boolean to store whether the server was successfully opened.
+         */
+        void open(bool* success = nullptr);
+
+        /*
+            @brief Sends data to the specified client.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param clientAddress The address of the client to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(void* data, int size, Address clientAddress, bool* success = nullptr);
+
+        /*
+            @brief Closes the server, waiting for the receiving thread to finish.
+            @param success A pointer to a boolean to store whether the server was successfully closed.
+         */
+        void close(bool* success = nullptr);
+
+        /*
+            @brief Checks whether the server is open.
+            The server is considered 'open' if `open()` was called and `close()` was not.
+            @return True if the server is open, false otherwise.
+         */
+        bool isOpen() const;
+
+        /*
+            @brief Gets the handler whose `onReceive()` member is called as the receive callback.
+            Set up its state through this before calling `open()`; afterwards, it is accessed from the receiving thread.
+            @return A reference to the handler.
+         */
+        Handler& getHandler();
+
+    private:
+        Address m_addr;
+        Socket m_socket;
+        Handler m_handler;
+
+        std::atomic<bool> m_open;
+        std::thread m_receiving;
+
+        void receive();
+    };
+
+    /*
+        @brief A class to represent a TCP client.
+        This class provides a simple but comprehensive interface for creating and managing TCP clients.
+        The client is multithreaded to allow for concurrent receiving of data.
      */
     class ClientTCP
     {
@@ -550,6 +2058,11 @@ namespace Garnet
             @param success A pointer to a boolean to store whether the client was successfully created.
          */
         ClientTCP(char dummyPutAnything, bool* success = nullptr);
+
+        /*
+            @brief Destroys the client, disconnecting it first if it is still connected.
+         */
+        ~ClientTCP();
         
         /*
             @brief Connects the client to the specified server address.
@@ -558,6 +2071,53 @@ namespace Garnet
          */
         void connect(Address serverAddress, bool* success = nullptr);
 
+        /*
+            @brief Connects the client to the specified server address, giving up once `timeoutMs` milliseconds have passed.
+            If the connection fails, the client gets a fresh socket so that it can simply try again.
+            @param serverAddress The address of the server to connect to.
+            @param timeoutMs The longest time to wait for the connection, in milliseconds. -1 waits as long as the system does.
+            @param success A pointer to a boolean to store whether the connection was successful.
+         */
+        void connect(Address serverAddress, int timeoutMs, bool* success = nullptr);
+
+        /*
+            @brief Connects the client to a server by name, racing the addresses the name resolves to ("Happy Eyeballs", RFC 8305).
+            The first address is tried right away, and every 250 ms without a connection (or as soon as an attempt fails) the next one is tried
+            alongside the ones still in flight. The first connection to succeed is kept and the others are abandoned,
+            so one dead address does not cost a whole connect timeout.
+         !  Only IPv4 addresses are raced, since sockets are IPv4 only.
+            @param host The hostname / domain name or IP address of the server.
+            @param port The port of the server.
+            @param timeoutMs The longest time to wait for a connection overall, in milliseconds. -1 waits as long as the system does.
+            @param success A pointer to a boolean to store whether the connection was successful.
+         */
+        void connect(const std::string& host, ushort port, int timeoutMs, bool* success = nullptr);
+
+        /*
+            @brief Connects many clients to the same server concurrently, e.g. to warm up a pool of connections.
+            All of the connects are started at once and then awaited together on the calling thread, so the whole batch takes about as long as its slowest connect
+            rather than the sum of them all. Every client that connects starts receiving, just like after `connect()`; the others get a fresh socket.
+            @param clients The clients to connect. They must not be connected yet.
+            @param count The number of clients.
+            @param serverAddress The address of the server to connect to.
+            @param timeoutMs The longest time to wait for the whole batch, in milliseconds. -1 waits as long as the system does.
+            @param results An optional array of `count` booleans to store whether each client was successfully connected.
+            @return The number of clients that were successfully connected.
+         */
+        static int connectMany(ClientTCP* const* clients, int count, Address serverAddress, int timeoutMs = -1, bool* results = nullptr);
+
+    #ifdef GNET_COROUTINES
+        /*
+            @brief Connects the client to the specified server address without blocking the thread, for use with `co_await` in a task run by an `EventLoop`.
+            Once connected, the client receives on its own thread and calls the receive callback, just like after `connect()`.
+         !  This function is only available when compiling as C++20.
+            @param serverAddress The address of the server to connect to.
+            @param success A pointer to a boolean to store whether the connection was successful.
+            @return An awaitable that completes once the connection is established or has failed.
+         */
+        AsyncConnect asyncConnect(Address serverAddress, bool* success = nullptr);
+    #endif
+
         /*
             @brief Sends data to the server.
             @param data The data to send.
@@ -566,8 +2126,28 @@ namespace Garnet
          */
         void send(void* data, int size, bool* success = nullptr);
 
+        /*
+            @brief Sends the contents of several spans to the server in order, without copying them into one buffer.
+            @param spans The spans to send.
+            @param count The number of spans.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(const Span* spans, int count, bool* success = nullptr);
+
+        /*
+            @brief Sends data to the server without copying it into the kernel. Linux only.
+            The data must stay alive and unmodified until the zero-copy callback is called with the returned token.
+         !  This function requires `setZeroCopyEnabled(true)` to have been called.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+            @return The completion token of this send.
+         */
+        unsigned int sendZeroCopy(void* data, int size, bool* success = nullptr);
+
         /*
             @brief Disconnects the client.
+            The receiving thread is woken and joined before this function returns (unless it is called from a callback, i.e. from that thread).
          !  This function should always be called when the client is no longer needed.
             @param success A pointer to a boolean to store whether the client was successfully disconnected.
          */
@@ -593,17 +2173,91 @@ namespace Garnet
          */
         void setBufferSize(int size);
 
+        /*
+            @brief Sets whether the client exchanges length-prefixed messages instead of raw stream data.
+            The default is false. In framed mode, every `send()` goes out as one message (a 4-byte big-endian length, then the data),
+            and the receive callback gets exactly one complete message per call. Messages that arrive whole in one read are passed on without copying;
+            `getBufferSize()` then only sets how much is read at a time. `sendZeroCopy()` stays unframed.
+            If the server announces a message larger than `maxMessageSize`, the connection is shut down.
+         !  This function must be called before `connect()`.
+            @param enabled True to enable framed mode, false to disable it.
+            @param maxMessageSize The largest message the server may send, in bytes.
+            @param success A pointer to a boolean to store whether framed mode was successfully enabled or disabled.
+         */
+        void setFramingEnabled(bool enabled, int maxMessageSize = 16 * 1024 * 1024, bool* success = nullptr);
+
         /*
             @brief Sets the receive callback function.
-         !  THE USER IS RESPONSIBLE FOR DELETING THE BUFFER IF A CALLBACK IS USED.
             This function will be called whenever data is received from the server.
             @param callback The receive callback function. The callback function should adhere to the following signature:
-            `void callback(void* buffer, int size, int actualSize);`
-            - `buffer`: A buffer created (on the heap) by the library holding the data received. This should be deleted when done.
-            - `bufferSize`: The size of the given data in bytes.
-            - `actualSize`: The original size of the data that was sent from the server (regardless of `bufferSize`), in bytes.
+            `void callback(const Buffer& buffer, int actualSize);`
+            - `buffer`: A pooled buffer holding the data received, of size `getBufferSize()` (or the message size in framed mode). It is recycled when the callback returns, unless the handle is copied.
+            - `actualSize`: The original size of the data that was sent from the server (regardless of the buffer size), in bytes.
+         */
+        void setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize));
+
+        /*
+            @brief Sets a receive callback function that is also told which client received the data, for when many clients share one callback (e.g. a `ClientTCPPool`).
+            It is called instead of the callback set with `setReceiveCallback()`, if both are set.
+            @param callback The receive callback function. The callback function should adhere to the following signature:
+            `void callback(ClientTCP& client, const Buffer& buffer, int actualSize);`
+            - `client`: The client that received the data. Its user pointer (see `setUserPtr()`) can lead to the state of whoever is using it.
+            - `buffer`: A pooled buffer holding the data received, as with `setReceiveCallback()`.
+            - `actualSize`: The original size of the data that was sent from the server (regardless of the buffer size), in bytes.
+         */
+        void setClientReceiveCallback(void (*callback)(ClientTCP& client, const Buffer& buffer, int actualSize));
+
+        /*
+            @brief Sets a pointer of the user's own for this client, unlike `SetUserPtr()`, which is global.
+            @param ptr The pointer to set.
+         */
+        void setUserPtr(void* ptr);
+
+        /*
+            @brief Gets the pointer set with `setUserPtr()`.
+            @return The user pointer of this client, nullptr by default.
+         */
+        void* getUserPtr() const;
+
+        /*
+            @brief Sets whether the client's socket is set up for `sendZeroCopy()`. Linux only.
+            The default is false. Zero-copy sends only pay off for large payloads (100 KB and up); small ones cost more to track than to copy.
+            @param enabled True to enable zero-copy sends, false to disable them.
+            @param success A pointer to a boolean to store whether zero-copy sends were successfully enabled or disabled.
          */
-        void setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize));
+        void setZeroCopyEnabled(bool enabled, bool* success = nullptr);
+
+        /*
+            @brief Sets the socket options of the client's socket, e.g. `SocketOptions::lowLatency()`, and of any socket it creates to reconnect.
+            Set buffer sizes before connecting, as they bound the TCP window.
+            @param options The socket options.
+            @param success A pointer to a boolean to store whether the socket options were successfully set.
+         */
+        void setSocketOptions(const SocketOptions& options, bool* success = nullptr);
+
+        /*
+            @brief Sets up busy-poll receiving: before each blocking receive, the receiving thread spins on non-blocking checks for up to `spinMicroseconds`,
+            so that a response arriving within that time is handled without the wakeup of a sleeping thread. Disabled by default.
+            On Linux, the socket also gets SO_BUSY_POLL (see `Socket::setBusyPoll()`); if only that fails, the thread still spins.
+            @param spinMicroseconds The spin budget in microseconds. 0 turns busy polling off.
+            @param success A pointer to a boolean to store whether busy polling was successfully set up, including the socket options on Linux.
+         */
+        void setBusyPoll(int spinMicroseconds, bool* success = nullptr);
+
+        /*
+            @brief Gets the busy-poll counters of the receiving thread, to tune the spin budget with.
+            @return The busy-poll counters.
+         */
+        BusyPollStats getBusyPollStats() const;
+
+        /*
+            @brief Sets the zero-copy callback function.
+            This function will be called whenever the kernel releases the buffer of a `sendZeroCopy()` call, from the receiving thread or from `sendZeroCopy()` itself.
+            @param callback The zero-copy callback function. The callback function should adhere to the following signature:
+            `void callback(unsigned int token);`
+            - `token`: The token returned by `sendZeroCopy()`. Its buffer may now be reused or freed.
+         */
+        void setZeroCopyCallback(void (*callback)(unsigned int token));
 
     private:
         Socket m_socket;
@@ -614,87 +2268,1182 @@ namespace Garnet
         void receive(); // receive() and callback while true until error (from server or client closure)
         std::thread m_receiving;
 
-        void (*m_pReceiveCallback)(void* buffer, int bufferSize, int actualSize);
+        friend class AsyncConnect;
+        friend class ClientTCPPool;
+        friend class ClientRPC;
+        void onConnected(); // marks the client connected and starts the receiving thread, after connect() or asyncConnect()
+        void resetSocket(); // replaces the socket after a failed connect, which may have left it unusable
+        void createSocket(); // creates a new socket with the client's zero-copy and socket options
+        std::atomic<bool> m_receiveEnded; // set once the receiving thread has stopped, e.g. because the server closed the connection
+        void* m_poolEntry; // the ClientTCPPool entry the client belongs to, if pooled
+        std::atomic<void*> m_userPtr;
+
+        // the receiving thread waits on this instead of spinning while there is no receive callback
+        std::mutex m_callbackMtx;
+        std::condition_variable m_callbackCv;
+
+        void (*m_pReceiveCallback)(const Buffer& buffer, int actualSize);
+        void (*m_pClientReceiveCallback)(ClientTCP& client, const Buffer& buffer, int actualSize);
+        void (*m_pReceiveEndedCallback)(ClientTCP& client); // called by the receiving thread as it stops
+
+        void completeZeroCopy();
+        std::atomic<bool> m_zeroCopy;
+        SocketOptions m_socketOptions;
+        BusyPoll m_busyPoll;
+
+        bool m_framed;
+        int m_maxMessageSize;
+        void (*m_pZeroCopyCallback)(unsigned int token);
     };
 
     /*
-        @brief A class to represent a UDP client.
-        This class provides a simple but comprehensive interface for creating and managing UDP clients.
-        The client is multithreaded to allow for concurrent receiving of data.
+        @brief A class to keep connected `ClientTCP`s around for reuse, so that a request does not cost a handshake, a receiving thread and an ephemeral port each.
+        Clients are pooled per server address: `checkout()` hands out an idle client to that address (the most recently returned one, whose
+        connection is the warmest), or connects a new one while there are fewer than the maximum, and `checkin()` puts it back.
+        A background thread checks the idle clients every `setHealthCheckInterval()` milliseconds: clients whose server has closed the connection are dropped,
+        clients idle for longer than `setIdleTimeout()` are disconnected as long as the minimum stays open, and the pool is topped up to the minimum.
+        All functions can be called from any thread.
      */
-    class ClientUDP
+    class ClientTCPPool
     {
     public:
         /*
-            @brief Creates an empty UDP client.
-            Should not be actually used to create or manage a client.
+            @brief Creates a connection pool.
+            @param minSize The number of connections per server address to keep open even when idle.
+            @param maxSize The largest number of connections per server address, idle or checked out.
          */
-        ClientUDP();
+        ClientTCPPool(int minSize = 0, int maxSize = 64);
 
         /*
-            @brief Creates a UDP client.
-            @param dummyPutAnything A dummy parameter to differentiate this constructor from the default constructor. Put anything!
-            @param success A pointer to a boolean to store whether the client was successfully created.
+            @brief Destroys the pool, disconnecting and deleting its idle clients.
+         !  Every checked out client must have been returned with `checkin()` before.
          */
-        ClientUDP(char dummyPutAnything, bool* success = nullptr);
+        ~ClientTCPPool();
+
+        ClientTCPPool(const ClientTCPPool&) = delete;
+        ClientTCPPool& operator=(const ClientTCPPool&) = delete;
 
         /*
-            @brief Sends data to the server.
-            @param data The data to send.
-            @param size The size of the data in bytes.
-            @param serverAddress The address of the server to send the data to.
-            @param success A pointer to a boolean to store whether the data was successfully sent.
+            @brief Takes a connected client to the specified server address out of the pool, connecting a new one if none is idle.
+         !  If all `maxSize` clients to the address are checked out, this is a blocking function - it will wait for one to be returned.
+            @param serverAddress The address of the server.
+            @param timeoutMs The longest time to wait for a client to be returned, in milliseconds. -1 waits for as long as it takes.
+            @param success A pointer to a boolean to store whether a client was successfully checked out.
+            @return The client, which belongs to the pool, or nullptr if none could be checked out.
          */
-        void send(void* data, int size, Address serverAddress, bool* success = nullptr);
+        ClientTCP* checkout(Address serverAddress, int timeoutMs = -1, bool* success = nullptr);
 
         /*
-            @brief Disconnects the client.
-         *  While the client isn't really connected (since it uses UDP), this function stops the receiving thread and closes the socket.
+            @brief Returns a client taken with `checkout()` to the pool.
+         !  The client must not be used afterwards, and its receive callback must not be expecting anything more from the last request.
+            @param client The client to return.
+            @param reusable False if the client should be disconnected instead of reused, e.g. because its request failed halfway.
          */
-        void disconnect(bool* success = nullptr);
+        void checkin(ClientTCP* client, bool reusable = true);
 
         /*
-            @brief Checks whether the client is connected.
-            The client is considered 'connected' if the constructor with the dummy parameter was used and `disconnect()` was not called.
-            @return True if the client is connected, false otherwise.
+            @brief Connects clients to the specified server address in advance, up to the minimum size, all at once (see `ClientTCP::connectMany()`).
+            Otherwise the pool only reaches its minimum size at the first health check.
+            @param serverAddress The address of the server.
+            @param success A pointer to a boolean to store whether the minimum number of clients are now connected.
          */
-        bool isConnected() const;
+        void warmUp(Address serverAddress, bool* success = nullptr);
 
         /*
-            @brief Gets the size of the receiving buffer.
-            @return The size of the receiving buffer in bytes.
+            @brief Sets a function to set up every new client before it connects, e.g. to set its callbacks, buffer size or framing.
+            @param setup The setup function. The setup function should adhere to the following signature:
+            `void setup(ClientTCP& client);`
          */
-        int getBufferSize() const;
+        void setClientSetup(void (*setup)(ClientTCP& client));
 
         /*
-            @brief Sets the size of the receiving buffer.
-            The default is 256 bytes.
-            @param size The size of the receiving buffer in bytes.
+            @brief Sets how long to wait for a new client to connect.
+            The default is 5000 milliseconds.
+            @param timeoutMs The connect timeout in milliseconds. -1 waits as long as the system does.
          */
-        void setBufferSize(int size);
+        void setConnectTimeout(int timeoutMs);
 
         /*
-            @brief Sets the receive callback function.
-         !  THE USER IS RESPONSIBLE FOR DELETING THE BUFFER IF A CALLBACK IS USED.
-            This function will be called whenever data is received from the server.
-            @param callback The receive callback function. The callback function should adhere to the following signature:
-            `void callback(void* buffer, int size, int actualSize, Address fromServerAddress);`
-            - `buffer`: A buffer created (on the heap) by the library holding the data received. This should be deleted when done.
-            - `bufferSize`: The size of the given data in bytes.
-            - `actualSize`: The original size of the data that was sent from the server (regardless of `bufferSize`), in bytes.
-            - `fromServerAddress`: The address of the server that sent the data.
+            @brief Sets how long a client may stay idle before it is disconnected, as long as `minSize` clients stay open.
+            The default is 60000 milliseconds.
+            @param timeoutMs The idle timeout in milliseconds.
          */
-        void setReceiveCallback(void (*callback)(void* buffer, int bufferSize, int actualSize, Address fromServerAddress));
+        void setIdleTimeout(int timeoutMs);
 
-    private:
-        Socket m_socket;
+        /*
+            @brief Sets how often the idle clients are checked, evicted and topped up.
+            The default is 5000 milliseconds.
+            @param intervalMs The interval in milliseconds.
+         */
+        void setHealthCheckInterval(int intervalMs);
 
-        std::atomic<int> m_bufSize;
-        std::atomic<bool> m_connected;
+        /*
+            @brief Gets the number of idle clients to the specified server address.
+            @param serverAddress The address of the server.
+            @return The number of idle clients.
+         */
+        int getNumIdle(Address serverAddress);
 
-        void receive();
-        std::thread m_receiving;
+        /*
+            @brief Gets the number of open clients to the specified server address, idle or checked out.
+            @param serverAddress The address of the server.
+            @return The number of open clients.
+         */
+        int getNumOpen(Address serverAddress);
 
-        void (*m_pReceiveCallback)(void* buffer, int bufferSize, int actualSize, Address fromAddr);
+    private:
+        struct Entry; // the clients of one server address, defined in Garnet.cpp
+
+        std::shared_mutex m_entriesMtx; // only taken exclusively to add the entry of a new server address
+        std::unordered_map<Address, Entry*> m_entries;
+        Entry* getEntry(Address serverAddress);
+
+        ClientTCP* open(Entry* entry, bool* success); // connects a new client, which the caller has already counted as open
+        void destroy(Entry* entry, ClientTCP* client); // disconnects and deletes a client that no longer counts as open
+        static bool isHealthy(ClientTCP* client, bool pollSocket); // polling also catches a server hang-up that the receiving thread has not seen
+
+        int m_minSize;
+        int m_maxSize;
+        std::atomic<int> m_connectTimeout;
+        std::atomic<int> m_idleTimeout;
+        std::atomic<int> m_healthCheckInterval;
+        std::atomic<void (*)(ClientTCP& client)> m_pClientSetup;
+
+        void checkHealth(); // the maintenance thread: evicts dead and idle clients and tops up every entry, every health check interval
+        std::thread m_checking;
+        std::mutex m_checkingMtx;
+        std::condition_variable m_checkingCv;
+        bool m_closing;
     };
+
+    /*
+        @brief A request/response client over a single `ClientTCP` connection, with any number of requests outstanding at once.
+        Instead of waiting a full round trip before sending the next request, `call()` sends every request right away, tagged with a request ID,
+        and completes its callback or future when the response with the same ID arrives, in whatever order the server answers.
+        Every request goes out as one framed message (see `ClientTCP::setFramingEnabled()`): `HeaderSize` bytes of request ID, then the request data.
+        The server has to answer each one with one framed message that starts with the same `HeaderSize` bytes, followed by the response data,
+        so a `ServerTCP` with framing enabled serves it by sending the first `HeaderSize` bytes of each request back in front of its response.
+        A request fails when it is not answered within its timeout, or when the connection is closed before it is.
+        All functions can be called from any thread.
+     */
+    class ClientRPC
+    {
+    public:
+        static constexpr int HeaderSize = 8; // the size of the request ID in front of every request and response
+
+        /*
+            @brief Creates an RPC client.
+            @param success A pointer to a boolean to store whether the client was successfully created.
+         */
+        ClientRPC(bool* success = nullptr);
+
+        /*
+            @brief Destroys the client, disconnecting it first if it is still connected, which fails its outstanding requests.
+         */
+        ~ClientRPC();
+
+        ClientRPC(const ClientRPC&) = delete;
+        ClientRPC& operator=(const ClientRPC&) = delete;
+
+        /*
+            @brief Connects the client to a server.
+            The client can connect again after `disconnect()` or after the server has closed the connection.
+            @param serverAddress The address of the server to connect to.
+            @param timeoutMs The longest time to wait for the connection, in milliseconds. -1 waits for as long as the system does.
+            @param success A pointer to a boolean to store whether the client successfully connected.
+         */
+        void connect(Address serverAddress, int timeoutMs = -1, bool* success = nullptr);
+
+        /*
+            @brief Disconnects the client from the server. Outstanding requests fail.
+            @param success A pointer to a boolean to store whether the client successfully disconnected.
+         */
+        void disconnect(bool* success = nullptr);
+
+        /*
+            @brief Checks whether the client is connected, i.e. requests can be sent and neither side has closed the connection.
+            @return Whether the client is connected.
+         */
+        bool isConnected() const;
+
+        /*
+            @brief Sends a request, calling a callback once it is answered or has failed.
+            The callback must take the following parameters:
+            `void callback(const Buffer& response, bool success);`
+            - `response`: The response data, without the request ID. It is invalid if the request failed.
+            - `success`: Whether the request was answered, as opposed to timing out, failing to send, or the connection closing first.
+         !  The callback is called on the receiving thread (or the timeout thread, or the calling thread if the request could not be sent),
+            so it should return quickly and must not wait for other responses.
+            @param data The request data.
+            @param size The size of the request data in bytes.
+            @param callback The callback to call with the response.
+            @param timeoutMs The longest time to wait for the response, in milliseconds. -1 waits until the connection is closed.
+         */
+        void call(const void* data, int size, std::function<void(const Buffer& response, bool success)> callback, int timeoutMs = -1);
+
+        /*
+            @brief Sends a request, returning a future for its response.
+            @param data The request data.
+            @param size The size of the request data in bytes.
+            @param timeoutMs The longest time to wait for the response, in milliseconds. -1 waits until the connection is closed.
+            @return A future for the response data, without the request ID. The buffer it holds is invalid if the request failed.
+         */
+        std::future<Buffer> call(const void* data, int size, int timeoutMs = -1);
+
+        /*
+            @brief Gets the number of requests sent that are neither answered nor failed yet.
+            @return The number of outstanding requests.
+         */
+        int getNumOutstanding();
+
+        /*
+            @brief Sets the largest response accepted; a larger one closes the connection. The default is 16 MiB.
+         !  Only takes effect on the next connect.
+            @param size The largest response size in bytes, including the request ID.
+         */
+        void setMaxResponseSize(int size);
+
+    private:
+        struct State; // the outstanding requests and the timeout thread, defined in Garnet.cpp
+        State* m_state;
+        ClientTCP m_client;
+
+        static void onResponse(ClientTCP& client, const Buffer& buffer, int actualSize);
+        static void onReceiveEnded(ClientTCP& client);
+    };
+
+    /*
+        @brief A class to represent a UDP client.
+        This class provides a simple but comprehensive interface for creating and managing UDP clients.
+        The client is multithreaded to allow for concurrent receiving of data.
+     */
+    class ClientUDP
+    {
+    public:
+        /*
+            @brief Creates an empty UDP client.
+            Should not be actually used to create or manage a client.
+         */
+        ClientUDP();
+
+        /*
+            @brief Creates a UDP client.
+            @param dummyPutAnything A dummy parameter to differentiate this constructor from the default constructor. Put anything!
+            @param success A pointer to a boolean to store whether the client was successfully created.
+         */
+        ClientUDP(char dummyPutAnything, bool* success = nullptr);
+
+        /*
+            @brief Destroys the client, disconnecting it first if it is still connected.
+         */
+        ~ClientUDP();
+
+        /*
+            @brief Sends data to the server.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param serverAddress The address of the server to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(void* data, int size, Address serverAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends data to the specified pre-resolved server endpoint.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param serverEndpoint The endpoint of the server to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(void* data, int size, const Endpoint& serverEndpoint, bool* success = nullptr);
+
+        /*
+            @brief Sends the contents of several spans to the specified address as a single datagram.
+            @param spans The spans that make up the datagram.
+            @param count The number of spans.
+            @param serverAddress The address of the server to send the data to.
+            @param success A pointer to a boolean to store whether the data was successfully sent.
+         */
+        void send(const Span* spans, int count, Address serverAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends a large buffer to the specified address as a series of equal-sized datagrams, segmented by the kernel where UDP GSO is available.
+            @param data The data to send.
+            @param size The size of the data in bytes.
+            @param segmentSize The size of each datagram in bytes.
+            @param serverAddress The address of the server to send the data to.
+            @param success A pointer to a boolean to store whether all of the data was successfully sent.
+         */
+        void sendSegmented(void* data, int size, int segmentSize, Address serverAddress, bool* success = nullptr);
+
+        /*
+            @brief Sends multiple datagrams, each to its own address, in as few system calls as possible.
+            @param datagrams The datagrams to send. Only `data`, `size` and `address` are used.
+            @param count The number of datagrams.
+            @param success A pointer to a boolean to store whether all of the datagrams were successfully sent.
+         */
+        void sendBatch(const Datagram* datagrams, int count, bool* success = nullptr);
+
+        /*
+            @brief Disconnects the client.
+         *  While the client isn't really connected (since it uses UDP), this function stops the receiving thread and closes the socket.
+            The receiving thread is woken and joined before this function returns (unless it is called from a callback, i.e. from that thread).
+         */
+        void disconnect(bool* success = nullptr);
+
+        /*
+            @brief Checks whether the client is connected.
+            The client is considered 'connected' if the constructor with the dummy parameter was used and `disconnect()` was not called.
+            @return True if the client is connected, false otherwise.
+         */
+        bool isConnected() const;
+
+        /*
+            @brief Gets the size of the receiving buffer.
+            @return The size of the receiving buffer in bytes.
+         */
+        int getBufferSize() const;
+
+        /*
+            @brief Sets the size of the receiving buffer.
+            The default is 256 bytes.
+            @param size The size of the receiving buffer in bytes.
+         */
+        void setBufferSize(int size);
+
+        /*
+            @brief Sets the receive callback function.
+            This function will be called whenever data is received from the server.
+            @param callback The receive callback function. The callback function should adhere to the following signature:
+            `void callback(const Buffer& buffer, int actualSize, Address fromServerAddress);`
+            - `buffer`: A pooled buffer holding the data received, of size `getBufferSize()`. It is recycled when the callback returns, unless the handle is copied.
+            - `actualSize`: The original size of the data that was sent from the server (regardless of the buffer size), in bytes.
+            - `fromServerAddress`: The address of the server that sent the data.
+         */
+        void setReceiveCallback(void (*callback)(const Buffer& buffer, int actualSize, Address fromServerAddress));
+
+        /*
+            @brief Sets the batch receive callback function.
+            When set, the receiving thread pulls up to `batchSize` datagrams per system call (recvmmsg on Linux) and hands them all to this callback at once,
+            instead of calling the receive callback once per datagram. Set it to `nullptr` to go back to the receive callback.
+            @param callback The batch receive callback function. The callback function should adhere to the following signature:
+            `void callback(const Datagram* datagrams, int count);`
+            - `datagrams`: The datagrams received, each with its data, size, sender address and pooled buffer (of size `getBufferSize()`).
+            - `count`: The number of datagrams received.
+            @param batchSize The maximum number of datagrams per batch. Default is 32.
+         */
+        void setBatchReceiveCallback(void (*callback)(const Datagram* datagrams, int count), int batchSize = 32);
+
+        /*
+            @brief Sets the socket options of the client's socket, e.g. `SocketOptions::lowLatency()` to mark its datagrams for low delay.
+            @param options The socket options.
+            @param success A pointer to a boolean to store whether the socket options were successfully set.
+         */
+        void setSocketOptions(const SocketOptions& options, bool* success = nullptr);
+
+        /*
+            @brief Sets up busy-poll receiving: before each blocking receive, the receiving thread spins on non-blocking checks for up to `spinMicroseconds`,
+            so that a datagram arriving within that time is handled without the wakeup of a sleeping thread. Disabled by default.
+            On Linux, the socket also gets SO_BUSY_POLL (see `Socket::setBusyPoll()`); if only that fails, the thread still spins.
+            @param spinMicroseconds The spin budget in microseconds. 0 turns busy polling off.
+            @param success A pointer to a boolean to store whether busy polling was successfully set up, including the socket options on Linux.
+         */
+        void setBusyPoll(int spinMicroseconds, bool* success = nullptr);
+
+        /*
+            @brief Gets the busy-poll counters of the receiving thread, to tune the spin budget with.
+            @return The busy-poll counters.
+         */
+        BusyPollStats getBusyPollStats() const;
+
+    private:
+        Socket m_socket;
+        BusyPoll m_busyPoll;
+
+        std::atomic<int> m_bufSize;
+        std::atomic<bool> m_connected;
+        std::atomic<int> m_batchSize;
+
+        void receive();
+        std::thread m_receiving;
+
+        // the receiving thread waits on this instead of spinning while neither callback is set
+        std::mutex m_callbackMtx;
+        std::condition_variable m_callbackCv;
+
+        void (*m_pReceiveCallback)(const Buffer& buffer, int actualSize, Address fromAddr);
+        void (*m_pBatchReceiveCallback)(const Datagram* datagrams, int count);
+    };
+
+#ifdef GNET_COROUTINES
+    /*
+        @brief The parts of a `Task`'s promise that do not depend on its result type.
+     */
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation;   // The coroutine awaiting the task, resumed once it finishes.
+        std::exception_ptr exception;           // The exception that escaped the task, rethrown to the awaiting coroutine.
+        bool detached = false;                  // Set by `EventLoop::spawn()`: nothing awaits the task, so it destroys itself once it finishes.
+        EventLoop* loop = nullptr;              // The loop a detached task was spawned on, which destroys the task instead if it goes first.
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception();
+    };
+
+    template<typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        std::optional<T> result;
+
+        Task<T> get_return_object();
+        void return_value(T value);
+        T takeResult();
+    };
+
+    template<>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() {}
+        void takeResult();
+    };
+
+    /*
+        @brief A coroutine that yields a `T` (or nothing), for code that awaits the `async...()` operations.
+        A task is lazy: it only starts once it is awaited with `co_await`, which suspends the awaiting coroutine until the task finishes
+        and then yields its result (or rethrows its exception). Top-level tasks are started with `EventLoop::spawn()`.
+     !  Tasks are only available when compiling as C++20.
+        @tparam T The type of the result, void by default.
+     */
+    template<typename T>
+    class Task
+    {
+    public:
+        using promise_type = TaskPromise<T>;
+
+        Task(Task&& other) noexcept;
+        Task& operator=(Task&& other) noexcept;
+        ~Task();
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+        T await_resume();
+
+    private:
+        friend struct TaskPromise<T>;
+        friend class EventLoop;
+
+        explicit Task(std::coroutine_handle<promise_type> handle);
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    /*
+        @brief The shared part of the awaitable operations: one attempt before suspending, then another whenever
+        the event loop running on the awaiting thread reports the socket ready, until the operation is done.
+        @tparam Operation The operation, with `attempt()` (true once it is done, successfully or not), `fail()` and `writes`.
+     */
+    template<typename Operation>
+    class AsyncOperation
+    {
+    public:
+        AsyncOperation(const AsyncOperation&) = delete;
+        AsyncOperation& operator=(const AsyncOperation&) = delete;
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> awaiting);
+
+    protected:
+        AsyncOperation(Socket* socket, bool* success);
+
+        Socket* m_socket;
+        bool* m_success;
+
+    private:
+        bool wait(std::coroutine_handle<> awaiting); // false if the operation could not wait and was failed instead
+    };
+
+    /*
+        @brief The awaitable returned by `Socket::asyncReceive()`, yielding the number of bytes received.
+     */
+    class AsyncReceive : public AsyncOperation<AsyncReceive>
+    {
+    public:
+        int await_resume();
+
+    private:
+        friend class Socket;
+        friend class AsyncOperation<AsyncReceive>;
+        static constexpr bool writes = false;
+
+        AsyncReceive(Socket* socket, void* buffer, int bufferSize, bool* success);
+        bool attempt();
+        void fail();
+
+        void* m_buffer;
+        int m_bufferSize;
+        int m_result;
+    };
+
+    /*
+        @brief The awaitable returned by `Socket::asyncSend()`, yielding the number of bytes sent.
+     */
+    class AsyncSend : public AsyncOperation<AsyncSend>
+    {
+    public:
+        int await_resume();
+
+    private:
+        friend class Socket;
+        friend class AsyncOperation<AsyncSend>;
+        static constexpr bool writes = true;
+
+        AsyncSend(Socket* socket, const void* data, int size, bool* success);
+        bool attempt();
+        void fail();
+
+        const char* m_data;
+        int m_size;
+        int m_sent;
+        bool m_failed;
+    };
+
+    /*
+        @brief The awaitable returned by `Socket::asyncAccept()`, yielding the accepted socket.
+     */
+    class AsyncAccept : public AsyncOperation<AsyncAccept>
+    {
+    public:
+        Socket await_resume();
+
+    private:
+        friend class Socket;
+        friend class AsyncOperation<AsyncAccept>;
+        static constexpr bool writes = false;
+
+        AsyncAccept(Socket* socket, bool* success);
+        bool attempt();
+        void fail();
+
+        Socket m_result;
+        bool m_accepted;
+    };
+
+    /*
+        @brief The awaitable returned by `Socket::asyncConnect()` and `ClientTCP::asyncConnect()`.
+     */
+    class AsyncConnect : public AsyncOperation<AsyncConnect>
+    {
+    public:
+        void await_resume();
+
+    private:
+        friend class Socket;
+        friend class ClientTCP;
+        friend class AsyncOperation<AsyncConnect>;
+        static constexpr bool writes = true;
+
+        AsyncConnect(Socket* socket, Address serverAddress, ClientTCP* client, bool* success);
+        bool attempt();
+        void fail();
+
+        Address m_address;
+        ClientTCP* m_client; // the client to start receiving once connected, if connecting one
+        bool m_started;
+        bool m_pending;
+        bool m_connected;
+    };
+#endif
 };
+
+/*
+    BasicServerTCP / BasicServerUDP implementation, which has to live in the header since they are templates.
+    Apart from `Socket::interrupt()`, which wakes the blocked threads on close, only the public `Socket` interface is used.
+ */
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerTCP<Handler, BufferSize>::BasicServerTCP()
+{
+    m_addr = Address();
+    m_open = false;
+}
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerTCP<Handler, BufferSize>::BasicServerTCP(Address addr, bool* success)
+{
+    m_addr = addr;
+    m_open = false;
+    bool successA, successB = false;
+    m_socket = Socket(Protocol::TCP, &successA);
+    if (successA) m_socket.bind(addr, &successB);
+    if (success != nullptr) *success = successA && successB;
+}
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerTCP<Handler, BufferSize>::~BasicServerTCP()
+{
+    if (m_open) close();
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerTCP<Handler, BufferSize>::open(int backlog, bool* success)
+{
+    if (m_open)
+    {
+        SetLastError("Failed to open BasicServerTCP: already open");
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    bool successA;
+    m_socket.listen(backlog, &successA);
+    if (!successA)
+    {
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_open = true;
+    m_accepting = std::thread(&BasicServerTCP::accept, this);
+    if (success != nullptr) *success = true;
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerTCP<Handler, BufferSize>::send(void* data, int size, Address clientAddr, bool* success)
+{
+    Socket clientSocket;
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMtx);
+        auto it = m_clients.find(clientAddr);
+        if (it == m_clients.end())
+        {
+            SetLastError("BasicServerTCP send failed: client is not connected");
+            if (success != nullptr) *success = false;
+            return;
+        }
+        clientSocket = it->second;
+    }
+
+    clientSocket.send(data, size, success);
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerTCP<Handler, BufferSize>::close(bool* success)
+{
+    if (!m_open)
+    {
+        SetLastError("Failed to close BasicServerTCP: not open yet or already closed");
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    // wake the accepting thread, which then sees the server closed and drops the connection that wakes it where shutdown() cannot
+    m_open = false;
+    m_socket.interrupt();
+    m_accepting.join();
+
+    // shutting the clients down makes their blocked receives return, so the receiving threads can be joined
+    std::unordered_map<std::thread::id, std::thread> receivings;
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMtx);
+        for (auto& entry : m_clients) entry.second.shutdown();
+        receivings.swap(m_receivings);
+        m_finishedReceivings.clear();
+    }
+    for (auto& entry : receivings) entry.second.join();
+
+    for (auto& entry : m_clients) entry.second.close();
+    m_clients.clear();
+    m_socket.close();
+    if (success != nullptr) *success = true;
+}
+
+template<typename Handler, int BufferSize>
+bool Garnet::BasicServerTCP<Handler, BufferSize>::isOpen() const
+{
+    return m_open;
+}
+
+template<typename Handler, int BufferSize>
+int Garnet::BasicServerTCP<Handler, BufferSize>::getNumClients() const
+{
+    std::lock_guard<std::mutex> lock(m_clientsMtx);
+    return (int)m_clients.size();
+}
+
+template<typename Handler, int BufferSize>
+Handler& Garnet::BasicServerTCP<Handler, BufferSize>::getHandler()
+{
+    return m_handler;
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerTCP<Handler, BufferSize>::accept()
+{
+    while (m_open)
+    {
+        bool success;
+        Socket acceptedSocket = m_socket.accept(&success);
+        if (!success) continue;
+        if (!m_open)
+        {
+            acceptedSocket.close();
+            break;
+        }
+
+        // start the receiving thread only after onConnect(), so that it always comes before the client's first onReceive()
+        m_clientsMtx.lock();
+        m_clients.insert({ acceptedSocket.getAddress(), acceptedSocket });
+        m_clientsMtx.unlock();
+        m_handler.onConnect(acceptedSocket.getAddress());
+
+        std::lock_guard<std::mutex> lock(m_clientsMtx);
+
+        // join the threads of clients that have left meanwhile, so that they don't pile up over the server's lifetime
+        for (std::thread::id finished : m_finishedReceivings)
+        {
+            auto it = m_receivings.find(finished);
+            if (it == m_receivings.end()) continue;
+            it->second.join();
+            m_receivings.erase(it);
+        }
+        m_finishedReceivings.clear();
+
+        std::thread receiving(&BasicServerTCP::receive, this, acceptedSocket);
+        std::thread::id id = receiving.get_id();
+        m_receivings.insert({ id, std::move(receiving) });
+    }
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerTCP<Handler, BufferSize>::receive(Socket acceptedSocket)
+{
+    char buf[BufferSize];
+    Address clientAddr = acceptedSocket.getAddress();
+    while (true)
+    {
+        bool success;
+        int nBytes = acceptedSocket.receive(buf, BufferSize, &success);
+        if (!success || nBytes == 0) break;
+        m_handler.onReceive(buf, nBytes, clientAddr);
+    }
+
+    // on close, the server itself tears the client down
+    if (!m_open) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMtx);
+        m_clients.erase(clientAddr);
+    }
+    acceptedSocket.close();
+    m_handler.onDisconnect(clientAddr);
+
+    // this is the thread's last use of the server, so the accepting thread can join it from now on
+    std::lock_guard<std::mutex> lock(m_clientsMtx);
+    m_finishedReceivings.push_back(std::this_thread::get_id());
+}
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerUDP<Handler, BufferSize>::BasicServerUDP()
+{
+    m_addr = Address();
+    m_open = false;
+}
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerUDP<Handler, BufferSize>::BasicServerUDP(Address addr, bool* success)
+{
+    m_addr = addr;
+    m_open = false;
+    bool successA, successB = false;
+    m_socket = Socket(Protocol::UDP, &successA);
+    if (successA) m_socket.bind(addr, &successB);
+    if (success != nullptr) *success = successA && successB;
+}
+
+template<typename Handler, int BufferSize>
+Garnet::BasicServerUDP<Handler, BufferSize>::~BasicServerUDP()
+{
+    if (m_open) close();
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerUDP<Handler, BufferSize>::open(bool* success)
+{
+    if (m_open)
+    {
+        SetLastError("Failed to open BasicServerUDP: already open");
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    m_open = true;
+    m_receiving = std::thread(&BasicServerUDP::receive, this);
+    if (success != nullptr) *success = true;
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerUDP<Handler, BufferSize>::send(void* data, int size, Address clientAddr, bool* success)
+{
+    m_socket.sendTo(data, size, clientAddr, success);
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerUDP<Handler, BufferSize>::close(bool* success)
+{
+    if (!m_open)
+    {
+        SetLastError("Failed to close BasicServerUDP: not open yet or already closed");
+        if (success != nullptr) *success = false;
+        return;
+    }
+
+    // wake the receiving thread, which sees the server closed
+    m_open = false;
+    m_socket.interrupt();
+    m_receiving.join();
+
+    m_socket.close();
+    if (success != nullptr) *success = true;
+}
+
+template<typename Handler, int BufferSize>
+bool Garnet::BasicServerUDP<Handler, BufferSize>::isOpen() const
+{
+    return m_open;
+}
+
+template<typename Handler, int BufferSize>
+Handler& Garnet::BasicServerUDP<Handler, BufferSize>::getHandler()
+{
+    return m_handler;
+}
+
+template<typename Handler, int BufferSize>
+void Garnet::BasicServerUDP<Handler, BufferSize>::receive()
+{
+    char buf[BufferSize];
+    while (m_open)
+    {
+        bool success;
+        Address from;
+        int nBytes = m_socket.receiveFrom(buf, BufferSize, &from, &success);
+        if (!success || !m_open) continue;
+        m_handler.onReceive(buf, nBytes, from);
+    }
+}
+
+#ifdef GNET_COROUTINES
+
+/*
+    Coroutine implementation, which has to live in the header since the library itself is built as C++17.
+    The awaitable operations only use the private non-blocking attempts of `Socket` and the event loop of the awaiting thread.
+ */
+
+template<typename Promise>
+std::coroutine_handle<> Garnet::TaskPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) noexcept
+{
+    TaskPromiseBase& promise = handle.promise();
+    if (promise.detached)
+    {
+        promise.loop->removeTask(handle.address());
+        handle.destroy();
+        return std::noop_coroutine();
+    }
+
+    // symmetric transfer, so that long chains of tasks finishing synchronously don't grow the stack
+    return promise.continuation ? promise.continuation : std::noop_coroutine();
+}
+
+inline void Garnet::TaskPromiseBase::unhandled_exception()
+{
+    if (detached) std::terminate();
+    exception = std::current_exception();
+}
+
+template<typename T>
+Garnet::Task<T> Garnet::TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+template<typename T>
+void Garnet::TaskPromise<T>::return_value(T value)
+{
+    result.emplace(std::move(value));
+}
+
+template<typename T>
+T Garnet::TaskPromise<T>::takeResult()
+{
+    if (exception) std::rethrow_exception(exception);
+    return std::move(*result);
+}
+
+inline Garnet::Task<void> Garnet::TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+inline void Garnet::TaskPromise<void>::takeResult()
+{
+    if (exception) std::rethrow_exception(exception);
+}
+
+template<typename T>
+Garnet::Task<T>::Task(std::coroutine_handle<promise_type> handle)
+{
+    m_handle = handle;
+}
+
+template<typename T>
+Garnet::Task<T>::Task(Task&& other) noexcept
+{
+    m_handle = std::exchange(other.m_handle, nullptr);
+}
+
+template<typename T>
+Garnet::Task<T>& Garnet::Task<T>::operator=(Task&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_handle) m_handle.destroy();
+        m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+}
+
+template<typename T>
+Garnet::Task<T>::~Task()
+{
+    if (m_handle) m_handle.destroy();
+}
+
+template<typename T>
+std::coroutine_handle<> Garnet::Task<T>::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    m_handle.promise().continuation = awaiting;
+    return m_handle;
+}
+
+template<typename T>
+T Garnet::Task<T>::await_resume()
+{
+    return m_handle.promise().takeResult();
+}
+
+inline void Garnet::EventLoop::spawn(Task<void> task)
+{
+    std::coroutine_handle<TaskPromise<void>> handle = std::exchange(task.m_handle, nullptr);
+    handle.promise().detached = true;
+    handle.promise().loop = this;
+    addTask(handle.address(), [](void* frame) { std::coroutine_handle<>::from_address(frame).destroy(); });
+    post([handle]() { handle.resume(); });
+}
+
+template<typename Operation>
+Garnet::AsyncOperation<Operation>::AsyncOperation(Socket* socket, bool* success)
+{
+    m_socket = socket;
+    m_success = success;
+}
+
+template<typename Operation>
+bool Garnet::AsyncOperation<Operation>::await_ready()
+{
+    return static_cast<Operation*>(this)->attempt();
+}
+
+template<typename Operation>
+bool Garnet::AsyncOperation<Operation>::await_suspend(std::coroutine_handle<> awaiting)
+{
+    return wait(awaiting);
+}
+
+template<typename Operation>
+bool Garnet::AsyncOperation<Operation>::wait(std::coroutine_handle<> awaiting)
+{
+    EventLoop* loop = EventLoop::getCurrent();
+    if (loop == nullptr)
+    {
+        SetLastError("Async socket operation failed: it has to be awaited on the thread of a running EventLoop");
+        static_cast<Operation*>(this)->fail();
+        return false;
+    }
+
+    // once the socket is ready, try again, and either resume the task or wait some more
+    auto retry = [this, awaiting]()
+    {
+        if (static_cast<Operation*>(this)->attempt() || !wait(awaiting)) awaiting.resume();
+    };
+
+    bool success;
+    if (Operation::writes) loop->waitWritable(*m_socket, retry, &success);
+    else loop->waitReadable(*m_socket, retry, &success);
+    if (!success) static_cast<Operation*>(this)->fail();
+    return success;
+}
+
+inline Garnet::AsyncReceive::AsyncReceive(Socket* socket, void* buffer, int bufferSize, bool* success) : AsyncOperation(socket, success)
+{
+    m_buffer = buffer;
+    m_bufferSize = bufferSize;
+    m_result = -1;
+}
+
+inline bool Garnet::AsyncReceive::attempt()
+{
+    bool wouldBlock;
+    m_result = m_socket->tryReceive(m_buffer, m_bufferSize, &wouldBlock);
+    return !wouldBlock;
+}
+
+inline void Garnet::AsyncReceive::fail()
+{
+    m_result = -1;
+}
+
+inline int Garnet::AsyncReceive::await_resume()
+{
+    if (m_success != nullptr) *m_success = m_result != -1;
+    return m_result;
+}
+
+inline Garnet::AsyncSend::AsyncSend(Socket* socket, const void* data, int size, bool* success) : AsyncOperation(socket, success)
+{
+    m_data = (const char*)data;
+    m_size = size;
+    m_sent = 0;
+    m_failed = false;
+}
+
+inline bool Garnet::AsyncSend::attempt()
+{
+    while (m_sent < m_size)
+    {
+        bool wouldBlock;
+        int nBytes = m_socket->trySend(m_data + m_sent, m_size - m_sent, &wouldBlock);
+        if (wouldBlock) return false;
+        if (nBytes == -1)
+        {
+            m_failed = true;
+            return true;
+        }
+        m_sent += nBytes;
+    }
+    return true;
+}
+
+inline void Garnet::AsyncSend::fail()
+{
+    m_failed = true;
+}
+
+inline int Garnet::AsyncSend::await_resume()
+{
+    if (m_success != nullptr) *m_success = !m_failed;
+    return m_failed ? -1 : m_sent;
+}
+
+inline Garnet::AsyncAccept::AsyncAccept(Socket* socket, bool* success) : AsyncOperation(socket, success)
+{
+    m_accepted = false;
+}
+
+inline bool Garnet::AsyncAccept::attempt()
+{
+    bool wouldBlock;
+    m_result = m_socket->tryAccept(&wouldBlock, &m_accepted);
+    return !wouldBlock;
+}
+
+inline void Garnet::AsyncAccept::fail()
+{
+    m_accepted = false;
+}
+
+inline Garnet::Socket Garnet::AsyncAccept::await_resume()
+{
+    if (m_success != nullptr) *m_success = m_accepted;
+    return m_result;
+}
+
+inline Garnet::AsyncConnect::AsyncConnect(Socket* socket, Address serverAddress, ClientTCP* client, bool* success) : AsyncOperation(socket, success)
+{
+    m_address = serverAddress;
+    m_client = client;
+    m_started = false;
+    m_pending = false;
+    m_connected = false;
+}
+
+inline bool Garnet::AsyncConnect::attempt()
+{
+    if (!m_started)
+    {
+        m_started = true;
+        if (m_client != nullptr && m_client->isConnected())
+        {
+            SetLastError("Failed to connect ClientTCP: already connected");
+            return true;
+        }
+
+        m_connected = m_socket->beginConnect(m_address, &m_pending);
+        if (m_pending) return false;
+    }
+    else
+    {
+        m_pending = false;
+        m_connected = m_socket->endConnect();
+    }
+
+    if (m_connected && m_client != nullptr) m_client->onConnected();
+    return true;
+}
+
+inline void Garnet::AsyncConnect::fail()
+{
+    // put the socket back into blocking mode if the connect was left in progress
+    if (m_pending) m_socket->setBlocking(true);
+    m_pending = false;
+    m_connected = false;
+}
+
+inline void Garnet::AsyncConnect::await_resume()
+{
+    if (m_success != nullptr) *m_success = m_connected;
+}
+
+inline Garnet::AsyncReceive Garnet::Socket::asyncReceive(void* buffer, int bufferSize, bool* success)
+{
+    return AsyncReceive(this, buffer, bufferSize, success);
+}
+
+inline Garnet::AsyncSend Garnet::Socket::asyncSend(const void* data, int size, bool* success)
+{
+    return AsyncSend(this, data, size, success);
+}
+
+inline Garnet::AsyncAccept Garnet::Socket::asyncAccept(bool* success)
+{
+    return AsyncAccept(this, success);
+}
+
+inline Garnet::AsyncConnect Garnet::Socket::asyncConnect(Address serverAddress, bool* success)
+{
+    return AsyncConnect(this, serverAddress, nullptr, success);
+}
+
+inline Garnet::AsyncConnect Garnet::ClientTCP::asyncConnect(Address serverAddress, bool* success)
+{
+    return AsyncConnect(&m_socket, serverAddress, this, success);
+}
+
+#endif